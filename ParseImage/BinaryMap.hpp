@@ -0,0 +1,221 @@
+#pragma once
+/**
+ * @file	BinaryMap.hpp
+ * @brief	Layout of the binary map file (`<worldspace>.map.bin`), and a reader that views it in place.
+ *\n		This header only depends on the standard library, so it can be copied into other projects that consume the map file.
+ *
+ *\n		All values are little-endian, and every section starts at an offset that is a multiple of 8 bytes, so a memory-mapped file can be read without copying or parsing anything.
+ *\n		Sections, in order:
+ *\n		- `Header`
+ *\n		- `RegionRecord[regionCount]`, where region index `i` (starting at 1) is stored at position `i - 1`.
+ *\n		- Cell grid offsets: `uint32_t[gridWidth * gridHeight + 1]`. The regions of the cell at column `x` & row `y` are stored in the range `[ offsets[i], offsets[i + 1] )` of the cell grid entries, where `i = y * gridWidth + x`.
+ *\n		- Cell grid entries: `uint16_t[]` region indices.
+ *\n		- Winner grid: `uint16_t[gridWidth * gridHeight]`. The region that wins the cell at column `x` & row `y` by priority is stored at `y * gridWidth + x`, or 0 when the cell has no regions.
+ *\n		- Polygon offsets: `uint32_t[regionCount + 1]`, indexed by region index minus one, into the polygon records.
+ *\n		- Polygon records: `PolygonRecord[]`
+ *\n		- Ring offsets: `uint32_t[ringCount + 1]`, into the vertices.
+ *\n		- Vertices: `Vertex[]`
+ *\n		- Strings: UTF-8 text referred to by `RegionRecord`, without null terminators.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace binmap {
+	/// @brief	The first 8 bytes of every binary map file.
+	inline constexpr char MAGIC[8]{ 'P', 'I', 'M', 'G', 'M', 'A', 'P', '\0' };
+	/// @brief	The format version written by this version of the program. Readers reject files with any other version.
+	inline constexpr std::uint32_t VERSION{ 2u };
+
+	/// @brief	Location of a section, in bytes from the start of the file.
+	struct Section {
+		std::uint64_t offset;
+		std::uint64_t size;
+	};
+
+	struct Header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t headerSize;
+		/// @brief	The number of cells along each axis of the cell grid.
+		std::int32_t gridWidth, gridHeight;
+		/// @brief	The cell coordinates of the top-left cell. The cell at column `x` & row `y` has the cell coordinates `( originX + x, originY - y )`.
+		std::int32_t originX, originY;
+		std::uint32_t regionCount;
+		std::uint32_t polygonCount;
+		std::uint32_t ringCount;
+		std::uint32_t vertexCount;
+		Section regions;
+		Section cellOffsets;
+		Section cellEntries;
+		Section winners;
+		Section polygonOffsets;
+		Section polygons;
+		Section ringOffsets;
+		Section vertices;
+		Section strings;
+	};
+
+	struct RegionRecord {
+		/// @brief	Editor ID & map name, as byte ranges in the strings section.
+		std::uint32_t editorIDOffset, editorIDLength;
+		std::uint32_t mapNameOffset, mapNameLength;
+		std::uint8_t r, g, b, _pad0;
+		std::uint16_t priority;
+		std::uint16_t _pad1;
+	};
+
+	/// @brief	One connected component of a region. The first ring is the counter-clockwise outer boundary, and every other ring is a clockwise hole.
+	struct PolygonRecord {
+		std::uint32_t firstRing;
+		std::uint32_t ringCount;
+	};
+
+	/// @brief	A cell corner, in cell coordinates.
+	struct Vertex {
+		std::int32_t x, y;
+	};
+
+	static_assert(sizeof(Header) % 8ull == 0ull && sizeof(RegionRecord) == 24ull && sizeof(PolygonRecord) == 8ull && sizeof(Vertex) == 8ull, "Unexpected struct padding!");
+
+	/**
+	 * @class	Reader
+	 * @brief	Read-only view of a binary map file that is already in memory.
+	 *\n		The constructor validates every section once; after that, accessors only index into the buffer. The buffer must outlive the reader.
+	 */
+	class Reader {
+		std::span<const std::byte> data;
+		const Header* header{ nullptr };
+
+		template<typename T>
+		std::span<const T> section(const Section& s) const { return{ reinterpret_cast<const T*>(data.data() + s.offset), static_cast<size_t>(s.size / sizeof(T)) }; }
+
+		template<typename T>
+		void check(const Section& s, const std::uint64_t& count, const char* name) const
+		{
+			if (s.offset % alignof(T) != 0ull || s.offset > data.size() || s.size > data.size() - s.offset || s.size != count * sizeof(T))
+				throw std::invalid_argument(std::string("Binary map file has an invalid ") + name + " section!");
+		}
+		// offset arrays must start at 0, never decrease, & end at the size of the section they index into
+		static void checkOffsets(std::span<const std::uint32_t> offsets, const std::uint64_t& count, const char* name)
+		{
+			for (size_t i{ 1ull }; i < offsets.size(); ++i)
+				if (offsets[i] < offsets[i - 1ull])
+					throw std::invalid_argument(std::string("Binary map file has decreasing ") + name + " offsets!");
+			if (offsets.front() != 0u || offsets.back() != count)
+				throw std::invalid_argument(std::string("Binary map file has out-of-range ") + name + " offsets!");
+		}
+
+	public:
+		/**
+		 * @brief		Validate a binary map file.
+		 * @param bytes	The entire contents of the file. Must be aligned to at least 8 bytes, which is always true for memory-mapped files & heap allocations.
+		 */
+		explicit Reader(std::span<const std::byte> bytes) : data{ bytes }
+		{
+			if (reinterpret_cast<std::uintptr_t>(data.data()) % 8ull != 0ull)
+				throw std::invalid_argument("Binary map buffer isn't aligned to 8 bytes!");
+			if (data.size() < sizeof(Header) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0)
+				throw std::invalid_argument("Not a binary map file!");
+			header = reinterpret_cast<const Header*>(data.data());
+			if (header->version != VERSION || header->headerSize != sizeof(Header))
+				throw std::invalid_argument("Unsupported binary map file version!");
+			if (header->gridWidth < 0 || header->gridHeight < 0)
+				throw std::invalid_argument("Binary map file has an invalid cell grid size!");
+
+			const std::uint64_t cellCount{ static_cast<std::uint64_t>(header->gridWidth) * static_cast<std::uint64_t>(header->gridHeight) };
+			check<RegionRecord>(header->regions, header->regionCount, "region");
+			check<std::uint32_t>(header->cellOffsets, cellCount + 1ull, "cell offset");
+			check<std::uint32_t>(header->polygonOffsets, header->regionCount + 1ull, "polygon offset");
+			check<PolygonRecord>(header->polygons, header->polygonCount, "polygon");
+			check<std::uint32_t>(header->ringOffsets, header->ringCount + 1ull, "ring offset");
+			check<Vertex>(header->vertices, header->vertexCount, "vertex");
+			check<char>(header->strings, header->strings.size, "string");
+			check<std::uint16_t>(header->cellEntries, header->cellEntries.size / sizeof(std::uint16_t), "cell entry");
+			check<std::uint16_t>(header->winners, cellCount, "winner");
+
+			checkOffsets(section<std::uint32_t>(header->cellOffsets), header->cellEntries.size / sizeof(std::uint16_t), "cell");
+			checkOffsets(section<std::uint32_t>(header->polygonOffsets), header->polygonCount, "polygon");
+			checkOffsets(section<std::uint32_t>(header->ringOffsets), header->vertexCount, "ring");
+			for (const auto& entry : section<std::uint16_t>(header->cellEntries))
+				if (entry == 0u || entry > header->regionCount)
+					throw std::invalid_argument("Binary map file has an out-of-range region index!");
+			for (const auto& winner : section<std::uint16_t>(header->winners))
+				if (winner > header->regionCount)
+					throw std::invalid_argument("Binary map file has an out-of-range winner!");
+			for (const auto& polygon : section<PolygonRecord>(header->polygons))
+				if (polygon.ringCount == 0u || polygon.firstRing > header->ringCount || polygon.ringCount > header->ringCount - polygon.firstRing)
+					throw std::invalid_argument("Binary map file has an out-of-range polygon!");
+			for (const auto& region : section<RegionRecord>(header->regions))
+				if (region.editorIDOffset > header->strings.size || region.editorIDLength > header->strings.size - region.editorIDOffset
+					|| region.mapNameOffset > header->strings.size || region.mapNameLength > header->strings.size - region.mapNameOffset)
+					throw std::invalid_argument("Binary map file has an out-of-range string!");
+		}
+
+		const Header& getHeader() const { return *header; }
+
+		/// @brief	Get the number of regions. Valid region indices are in the range ( 1 - regionCount() ).
+		std::uint32_t regionCount() const { return header->regionCount; }
+		/// @brief	Get the number of cells along the X axis of the grid.
+		std::int32_t gridWidth() const { return header->gridWidth; }
+		/// @brief	Get the number of cells along the Y axis of the grid.
+		std::int32_t gridHeight() const { return header->gridHeight; }
+
+		/// @brief	Get the record of a region. Region indices start at 1.
+		const RegionRecord& region(const std::uint16_t& index) const { return section<RegionRecord>(header->regions)[index - 1u]; }
+		/// @brief	Get the editor ID of a region.
+		std::string_view editorID(const std::uint16_t& index) const
+		{
+			const auto& r{ region(index) };
+			return{ reinterpret_cast<const char*>(data.data() + header->strings.offset + r.editorIDOffset), r.editorIDLength };
+		}
+		/// @brief	Get the map name of a region.
+		std::string_view mapName(const std::uint16_t& index) const
+		{
+			const auto& r{ region(index) };
+			return{ reinterpret_cast<const char*>(data.data() + header->strings.offset + r.mapNameOffset), r.mapNameLength };
+		}
+
+		/**
+		 * @brief	Get the regions assigned to a cell.
+		 * @param x	The column index of the cell, starting from the left.
+		 * @param y	The row index of the cell, starting from the top.
+		 * @returns	Region indices, in the same order as the text format.
+		 */
+		std::span<const std::uint16_t> cell(const std::int32_t& x, const std::int32_t& y) const
+		{
+			const auto& offsets{ section<std::uint32_t>(header->cellOffsets) };
+			const size_t i{ static_cast<size_t>(y) * static_cast<size_t>(header->gridWidth) + static_cast<size_t>(x) };
+			return section<std::uint16_t>(header->cellEntries).subspan(offsets[i], offsets[i + 1ull] - offsets[i]);
+		}
+
+		/**
+		 * @brief	Get the region that wins a cell, which is the region with the highest priority of the regions assigned to it.
+		 *\n		Ties are broken by the region with the most pixels in the cell, and then by the lowest region index.
+		 * @param x	The column index of the cell, starting from the left.
+		 * @param y	The row index of the cell, starting from the top.
+		 * @returns	A region index, or 0 when the cell has no regions.
+		 */
+		std::uint16_t winner(const std::int32_t& x, const std::int32_t& y) const { return winners()[static_cast<size_t>(y) * static_cast<size_t>(header->gridWidth) + static_cast<size_t>(x)]; }
+		/// @brief	Get the winning region of every cell, in row-major order.
+		std::span<const std::uint16_t> winners() const { return section<std::uint16_t>(header->winners); }
+
+		/// @brief	Get the polygons of a region.
+		std::span<const PolygonRecord> polygons(const std::uint16_t& index) const
+		{
+			const auto& offsets{ section<std::uint32_t>(header->polygonOffsets) };
+			return section<PolygonRecord>(header->polygons).subspan(offsets[index - 1u], offsets[index] - offsets[index - 1u]);
+		}
+
+		/// @brief	Get the vertices of a ring, where ring indices come from `PolygonRecord`.
+		std::span<const Vertex> ring(const std::uint32_t& index) const
+		{
+			const auto& offsets{ section<std::uint32_t>(header->ringOffsets) };
+			return section<Vertex>(header->vertices).subspan(offsets[index], offsets[index + 1u] - offsets[index]);
+		}
+	};
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include "BinaryMap.hpp"
+#include "CellMapper.hpp"
+#include "RegionAreaMap.hpp"
+#include "TMap.hpp"
+
+#include <make_exception.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+#include <vector>
+
+namespace binmap {
+	/**
+	 * @brief			Build the record of every region, in order of region index.
+	 * @param regions	The table of regions.
+	 * @param strings	Receives the editor ID & map name of every region, which the records refer to by offset.
+	 * @returns			std::vector<RegionRecord>
+	 */
+	inline std::vector<RegionRecord> makeRegionRecords(const RegionTable& regions, std::string& strings)
+	{
+		std::vector<RegionRecord> records;
+		records.reserve(regions.size());
+		for (const auto& region : regions.getRegions()) {
+			RegionRecord& record{ records.emplace_back() };
+			record.editorIDOffset = static_cast<std::uint32_t>(strings.size());
+			record.editorIDLength = static_cast<std::uint32_t>(region.editorID.size());
+			strings += region.editorID;
+			record.mapNameOffset = static_cast<std::uint32_t>(strings.size());
+			record.mapNameLength = static_cast<std::uint32_t>(region.mapName.size());
+			strings += region.mapName;
+			record.r = region.color.r();
+			record.g = region.color.g();
+			record.b = region.color.b();
+			record.priority = region.priority;
+		}
+		return records;
+	}
+
+	/**
+	 * @brief				Serialize the results of parsing an image into the binary map format described in `BinaryMap.hpp`.
+	 * @param regions		The table of regions that the results refer to.
+	 * @param gridSize		The number of cells along each axis.
+	 * @param regionAreas	The outline polygons of each region.
+	 * @param holdMap		The regions assigned to each cell, by cell coordinate.
+	 * @param winners		The winning region of each cell, in row-major order of grid index.
+	 * @returns				The contents of the file.
+	 */
+	inline std::vector<std::byte> serialize(const RegionTable& regions, const cv::Size& gridSize, const RegionAreaMap& regionAreas, const HoldMap& holdMap, const RegionIndexVec& winners) noexcept(false)
+	{
+		if (winners.size() != static_cast<size_t>(gridSize.area()))
+			throw make_exception("The winner grid ( ", winners.size(), " cells ) doesn't match the cell grid ( ", gridSize.area(), " cells )!");
+
+		Header header{};
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.headerSize = sizeof(Header);
+		header.gridWidth = gridSize.width;
+		header.gridHeight = gridSize.height;
+		const cv::Point origin{ offsetCellCoordinates({ 0, 0 }) };
+		header.originX = origin.x;
+		header.originY = origin.y;
+		header.regionCount = static_cast<std::uint32_t>(regions.size());
+
+		// regions & strings
+		std::string strings;
+		const auto& regionRecords{ makeRegionRecords(regions, strings) };
+
+		// cell grid, converted from cell coordinates back to grid indices
+		std::vector<const RegionIndexVec*> cells(static_cast<size_t>(gridSize.area()), nullptr);
+		for (const auto& [pos, indices] : holdMap) {
+			const int x{ pos.x - origin.x }, y{ origin.y - pos.y };
+			if (x < 0 || x >= gridSize.width || y < 0 || y >= gridSize.height)
+				throw make_exception("Cell ( ", pos.x, ", ", pos.y, " ) is outside of the cell grid!");
+			cells[static_cast<size_t>(y) * gridSize.width + x] = &indices;
+		}
+		std::vector<std::uint32_t> cellOffsets;
+		cellOffsets.reserve(cells.size() + 1ull);
+		std::vector<std::uint16_t> cellEntries;
+		cellOffsets.emplace_back(0u);
+		for (const auto& indices : cells) {
+			if (indices != nullptr)
+				cellEntries.insert(cellEntries.end(), indices->begin(), indices->end());
+			cellOffsets.emplace_back(static_cast<std::uint32_t>(cellEntries.size()));
+		}
+
+		// polygons
+		std::vector<std::uint32_t> polygonOffsets{ 0u }, ringOffsets{ 0u };
+		std::vector<PolygonRecord> polygonRecords;
+		std::vector<Vertex> vertices;
+		const auto& addRing{ [&](const contour::Ring& ring) {
+			for (const auto& p : ring)
+				vertices.emplace_back(Vertex{ p.x, p.y });
+			ringOffsets.emplace_back(static_cast<std::uint32_t>(vertices.size()));
+		} };
+		for (RegionIndex index{ 1 }; index <= regions.size(); ++index) {
+			if (const auto& it{ regionAreas.find(index) }; it != regionAreas.end()) {
+				for (const auto& polygon : it->second) {
+					polygonRecords.emplace_back(PolygonRecord{ static_cast<std::uint32_t>(ringOffsets.size() - 1ull), static_cast<std::uint32_t>(1ull + polygon.holes.size()) });
+					addRing(polygon.outer);
+					for (const auto& hole : polygon.holes)
+						addRing(hole);
+				}
+			}
+			polygonOffsets.emplace_back(static_cast<std::uint32_t>(polygonRecords.size()));
+		}
+		header.polygonCount = static_cast<std::uint32_t>(polygonRecords.size());
+		header.ringCount = static_cast<std::uint32_t>(ringOffsets.size() - 1ull);
+		header.vertexCount = static_cast<std::uint32_t>(vertices.size());
+
+		// lay out every section after the header, each aligned to 8 bytes
+		std::uint64_t size{ sizeof(Header) };
+		const auto& place{ [&size](Section& section, const std::uint64_t& bytes) {
+			section = { size, bytes };
+			size += (bytes + 7ull) & ~7ull;
+		} };
+		place(header.regions, regionRecords.size() * sizeof(RegionRecord));
+		place(header.cellOffsets, cellOffsets.size() * sizeof(std::uint32_t));
+		place(header.cellEntries, cellEntries.size() * sizeof(std::uint16_t));
+		place(header.winners, winners.size() * sizeof(std::uint16_t));
+		place(header.polygonOffsets, polygonOffsets.size() * sizeof(std::uint32_t));
+		place(header.polygons, polygonRecords.size() * sizeof(PolygonRecord));
+		place(header.ringOffsets, ringOffsets.size() * sizeof(std::uint32_t));
+		place(header.vertices, vertices.size() * sizeof(Vertex));
+		place(header.strings, strings.size());
+
+		std::vector<std::byte> bytes(static_cast<size_t>(size), std::byte{ 0 });
+		const auto& copy{ [&bytes](const Section& section, const void* src) {
+			if (section.size != 0ull)
+				std::memcpy(bytes.data() + section.offset, src, static_cast<size_t>(section.size));
+		} };
+		std::memcpy(bytes.data(), &header, sizeof(Header));
+		copy(header.regions, regionRecords.data());
+		copy(header.cellOffsets, cellOffsets.data());
+		copy(header.cellEntries, cellEntries.data());
+		copy(header.winners, winners.data());
+		copy(header.polygonOffsets, polygonOffsets.data());
+		copy(header.polygons, polygonRecords.data());
+		copy(header.ringOffsets, ringOffsets.data());
+		copy(header.vertices, vertices.data());
+		copy(header.strings, strings.data());
+		return bytes;
+	}
+
+	/**
+	 * @brief				Write the results of parsing an image to a binary map file.
+	 * @param path			The location of the output file. It is overwritten if it already exists.
+	 * @param regions		The table of regions that the results refer to.
+	 * @param gridSize		The number of cells along each axis.
+	 * @param regionAreas	The outline polygons of each region.
+	 * @param holdMap		The regions assigned to each cell, by cell coordinate.
+	 * @param winners		The winning region of each cell, in row-major order of grid index.
+	 * @returns				true when successful.
+	 */
+	inline bool write(const std::filesystem::path& path, const RegionTable& regions, const cv::Size& gridSize, const RegionAreaMap& regionAreas, const HoldMap& holdMap, const RegionIndexVec& winners) noexcept(false)
+	{
+		const auto& bytes{ serialize(regions, gridSize, regionAreas, holdMap, winners) };
+		std::ofstream ofs{ path, std::ios_base::binary | std::ios_base::trunc };
+		return ofs.is_open() && ofs.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+	}
+}
@@ -0,0 +1,262 @@
+#pragma once
+#include "CellMatrix.hpp"
+#include "ColorLUT.hpp"
+#include "Logger.hpp"
+#include "RegionStatsMap.hpp"
+#include "TMap.hpp"
+#include "ThreadPool.hpp"
+#include "TileCache.hpp"
+
+#include <TermAPI.hpp>
+#include <make_exception.hpp>
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <sstream>
+
+/// @brief	Translates index coordinates (origin 0,0 top-left) to cell coordinates (origin -74, 49 top-left)
+inline cv::Point offsetCellCoordinates(const cv::Point& p, const cv::Point& pMin = { 0, 0 }, const cv::Point& pMax = { 149, 99 })
+{
+	const cv::Point cellMin{ -74, 49 }, cellMax{ 75, -50 };
+
+	const auto& translateAxis{ [](const auto& v, const auto& oldMin, const auto& oldMax, const auto& newMin, const auto& newMax) {
+		if (oldMin == oldMax || newMin == newMax)
+			throw make_exception("Invalid translation: ( ", oldMin, " - ", oldMax, " ) => ( ", newMin, " - ", newMax, " )");
+		const auto
+			& oldRange{ oldMax - oldMin },
+			& newRange{ newMax - newMin };
+		return (((v - oldMin) * newRange) / oldRange) + newMin;
+	} };
+
+	return{
+		translateAxis(p.x, pMin.x, pMax.x, cellMin.x, cellMax.x),
+		translateAxis(p.y, pMin.y, pMax.y, cellMin.y, cellMax.y)
+	};
+}
+
+/**
+ * @class	CellMapper
+ * @brief	Classifies an image one row of cells at a time, and aggregates the results into a `RegionStatsMap` & `HoldMap`.
+ *\n		Rows may be classified concurrently on a `ThreadPool`; each row produces its own fragment, and fragments are always merged in row order so that the results are identical to a serial run.
+ */
+class CellMapper {
+public:
+	/// @brief	Returns the image strip for a row of cells. Called concurrently from worker threads when a pool is used.
+	using RowSource = std::function<cv::Mat(const int&)>;
+	/// @brief	Called with the index of each row of cells before it is classified.
+	using RowCallback = std::function<void(const int&)>;
+	/// @brief	Called with the index of each row of cells and the region index of every pixel of its strip, after it is classified. Called concurrently from worker threads when a pool is used.
+	using LabelCallback = std::function<void(const int&, const cv::Mat&)>;
+
+	struct Result {
+		RegionStatsMap regionStats;
+		HoldMap holdMap;
+		/// @brief	The winning region of each cell, in row-major order of partition index, or `ColorLUT::NONE` for cells without any regions. See `CellMapper::selectWinner()`.
+		RegionIndexVec winners;
+		/// @brief	The number of partitions that were processed.
+		size_t partitions{ 0ull };
+		/// @brief	The number of partitions whose pixel counts were reused from a `TileCache` instead of being classified.
+		size_t cachedPartitions{ 0ull };
+		/// @brief	The number of pixels that belong to any region, in all of the partitions that were processed.
+		size_t matchedPixels{ 0ull };
+		/// @brief	The total time spent merging rows into the results, in seconds.
+		double mergeSeconds{ 0.0 };
+		/// @brief	The number of partitions where every pixel is unmatched.
+		size_t emptyPartitions{ 0ull };
+		/// @brief	The number of partitions where every pixel belongs to the same region.
+		size_t uniformPartitions{ 0ull };
+		/// @brief	The number of partitions that contain more than one region, or a region & unmatched pixels. Only these need a full histogram.
+		size_t mixedPartitions{ 0ull };
+	};
+
+private:
+	const ColorLUT& lut;
+	cv::Size gridSize;
+	cv::Size cellSize;
+	float threshold;
+	Logger* logger;
+
+	/// @brief	The classified contents & log output of one row of cells, waiting to be merged.
+	struct RowFragment {
+		HoldMap holds;
+		std::string log;
+		size_t cached{ 0ull };
+		size_t matched{ 0ull };
+		size_t kinds[3]{ 0ull, 0ull, 0ull };
+		bool ready{ false };
+	};
+
+	/**
+	 * @brief			Resolve which of the regions assigned to a cell wins it.
+	 *\n				The region with the highest priority wins, ties are broken by the region with the most pixels in the cell, and then by the lowest region index.
+	 * @param matrix	The matrix that contains the cell.
+	 * @param x			The column of the cell.
+	 * @param y			The row of the cell.
+	 * @param indices	The regions assigned to the cell, in ascending order. Must not be empty.
+	 * @returns			RegionIndex
+	 */
+	RegionIndex selectWinner(const CellMatrix& matrix, const int& x, const int& y, const RegionIndexVec& indices) const
+	{
+		const RegionTable& regions{ lut.getRegionTable() };
+		const auto& counts{ matrix.at(x, y) };
+		RegionIndex winner{ indices.front() };
+		for (const auto& index : indices) {
+			const auto& priority{ regions[index].priority }, & winnerPriority{ regions[winner].priority };
+			if (priority > winnerPriority || (priority == winnerPriority && counts[index] > counts[winner]))
+				winner = index;
+		}
+		return winner;
+	}
+
+	/// @brief	Look up the region index of every pixel in columns `x0` - `x1` of a BGR strip.
+	void classifyColumns(const cv::Mat& strip, const int& x0, const int& x1, cv::Mat& labels) const
+	{
+		for (int y{ 0 }; y < strip.rows; ++y)
+			lut.classify(strip.ptr<uchar>(y) + static_cast<size_t>(x0) * 3ull, static_cast<size_t>(x1 - x0), labels.ptr<RegionIndex>(y) + x0);
+	}
+
+	void classifyRow(CellMatrix& matrix, const cv::Mat& strip, const int& y, RowFragment& fragment, RegionIndex* winners, TileCache* cache, const LabelCallback& onLabels) const
+	{
+		// label strips already are the region index of each pixel; BGR strips keep the indices that classifying them finds
+		cv::Mat labels;
+		const bool keepLabels{ onLabels && strip.type() == CV_8UC3 };
+		if (keepLabels)
+			labels.create(strip.rows, strip.cols, CV_16UC1);
+
+		if (cache == nullptr)
+			matrix.parseRow(strip, y, lut, keepLabels ? &labels : nullptr);
+		else for (int x{ 0 }; x < gridSize.width; ++x) {
+			// only classify cells whose pixels changed since the cache was saved
+			const auto& hash{ TileCache::hashCell(strip, x, cellSize.width) };
+			if (const auto& cached{ cache->find(x, y, hash) }; cached.has_value()) {
+				matrix.assign(x, y, cached.value());
+				++fragment.cached;
+				if (keepLabels)
+					classifyColumns(strip, x * cellSize.width, (x + 1) * cellSize.width, labels);
+			}
+			else {
+				matrix.parseCell(strip, x, y, lut, keepLabels ? &labels : nullptr);
+				cache->store(x, y, hash, matrix.at(x, y));
+			}
+		}
+
+		if (keepLabels) {
+			// the pixels to the right of the last whole cell aren't classified
+			if (const int classified{ gridSize.width * cellSize.width }; classified < strip.cols)
+				classifyColumns(strip, classified, strip.cols, labels);
+			onLabels(y, labels);
+		}
+		else if (onLabels)
+			onLabels(y, strip);
+
+		// per-partition detail is only formatted when it will be written
+		const bool verbose{ logger != nullptr && logger->enabled(LogLevel::Debug) };
+		std::ostringstream log;
+		RegionIndexVec indices;
+		indices.reserve(lut.size());
+
+		for (int x{ 0 }; x < gridSize.width; ++x) {
+			const auto& cellPos{ offsetCellCoordinates(cv::Point{ x, y }) };
+			if (verbose) log << "Processing Partition #" << color::setcolor::green << (static_cast<size_t>(y) * gridSize.width + x) << color::setcolor::reset << '\n'
+				<< "  Partition Index:   ( " << color::setcolor::yellow << x << color::setcolor::reset << ", " << color::setcolor::yellow << y << color::setcolor::reset << " )\n"
+				<< "  Cell Coordinates:  ( " << color::setcolor::yellow << cellPos.x << color::setcolor::reset << ", " << color::setcolor::yellow << cellPos.y << color::setcolor::reset << " )\n";
+			fragment.matched += matrix.getMatchedCount(x, y);
+			const TileKind kind{ matrix.getKind(x, y) };
+			++fragment.kinds[static_cast<size_t>(kind)];
+			if (kind != TileKind::Empty) {
+				if (matrix.getIndices(x, y, indices, threshold); !indices.empty()) {
+					winners[x] = selectWinner(matrix, x, y, indices);
+					if (verbose) log << "  " << color::setcolor::cyan << Named{ indices, lut.getRegionTable() } << color::setcolor::reset << '\n';
+					fragment.holds.emplace_back(std::make_pair(cellPos, indices));
+				}
+				else if (verbose) log << "  " << color::setcolor::red << "No regions above threshold." << color::setcolor::reset << '\n';
+			}
+		}
+
+		if (verbose)
+			fragment.log = log.str();
+	}
+
+public:
+	/**
+	 * @brief				Constructor.
+	 * @param lut			Reference of the `ColorLUT` to use when checking pixels. Must outlive the mapper.
+	 * @param gridSize		The number of cells along each axis.
+	 * @param cellSize		The size of one cell, in pixels.
+	 * @param threshold		The threshold percentage _( 0.0 - 1.0 )_ of pixels that a region must have in a cell in order to be assigned to it.
+	 * @param logger		Optional logger to write progress to. The details of each partition are only logged at `LogLevel::Debug`.
+	 */
+	CellMapper(const ColorLUT& lut, const cv::Size& gridSize, const cv::Size& cellSize, const float& threshold, Logger* logger = nullptr) : lut{ lut }, gridSize{ gridSize }, cellSize{ cellSize }, threshold{ threshold }, logger{ logger } {}
+
+	/**
+	 * @brief			Classify every row of cells and merge the results.
+	 *\n				Every row is classified, so regions separated by empty rows are never lost. Cells are summarized as empty, uniform or mixed while they are classified, and only mixed cells are histogrammed pixel by pixel.
+	 * @param source	Callable that returns the image strip for a given row of cells.
+	 * @param pool		Optional thread pool to classify rows on. When this is `nullptr`, or when `onRow` is set, rows are classified serially on the calling thread.
+	 * @param onRow		Optional callback that is called with each row index before it is classified.
+	 * @param cache		Optional cache of previously classified cells. Cells with unchanged pixels are reused from it, and every other cell that is classified is stored in it.
+	 * @param onLabels	Optional callback that receives the region index of every pixel of each strip, including the pixels to the right of the last whole cell. These are the indices that were found while classifying the strip, so it doesn't have to be converted again.
+	 * @returns			Result
+	 */
+	Result run(const RowSource& source, ThreadPool* pool = nullptr, const RowCallback& onRow = {}, TileCache* cache = nullptr, const LabelCallback& onLabels = {}) const noexcept(false)
+	{
+		Result result;
+		result.holdMap.reserve(static_cast<size_t>(gridSize.area()));
+		// every row writes only its own part of the winners, so rows don't need to be merged in order to fill it
+		result.winners.assign(static_cast<size_t>(gridSize.area()), ColorLUT::NONE);
+
+		CellMatrix matrix{ gridSize, cellSize, lut.size() };
+		std::vector<RowFragment> fragments(static_cast<size_t>(gridSize.height));
+
+		std::mutex mergeMutex;
+		int merged{ 0 }; //< the index of the next row to merge
+
+		// merges every consecutive row that is ready; must be called with mergeMutex held
+		const auto& merge{ [&] {
+			const auto& t_start{ std::chrono::steady_clock::now() };
+			for (; merged < gridSize.height && fragments[merged].ready; ++merged) {
+				auto& fragment{ fragments[merged] };
+				if (logger != nullptr)
+					logger->push(LogLevel::Debug, std::move(fragment.log));
+				result.partitions += static_cast<size_t>(gridSize.width);
+				result.cachedPartitions += fragment.cached;
+				result.matchedPixels += fragment.matched;
+				result.emptyPartitions += fragment.kinds[static_cast<size_t>(TileKind::Empty)];
+				result.uniformPartitions += fragment.kinds[static_cast<size_t>(TileKind::Uniform)];
+				result.mixedPartitions += fragment.kinds[static_cast<size_t>(TileKind::Mixed)];
+
+				for (auto& hold : fragment.holds) {
+					for (const auto& region : hold.second)
+						result.regionStats[region].emplace_back(hold.first);
+					result.holdMap.emplace_back(std::move(hold));
+				}
+
+				fragment = {};
+			}
+			result.mergeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+		} };
+
+		const auto& processRow{ [&](const size_t& i) {
+			const int y{ static_cast<int>(i) };
+			if (onRow)
+				onRow(y);
+
+			RowFragment fragment;
+			classifyRow(matrix, source(y), y, fragment, result.winners.data() + i * gridSize.width, cache, onLabels);
+			fragment.ready = true;
+
+			std::scoped_lock lock{ mergeMutex };
+			fragments[y] = std::move(fragment);
+			merge();
+		} };
+
+		if (pool != nullptr && !onRow)
+			pool->parallel_for(static_cast<size_t>(gridSize.height), processRow);
+		else for (size_t y{ 0ull }; y < static_cast<size_t>(gridSize.height); ++y)
+			processRow(y);
+
+		result.holdMap.shrink_to_fit();
+		return result;
+	}
+};
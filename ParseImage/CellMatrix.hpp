@@ -0,0 +1,333 @@
+#pragma once
+#include "ColorLUT.hpp"
+#include "PartitionStats.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <make_exception.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <vector>
+
+/// @brief	How the pixels of a cell are distributed between regions.
+enum class TileKind : uchar {
+	/// @brief	Every pixel is unmatched.
+	Empty,
+	/// @brief	Every pixel belongs to the same region.
+	Uniform,
+	/// @brief	Any other cell.
+	Mixed,
+};
+
+/**
+ * @struct	CellMatrix
+ * @brief	Dense matrix of per-cell region histograms for a whole image.
+ *\n		Each image row is streamed exactly once from left to right, adding each pixel's region index to the histogram of the cell column it falls in.
+ *\n		Strips can either be BGR pixels, which are classified with a `ColorLUT`, or the labels of a `LabelImage`, which are used as-is.
+ *\n		A pre-pass over the raw pixels first finds the cells that are a single color or label, which are counted with one lookup and never classified. Sparse maps are mostly made of such cells, in their empty margins.
+ *\n		Before a cell's slice of a pixel row is histogrammed, it is checked for a single repeated region index. Slices that pass add all of their pixels with one increment, so only mixed cells are histogrammed pixel by pixel.
+ *\n		Each cell is then summarized as empty, uniform or mixed.
+ */
+struct CellMatrix {
+	using count = PartitionStats::count;
+private:
+	cv::Size gridSize{ 0, 0 };
+	cv::Size cellSize{ 0, 0 };
+	/// @brief	The number of counters per cell; one for each region, plus one for unmatched pixels.
+	size_t stride{ 0ull };
+	/// @brief	Row-major cell histograms, each `stride` counters long and indexed by `RegionIndex`.
+	std::vector<count> counts;
+	/// @brief	Row-major cell kinds.
+	std::vector<TileKind> kinds;
+	/// @brief	Row-major region of each uniform cell, or `ColorLUT::NONE` for every other cell.
+	std::vector<RegionIndex> uniformRegions;
+
+	count* cell(const int& x, const int& y) { return counts.data() + (static_cast<size_t>(y) * gridSize.width + x) * stride; }
+	const count* cell(const int& x, const int& y) const { return counts.data() + (static_cast<size_t>(y) * gridSize.width + x) * stride; }
+
+	void validate(const cv::Mat& strip, const int& row, const ColorLUT& lut, const cv::Mat* labels) const noexcept(false)
+	{
+		if (strip.type() != CV_8UC3 && strip.type() != CV_8UC1 && strip.type() != CV_16UC1)
+			throw make_exception("Image strips must either be 3-channel BGR images or label images!");
+		if (strip.rows != cellSize.height || strip.cols < gridSize.width * cellSize.width)
+			throw make_exception("Image strip ( ", strip.cols, " x ", strip.rows, " ) doesn't match the cell grid!");
+		if (row < 0 || row >= gridSize.height)
+			throw make_exception("Row index ", row, " is out-of-range: ( 0 - ", gridSize.height, " )!");
+		if (lut.size() + 1ull != stride)
+			throw make_exception("The ColorLUT doesn't match the matrix!");
+		if (labels != nullptr && (labels->type() != CV_16UC1 || labels->rows != strip.rows || labels->cols < gridSize.width * cellSize.width))
+			throw make_exception("The label strip must be a 16-bit label image with the same number of rows as the image strip!");
+	}
+
+	/// @brief	Check if every index in a range is equal to `value`. This has no early exit, so that it vectorizes.
+	static bool allEqual(const RegionIndex* indices, const size_t& length, const RegionIndex& value)
+	{
+		RegionIndex diff{ 0 };
+		for (size_t i{ 0ull }; i < length; ++i)
+			diff |= static_cast<RegionIndex>(indices[i] ^ value);
+		return diff == 0;
+	}
+
+	void setKind(const int& x, const int& y, const TileKind& kind, const RegionIndex& region)
+	{
+		const size_t i{ static_cast<size_t>(y) * gridSize.width + x };
+		kinds[i] = kind;
+		uniformRegions[i] = kind == TileKind::Uniform ? region : ColorLUT::NONE;
+	}
+
+	/// @brief	Check if `count` consecutive pixels of `elemSize` bytes each are all the same. Comparing the pixels to themselves shifted by one pixel checks every neighbouring pair at once.
+	static bool sameValue(const uchar* pixels, const size_t& count, const size_t& elemSize) { return count < 2ull || std::memcmp(pixels, pixels + elemSize, (count - 1ull) * elemSize) == 0; }
+
+	/// @brief	Get the region index of a single pixel of a strip.
+	static RegionIndex labelOf(const cv::Mat& strip, const uchar* pixel, const ColorLUT& lut)
+	{
+		switch (strip.type()) {
+		case CV_16UC1:
+			return *reinterpret_cast<const RegionIndex*>(pixel);
+		case CV_8UC1:
+			return *pixel;
+		default:
+			return lut.find(pixel);
+		}
+	}
+
+	/// @brief	Buffers used by `parseCells()`, kept per thread so that parsing rows & cells doesn't allocate once they have grown to size.
+	struct Scratch {
+		/// @brief	The region index of each pixel in one row of the cells being parsed.
+		std::vector<RegionIndex> indices;
+		/// @brief	Whether every pixel of each cell has the same raw value, as found by the pre-pass.
+		std::vector<uchar> solid;
+		/// @brief	The index shared by every pixel of each cell so far, as long as it is uniform.
+		std::vector<RegionIndex> first;
+		/// @brief	Whether each cell has more than one index so far.
+		std::vector<uchar> mixed;
+	};
+
+	/// @brief	Parse `n` consecutive cells of a row, starting at column `x0`, and write the index of each of their pixels to `labels` when it isn't `nullptr`.
+	void parseCells(const cv::Mat& strip, const int& row, const int& x0, const int& n, const ColorLUT& lut, cv::Mat* labels)
+	{
+		std::fill_n(cell(x0, row), static_cast<size_t>(n) * stride, 0u);
+
+		const size_t cellWidth{ static_cast<size_t>(cellSize.width) }, elemSize{ strip.elemSize() };
+		const size_t sliceBytes{ cellWidth * elemSize }, firstByte{ static_cast<size_t>(x0) * sliceBytes };
+		thread_local Scratch scratch;
+		auto& [indices, solid, first, mixed] { scratch };
+		if (strip.type() != CV_16UC1)
+			indices.resize(static_cast<size_t>(n) * cellWidth);
+		solid.assign(static_cast<size_t>(n), 1);
+		first.assign(static_cast<size_t>(n), ColorLUT::NONE);
+		mixed.assign(static_cast<size_t>(n), 0);
+
+		// pre-pass: find the cells whose pixels are all the same color or label, such as empty margins, from their raw bytes.
+		// this usually stops at the first pixel that differs, so it's cheap for every other cell, and solid cells are counted with a single lookup instead of being classified & histogrammed
+		for (int x{ 0 }; x < n; ++x) {
+			const uchar* pixel{ strip.ptr<uchar>(0) + firstByte + static_cast<size_t>(x) * sliceBytes };
+			for (int y{ 0 }; solid[x] && y < strip.rows; ++y) {
+				const uchar* slice{ strip.ptr<uchar>(y) + firstByte + static_cast<size_t>(x) * sliceBytes };
+				solid[x] = std::memcmp(slice, pixel, elemSize) == 0 && sameValue(slice, cellWidth, elemSize);
+			}
+			if (solid[x]) {
+				first[x] = labelOf(strip, pixel, lut);
+				cell(x0 + x, row)[first[x]] = static_cast<count>(cellSize.area());
+			}
+		}
+
+		for (int y{ 0 }; y < strip.rows; ++y) {
+			const uchar* pixels{ strip.ptr<uchar>(y) + firstByte };
+			// each run of cells that aren't solid is classified with one call, and 16-bit labels are read in place
+			if (strip.type() != CV_16UC1) {
+				for (int x{ 0 }; x < n;) {
+					if (solid[x]) {
+						++x;
+						continue;
+					}
+					int end{ x + 1 };
+					while (end < n && !solid[end])
+						++end;
+					const size_t offset{ static_cast<size_t>(x) * cellWidth }, runLength{ static_cast<size_t>(end - x) * cellWidth };
+					if (strip.type() == CV_8UC1)
+						std::copy(pixels + offset, pixels + offset + runLength, indices.begin() + static_cast<std::ptrdiff_t>(offset));
+					else lut.classify(pixels + offset * 3ull, runLength, indices.data() + offset);
+					x = end;
+				}
+			}
+			const RegionIndex* index{ strip.type() == CV_16UC1 ? reinterpret_cast<const RegionIndex*>(pixels) : indices.data() };
+			// the indices were found for the histograms anyway, so they are kept for the caller instead of being looked up again
+			if (labels != nullptr) {
+				RegionIndex* out{ labels->ptr<RegionIndex>(y) + static_cast<size_t>(x0) * cellWidth };
+				for (int x{ 0 }; x < n; ++x, out += cellWidth) {
+					if (solid[x])
+						std::fill_n(out, cellWidth, first[x]);
+					else std::copy_n(index + static_cast<size_t>(x) * cellWidth, cellWidth, out);
+				}
+			}
+			count* hist{ cell(x0, row) };
+			for (int x{ 0 }; x < n; ++x, hist += stride, index += cellWidth) {
+				if (solid[x])
+					continue;
+				if (const RegionIndex& label{ index[0] }; allEqual(index, cellWidth, label)) {
+					hist[label] += static_cast<count>(cellWidth);
+					if (y == 0)
+						first[x] = label;
+					else if (label != first[x])
+						mixed[x] = 1;
+				}
+				else {
+					for (size_t i{ 0ull }; i < cellWidth; ++i)
+						++hist[index[i]];
+					mixed[x] = 1;
+				}
+			}
+		}
+
+		for (int x{ 0 }; x < n; ++x)
+			setKind(x0 + x, row, mixed[x] ? TileKind::Mixed : first[x] == ColorLUT::NONE ? TileKind::Empty : TileKind::Uniform, first[x]);
+	}
+
+public:
+	/// @brief	Default Constructor.
+	CellMatrix() = default;
+	/**
+	 * @brief				Create an empty matrix. Use `parseRow()` to fill it one row of cells at a time.
+	 * @param gridSize		The number of cells along each axis.
+	 * @param cellSize		The size of one cell, in pixels.
+	 * @param regionCount	The number of regions in the `ColorLUT` that will be used to parse rows.
+	 */
+	CellMatrix(const cv::Size& gridSize, const cv::Size& cellSize, const size_t& regionCount) :
+		gridSize{ gridSize },
+		cellSize{ cellSize },
+		stride{ regionCount + 1ull },
+		counts(static_cast<size_t>(gridSize.area()) * stride, 0u),
+		kinds(static_cast<size_t>(gridSize.area()), TileKind::Empty),
+		uniformRegions(static_cast<size_t>(gridSize.area()), ColorLUT::NONE) {}
+	/**
+	 * @brief			Create a matrix and parse every row of cells in an image with a single sequential pass.
+	 *\n				Pixels to the right of or below the last whole cell are ignored.
+	 * @param image		The 3-channel BGR or label image to parse.
+	 * @param cellSize	The size of one cell, in pixels.
+	 * @param lut		Reference of the `ColorLUT` to use when checking pixels.
+	 */
+	CellMatrix(const cv::Mat& image, const cv::Size& cellSize, const ColorLUT& lut) noexcept(false) : CellMatrix({ image.cols / cellSize.width, image.rows / cellSize.height }, cellSize, lut.size())
+	{
+		for (int y{ 0 }; y < gridSize.height; ++y)
+			parseRow(image.rowRange(y * cellSize.height, (y + 1) * cellSize.height), y, lut);
+	}
+
+	/**
+	 * @brief			Parse one row of cells.
+	 * @param strip		A 3-channel BGR or label image strip exactly one cell tall, and at least as wide as the grid.
+	 * @param row		The index of the row of cells that the strip belongs to.
+	 * @param lut		Reference of the `ColorLUT` to use when checking BGR pixels. Must contain the same number of regions as the matrix was created with.
+	 * @param labels	Optional `CV_16UC1` strip with as many rows as `strip`, and at least as wide as the grid, that receives the region index of every pixel in the row of cells.
+	 */
+	void parseRow(const cv::Mat& strip, const int& row, const ColorLUT& lut, cv::Mat* labels = nullptr) noexcept(false)
+	{
+		validate(strip, row, lut, labels);
+		parseCells(strip, row, 0, gridSize.width, lut, labels);
+	}
+
+	/**
+	 * @brief			Parse a single cell.
+	 * @param strip		A 3-channel BGR or label image strip exactly one cell tall, and at least as wide as the grid.
+	 * @param x			The column index of the cell.
+	 * @param row		The index of the row of cells that the strip belongs to.
+	 * @param lut		Reference of the `ColorLUT` to use when checking BGR pixels. Must contain the same number of regions as the matrix was created with.
+	 * @param labels	Optional `CV_16UC1` strip with as many rows as `strip`, and at least as wide as the grid, that receives the region index of every pixel in the cell.
+	 */
+	void parseCell(const cv::Mat& strip, const int& x, const int& row, const ColorLUT& lut, cv::Mat* labels = nullptr) noexcept(false)
+	{
+		validate(strip, row, lut, labels);
+		if (x < 0 || x >= gridSize.width)
+			throw make_exception("Column index ", x, " is out-of-range: ( 0 - ", gridSize.width, " )!");
+
+		parseCells(strip, row, x, 1, lut, labels);
+	}
+
+	/**
+	 * @brief			Overwrite the pixel counts of a cell with previously parsed values.
+	 * @param x			The column index of the cell.
+	 * @param y			The row index of the cell.
+	 * @param values	The counts to copy, indexed by `RegionIndex`. Must have the same length as `at()`.
+	 */
+	void assign(const int& x, const int& y, std::span<const count> values) noexcept(false)
+	{
+		if (values.size() != stride)
+			throw make_exception("Cell counts have the wrong number of regions! ( ", values.size() - 1ull, " != ", stride - 1ull, " )");
+		std::copy(values.begin(), values.end(), cell(x, y));
+
+		const count area{ static_cast<count>(cellSize.area()) };
+		if (values[ColorLUT::NONE] == area)
+			setKind(x, y, TileKind::Empty, ColorLUT::NONE);
+		else if (const auto& it{ std::find(values.begin(), values.end(), area) }; it != values.end())
+			setKind(x, y, TileKind::Uniform, static_cast<RegionIndex>(std::distance(values.begin(), it)));
+		else setKind(x, y, TileKind::Mixed, ColorLUT::NONE);
+	}
+
+	/// @brief	Get the number of cells along each axis.
+	cv::Size size() const { return gridSize; }
+	/// @brief	Get the size of one cell, in pixels.
+	cv::Size getCellSize() const { return cellSize; }
+
+	/**
+	 * @brief		Get a view of a cell's raw pixel counts, indexed by `RegionIndex`.
+	 * @param x		The column index of the cell.
+	 * @param y		The row index of the cell.
+	 * @returns		std::span<const count>
+	 */
+	std::span<const count> at(const int& x, const int& y) const { return{ cell(x, y), stride }; }
+
+	/**
+	 * @brief		Get the kind of a cell.
+	 * @param x		The column index of the cell.
+	 * @param y		The row index of the cell.
+	 * @returns		TileKind
+	 */
+	TileKind getKind(const int& x, const int& y) const { return kinds[static_cast<size_t>(y) * gridSize.width + x]; }
+
+	/**
+	 * @brief		Get the region that every pixel of a uniform cell belongs to.
+	 * @param x		The column index of the cell.
+	 * @param y		The row index of the cell.
+	 * @returns		RegionIndex; `ColorLUT::NONE` when the cell isn't uniform.
+	 */
+	RegionIndex getUniformRegion(const int& x, const int& y) const { return uniformRegions[static_cast<size_t>(y) * gridSize.width + x]; }
+
+	/**
+	 * @brief		Get the number of pixels in a cell that belong to any region.
+	 * @param x		The column index of the cell.
+	 * @param y		The row index of the cell.
+	 * @returns		count
+	 */
+	count getMatchedCount(const int& x, const int& y) const { return static_cast<count>(cellSize.area()) - cell(x, y)[ColorLUT::NONE]; }
+
+	/**
+	 * @brief		Check if a cell doesn't contain any recognized region colors.
+	 * @param x		The column index of the cell.
+	 * @param y		The row index of the cell.
+	 * @returns		true when the cell is empty.
+	 */
+	bool empty(const int& x, const int& y) const { return getMatchedCount(x, y) == 0u; }
+
+	/**
+	 * @brief				Get the regions present in a cell that are above a specified threshold.
+	 * @param x				The column index of the cell.
+	 * @param y				The row index of the cell.
+	 * @param out			Output vector that receives the selected region indices. Any previous contents are cleared.
+	 * @param threshold		The threshold percentage _( 0.0 - 1.0, using operation `>=` )_ of pixels that a region must have in order to be returned.
+	 */
+	void getIndices(const int& x, const int& y, std::vector<RegionIndex>& out, const float& threshold = 0.0f) const noexcept(false)
+	{
+		switch (getKind(x, y)) {
+		case TileKind::Empty:
+			out.clear();
+			break;
+		case TileKind::Uniform: // every pixel belongs to one region, which is always above the threshold
+			out.assign(1ull, getUniformRegion(x, y));
+			break;
+		default:
+			PartitionStats::select(at(x, y), cellSize.area(), threshold, out);
+			break;
+		}
+	}
+};
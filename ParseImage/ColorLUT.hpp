@@ -0,0 +1,150 @@
+#pragma once
+#include "Region.hpp"
+#include "PixelKernel.hpp"
+
+#include <make_exception.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+/**
+ * @class	ColorLUT
+ * @brief	Dense lookup table that maps every possible 24-bit color to a `RegionIndex`.
+ *\n		The table is built once from a `RegionTable`, after which each pixel lookup is a single memory load.
+ *\n		With a tolerance, every color within that distance of a region's color is also mapped to the nearest region, so fuzzy matching costs the same per pixel as exact matching.
+ *\n		Whole rows of pixels are classified with `classify()`, which uses the fastest vectorized kernel that the CPU supports.
+ */
+class ColorLUT {
+	std::shared_ptr<const RegionTable> regions;
+	std::vector<RegionIndex> table;
+	unsigned tolerance;
+	kernel::ISA isa;
+	kernel::ClassifyFn classifyFn;
+
+public:
+	/// @brief	The index returned for colors that don't belong to any region.
+	static constexpr RegionIndex NONE{ 0 };
+	/// @brief	The number of entries in the table, one for every possible 24-bit color.
+	static constexpr size_t SIZE{ 1ull << 24 };
+	/// @brief	The largest supported tolerance.
+	static constexpr unsigned MAX_TOLERANCE{ 255u };
+
+	/**
+	 * @brief			Pack a 3-channel color into a 24-bit table key.
+	 * @param b			Blue channel.
+	 * @param g			Green channel.
+	 * @param r			Red channel.
+	 * @returns			unsigned
+	 */
+	static constexpr unsigned key(const uchar& b, const uchar& g, const uchar& r) { return static_cast<unsigned>(b) | (static_cast<unsigned>(g) << 8) | (static_cast<unsigned>(r) << 16); }
+	/**
+	 * @brief			Pack an RGB color into a 24-bit table key.
+	 * @param rgb		Input color.
+	 * @returns			unsigned
+	 */
+	static unsigned key(const RGB& rgb) { return key(rgb.b(), rgb.g(), rgb.r()); }
+
+	/**
+	 * @brief				Build the lookup table from a table of regions.
+	 * @param regionTable	The regions to build the lookup table for. Colors that are shared by multiple regions are assigned to the region with the highest index.
+	 * @param tolerance		The maximum euclidean distance in RGB space between a pixel & a region's color for the pixel to match it. When a pixel is within range of several regions, the nearest one wins, then the one with the highest index. Default is 0, which only matches exact colors.
+	 * @param isa			Optionally force the instruction set used by `classify()`. This is clamped to what the CPU supports. Default is the best supported instruction set.
+	 */
+	ColorLUT(std::shared_ptr<const RegionTable> regionTable, const unsigned& tolerance = 0u, const std::optional<kernel::ISA>& isa = std::nullopt) noexcept(false) :
+		regions{ std::move(regionTable) },
+		table(SIZE + 1ull, NONE), // pad by one entry so that 32-bit gathers of the last key stay in bounds
+		tolerance{ tolerance },
+		isa{ std::min(isa.value_or(kernel::ISA::AVX2), kernel::detect()) },
+		classifyFn{ kernel::get(this->isa) }
+	{
+		if (tolerance > MAX_TOLERANCE)
+			throw make_exception("Color tolerance ", tolerance, " is larger than the maximum of ", MAX_TOLERANCE, '!');
+
+		if (tolerance == 0u) {
+			for (size_t i{ 1ull }; i <= regions->size(); ++i)
+				table[key((*regions)[static_cast<RegionIndex>(i)].color)] = static_cast<RegionIndex>(i);
+			return;
+		}
+
+		// fill the cube around each color, keeping the squared distance of the nearest region seen so far for each entry
+		const int radius{ static_cast<int>(tolerance) }, limit{ radius * radius };
+		std::vector<std::uint16_t> nearest(SIZE, std::numeric_limits<std::uint16_t>::max());
+		for (size_t i{ 1ull }; i <= regions->size(); ++i) {
+			const auto& color{ (*regions)[static_cast<RegionIndex>(i)].color };
+			const int r0{ color.r() }, g0{ color.g() }, b0{ color.b() };
+			for (int r{ std::max(0, r0 - radius) }, rMax{ std::min(255, r0 + radius) }; r <= rMax; ++r) {
+				const int dr2{ (r - r0) * (r - r0) };
+				for (int g{ std::max(0, g0 - radius) }, gMax{ std::min(255, g0 + radius) }; g <= gMax; ++g) {
+					const int drg2{ dr2 + (g - g0) * (g - g0) };
+					if (drg2 > limit)
+						continue;
+					// only the blue channels within the remaining distance are in range
+					int db{ 0 };
+					while ((db + 1) * (db + 1) <= limit - drg2)
+						++db;
+					for (int b{ std::max(0, b0 - db) }, bMax{ std::min(255, b0 + db) }; b <= bMax; ++b) {
+						const auto& k{ key(static_cast<uchar>(b), static_cast<uchar>(g), static_cast<uchar>(r)) };
+						const auto& d2{ static_cast<std::uint16_t>(drg2 + (b - b0) * (b - b0)) };
+						if (d2 <= nearest[k]) {
+							nearest[k] = d2;
+							table[k] = static_cast<RegionIndex>(i);
+						}
+					}
+				}
+			}
+		}
+	}
+	/**
+	 * @brief				Build the lookup table from a vector of regions.
+	 * @param regionVec		Vector of regions to use for building the table.
+	 * @param tolerance		The maximum euclidean distance in RGB space between a pixel & a region's color for the pixel to match it. Default is 0, which only matches exact colors.
+	 * @param isa			Optionally force the instruction set used by `classify()`. This is clamped to what the CPU supports. Default is the best supported instruction set.
+	 */
+	ColorLUT(RegionVec const& regionVec, const unsigned& tolerance = 0u, const std::optional<kernel::ISA>& isa = std::nullopt) noexcept(false) : ColorLUT(std::make_shared<const RegionTable>(regionVec), tolerance, isa) {}
+
+	/**
+	 * @brief		Classify a row of pixels, stored in OpenCV's default Blue-Green-Red channel order.
+	 * @param bgr	Pointer to the first channel of the first pixel.
+	 * @param count	The number of pixels to classify.
+	 * @param out	Output array with room for `count` indices.
+	 */
+	void classify(const uchar* bgr, const size_t& count, RegionIndex* out) const { classifyFn(bgr, count, out, table.data()); }
+
+	/// @brief	Get the maximum distance between a matching pixel & its region's color.
+	unsigned getTolerance() const { return tolerance; }
+
+	/// @brief	Get the instruction set used by `classify()`.
+	kernel::ISA getISA() const { return isa; }
+
+	/**
+	 * @brief		Get the region index of a pixel, stored in OpenCV's default Blue-Green-Red channel order.
+	 * @param bgr	Pointer to the first channel of the pixel.
+	 * @returns		RegionIndex; `NONE` when the color doesn't belong to a region.
+	 */
+	RegionIndex find(const uchar* bgr) const { return table[key(bgr[0], bgr[1], bgr[2])]; }
+	/**
+	 * @brief		Get the region index of an RGB color.
+	 * @param rgb	Input color.
+	 * @returns		RegionIndex; `NONE` when the color doesn't belong to a region.
+	 */
+	RegionIndex find(const RGB& rgb) const { return table[key(rgb)]; }
+
+	/**
+	 * @brief		Get the region associated with an index.
+	 * @param index	A region index returned by `find()`. Must not be `NONE`.
+	 * @returns		const Region&
+	 */
+	const Region& region(const RegionIndex& index) const { return (*regions)[index]; }
+
+	/// @brief	Get the table of regions used to build the lookup table.
+	const RegionTable& getRegionTable() const { return *regions; }
+	/// @brief	Get a shared pointer to the table of regions used to build the lookup table.
+	const std::shared_ptr<const RegionTable>& shareRegionTable() const { return regions; }
+
+	/// @brief	Get the number of regions in the table, not including `NONE`.
+	size_t size() const { return regions->size(); }
+};
@@ -0,0 +1,230 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @namespace	contour
+ * @brief		Boundary tracing for sets of cells.
+ *\n			Cell `(x, y)` covers the square between the corners `(x, y)` and `(x + 1, y + 1)`, with the Y axis pointing up (north).
+ *\n			Outer rings are counter-clockwise and holes are clockwise, so the area of a region is always to the left of its edges.
+ */
+namespace contour {
+	/// @brief	A closed ring of cell corners. The last corner connects back to the first, and is not repeated.
+	using Ring = std::vector<cv::Point>;
+
+	/**
+	 * @struct	Polygon
+	 * @brief	One 4-connected component of cells, described by its outer boundary and the boundaries of any holes in it.
+	 */
+	struct Polygon {
+		Ring outer;
+		std::vector<Ring> holes;
+	};
+
+	/// @brief	Get twice the signed area of a ring; positive for counter-clockwise rings.
+	inline long long signedArea2(const Ring& ring)
+	{
+		long long area{ 0ll };
+		for (size_t i{ 0ull }, j{ ring.size() - 1ull }; i < ring.size(); j = i++)
+			area += static_cast<long long>(ring[j].x) * ring[i].y - static_cast<long long>(ring[i].x) * ring[j].y;
+		return area;
+	}
+
+	namespace _internal {
+		/**
+		 * @class	DenseGrid
+		 * @brief	Values for every position in a bounding box, for sets of cells that fill most of their bounding box.
+		 *\n		The box has a border of 1 position that reads as `T{}`, so that the neighbors of every position inside of it can be read without bounds checks.
+		 */
+		template<typename T>
+		class DenseGrid {
+			cv::Point origin;
+			int width;
+			std::vector<T> values;
+
+			size_t index(const cv::Point& p) const { return static_cast<size_t>(p.y - origin.y) * width + (p.x - origin.x); }
+
+		public:
+			DenseGrid(const cv::Point& min, const cv::Point& max, const size_t&) : origin{ min.x - 1, min.y - 1 }, width{ max.x - min.x + 3 }, values(static_cast<size_t>(width) * (max.y - min.y + 3), T{}) {}
+
+			T get(const cv::Point& p) const { return values[index(p)]; }
+			T& at(const cv::Point& p) { return values[index(p)]; }
+		};
+
+		/**
+		 * @class	SparseGrid
+		 * @brief	Values for only the positions that were written, for sets of cells that are spread thinly over their bounding box.
+		 *\n		Positions that were never written read as `T{}`.
+		 */
+		template<typename T>
+		class SparseGrid {
+			std::unordered_map<std::uint64_t, T> values;
+
+			static std::uint64_t key(const cv::Point& p) { return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(p.x)) << 32) | static_cast<std::uint32_t>(p.y); }
+
+		public:
+			SparseGrid(const cv::Point&, const cv::Point&, const size_t& capacity) { values.reserve(capacity); }
+
+			T get(const cv::Point& p) const
+			{
+				const auto& it{ values.find(key(p)) };
+				return it == values.end() ? T{} : it->second;
+			}
+			T& at(const cv::Point& p) { return values[key(p)]; }
+		};
+
+		/// @brief	Order points from the bottom row to the top row, and from left to right within each row.
+		inline bool bottomUp(const cv::Point& l, const cv::Point& r) { return l.y < r.y || (l.y == r.y && l.x < r.x); }
+
+		/**
+		 * @brief			Trace the boundaries of every 4-connected component in a set of cells.
+		 * @tparam Grid		`DenseGrid` or `SparseGrid`; both produce the same polygons.
+		 * @param cells		The cells to trace, without duplicates & ordered by `bottomUp()`.
+		 * @param labels	A grid where every cell is -1, and every other position is 0. Receives the component label of each cell, starting at 1.
+		 * @param min		The bottom-left corner of the bounding box of the cells.
+		 * @param max		The top-right corner of the bounding box of the cells.
+		 * @returns			One polygon per component.
+		 */
+		template<template<typename> class Grid>
+		std::vector<Polygon> trace(const std::vector<cv::Point>& cells, Grid<std::int32_t>& labels, const cv::Point& min, const cv::Point& max)
+		{
+			// directions, in counter-clockwise order
+			static constexpr int dx[4]{ 1, 0, -1, 0 }, dy[4]{ 0, 1, 0, -1 };
+			// offset from the start of an edge to the cell on its left, for each direction
+			static constexpr int leftX[4]{ 0, -1, -1, 0 }, leftY[4]{ 0, 0, -1, -1 };
+
+			// label every 4-connected component with a flood fill, in the order of each component's first cell
+			std::int32_t componentCount{ 0 };
+			std::vector<cv::Point> stack;
+			for (const auto& cell : cells) {
+				if (labels.get(cell) != -1)
+					continue;
+				labels.at(cell) = ++componentCount;
+				stack.emplace_back(cell);
+				while (!stack.empty()) {
+					const cv::Point p{ stack.back() };
+					stack.pop_back();
+					for (int d{ 0 }; d < 4; ++d) {
+						if (const cv::Point n{ p.x + dx[d], p.y + dy[d] }; labels.get(n) == -1) {
+							labels.at(n) = componentCount;
+							stack.emplace_back(n);
+						}
+					}
+				}
+			}
+
+			// outgoing edges of every corner, as a bitmask of directions; corner (x, y) is the bottom-left corner of cell (x, y)
+			Grid<std::uint8_t> edges{ min, cv::Point{ max.x + 1, max.y + 1 }, cells.size() * 2ull };
+			// every corner with an outgoing edge, which are the only places where a ring can start
+			std::vector<cv::Point> starts;
+			const auto& addEdge{ [&edges, &starts](const cv::Point& corner, const int& dir) {
+				auto& mask{ edges.at(corner) };
+				if (mask == 0u)
+					starts.emplace_back(corner);
+				mask |= static_cast<std::uint8_t>(1u << dir);
+			} };
+			for (const auto& p : cells) {
+				// each side that faces an empty cell is an edge, directed so that the cell is on its left
+				if (labels.get({ p.x, p.y - 1 }) == 0) addEdge(p, 0);
+				if (labels.get({ p.x + 1, p.y }) == 0) addEdge({ p.x + 1, p.y }, 1);
+				if (labels.get({ p.x, p.y + 1 }) == 0) addEdge({ p.x + 1, p.y + 1 }, 2);
+				if (labels.get({ p.x - 1, p.y }) == 0) addEdge({ p.x, p.y + 1 }, 3);
+			}
+			std::sort(starts.begin(), starts.end(), bottomUp);
+
+			// corners where two cells only touch diagonally have two outgoing edges.
+			// preferring to turn left, then to go straight, then to turn right keeps following the cell that the boundary is already wrapped around, so those cells stay apart.
+			const auto& turn{ [](const unsigned& mask, const int& dir) {
+				for (const auto& t : { 1, 0, 3, 2 })
+					if (const int d{ (dir + t) % 4 }; (mask & (1u << d)) != 0u)
+						return d;
+				return dir;
+			} };
+
+			std::vector<Polygon> polygons(static_cast<size_t>(componentCount));
+			std::vector<std::pair<cv::Point, int>> path; //< every corner on the current ring, and the direction leaving it
+			for (const auto& start : starts) {
+				const unsigned startMask{ edges.get(start) };
+				if (startMask == 0u)
+					continue; //< already part of a ring
+
+				// corners are visited bottom-up, so the first corner of each ring is never one where cells touch diagonally, and only has one outgoing edge
+				const int startDir{ std::countr_zero(startMask) };
+				const auto& label{ labels.get({ start.x + leftX[startDir], start.y + leftY[startDir] }) };
+
+				path.clear();
+				cv::Point p{ start };
+				int dir{ startDir };
+				do {
+					auto& out{ edges.at(p) };
+					dir = turn(out, dir);
+					out &= static_cast<std::uint8_t>(~(1u << dir));
+					path.emplace_back(p, dir);
+					p = { p.x + dx[dir], p.y + dy[dir] };
+					// a ring may pass through its first corner twice, so it is only closed once it would continue along its first edge
+				} while (p != start || turn(edges.get(start) | (1u << startDir), dir) != startDir);
+
+				// only keep corners where the direction changes
+				Ring ring;
+				for (size_t i{ 0ull }; i < path.size(); ++i)
+					if (path[i].second != path[(i + path.size() - 1ull) % path.size()].second)
+						ring.emplace_back(path[i].first);
+
+				auto& polygon{ polygons[static_cast<size_t>(label) - 1ull] };
+				if (signedArea2(ring) > 0ll)
+					polygon.outer = std::move(ring);
+				else polygon.holes.emplace_back(std::move(ring));
+			}
+			return polygons;
+		}
+	}
+
+	/**
+	 * @brief			Trace the boundaries of every 4-connected component in a set of cells.
+	 *\n				Only the cells themselves & the corners on their boundaries are visited, so this runs in O(n log n) time for n cells no matter how they are spread out, and emits only the corners where the boundary changes direction.
+	 *\n				Cells that fill most of their bounding box are looked up in a dense grid, and any other cells in a hash table.
+	 * @param cells		The cells to trace. Duplicates are ignored.
+	 * @returns			One polygon per component, ordered by the position of each component's bottom-left-most cell.
+	 */
+	inline std::vector<Polygon> trace(std::span<const cv::Point> cells)
+	{
+		if (cells.empty())
+			return{};
+
+		cv::Point min{ cells.front() }, max{ cells.front() };
+		for (const auto& p : cells) {
+			min.x = std::min(min.x, p.x);
+			min.y = std::min(min.y, p.y);
+			max.x = std::max(max.x, p.x);
+			max.y = std::max(max.y, p.y);
+		}
+
+		std::vector<cv::Point> sorted;
+		sorted.reserve(cells.size());
+		// the dense grid is only used while its size is within a constant factor of the number of cells, so scanning it to order the cells is still linear
+		if (const std::int64_t boxArea{ (static_cast<std::int64_t>(max.x) - min.x + 1) * (static_cast<std::int64_t>(max.y) - min.y + 1) }; boxArea <= static_cast<std::int64_t>(cells.size()) * 4 + 1024) {
+			_internal::DenseGrid<std::int32_t> labels{ min, max, cells.size() };
+			for (const auto& p : cells)
+				labels.at(p) = -1;
+			for (int y{ min.y }; y <= max.y; ++y)
+				for (int x{ min.x }; x <= max.x; ++x)
+					if (labels.get({ x, y }) != 0)
+						sorted.emplace_back(x, y);
+			return _internal::trace(sorted, labels, min, max);
+		}
+
+		sorted.assign(cells.begin(), cells.end());
+		std::sort(sorted.begin(), sorted.end(), _internal::bottomUp);
+		sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+		_internal::SparseGrid<std::int32_t> labels{ min, max, sorted.size() };
+		for (const auto& p : sorted)
+			labels.at(p) = -1;
+		return _internal::trace(sorted, labels, min, max);
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/**
+ * @namespace	hash
+ * @brief		Fast non-cryptographic hashing, used to detect changes in image data & configs between runs.
+ */
+namespace hash {
+	namespace _internal {
+		inline constexpr std::uint64_t P1{ 0x9E3779B185EBCA87ull }, P2{ 0xC2B2AE3D27D4EB4Full }, P3{ 0x165667B19E3779F9ull }, P4{ 0x85EBCA77C2B2AE63ull }, P5{ 0x27D4EB2F165667C5ull };
+
+		inline constexpr std::uint64_t rotl(const std::uint64_t& v, const int& n) { return (v << n) | (v >> (64 - n)); }
+		inline constexpr std::uint64_t round(const std::uint64_t& acc, const std::uint64_t& input) { return rotl(acc + input * P2, 31) * P1; }
+		inline constexpr std::uint64_t merge(const std::uint64_t& acc, const std::uint64_t& v) { return (acc ^ round(0ull, v)) * P1 + P4; }
+
+		// the hash is defined for little-endian values, so this assumes a little-endian target
+		inline std::uint64_t read64(const unsigned char* p) { std::uint64_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+		inline std::uint32_t read32(const unsigned char* p) { std::uint32_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+	}
+
+	/**
+	 * @brief		Calculate the XXH64 hash of a block of memory.
+	 * @param data	Pointer to the first byte.
+	 * @param len	The number of bytes to hash.
+	 * @param seed	Seed value. Pass the hash of a previous block to chain blocks together.
+	 * @returns		std::uint64_t
+	 */
+	inline std::uint64_t xxh64(const void* data, const size_t& len, const std::uint64_t& seed = 0ull)
+	{
+		using namespace _internal;
+		const unsigned char* p{ static_cast<const unsigned char*>(data) };
+		const unsigned char* const end{ p + len };
+		std::uint64_t h;
+
+		if (len >= 32ull) {
+			std::uint64_t v1{ seed + P1 + P2 }, v2{ seed + P2 }, v3{ seed }, v4{ seed - P1 };
+			for (const unsigned char* const limit{ end - 32 }; p <= limit; p += 32) {
+				v1 = round(v1, read64(p));
+				v2 = round(v2, read64(p + 8));
+				v3 = round(v3, read64(p + 16));
+				v4 = round(v4, read64(p + 24));
+			}
+			h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+			h = merge(h, v1);
+			h = merge(h, v2);
+			h = merge(h, v3);
+			h = merge(h, v4);
+		}
+		else h = seed + P5;
+
+		h += static_cast<std::uint64_t>(len);
+
+		for (; p + 8 <= end; p += 8)
+			h = rotl(h ^ round(0ull, read64(p)), 27) * P1 + P4;
+		if (p + 4 <= end) {
+			h = rotl(h ^ (static_cast<std::uint64_t>(read32(p)) * P1), 23) * P2 + P3;
+			p += 4;
+		}
+		for (; p < end; ++p)
+			h = rotl(h ^ (*p * P5), 11) * P1;
+
+		h ^= h >> 33;
+		h *= P2;
+		h ^= h >> 29;
+		h *= P3;
+		h ^= h >> 32;
+		return h;
+	}
+	/**
+	 * @brief		Calculate the XXH64 hash of a string.
+	 * @param str	Input string.
+	 * @param seed	Seed value.
+	 * @returns		std::uint64_t
+	 */
+	inline std::uint64_t xxh64(const std::string_view& str, const std::uint64_t& seed = 0ull) { return xxh64(str.data(), str.size(), seed); }
+}
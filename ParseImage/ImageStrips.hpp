@@ -0,0 +1,143 @@
+#pragma once
+#include "StripReader.hpp"
+#include "LabelImage.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <make_exception.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+
+/**
+ * @class	ImageStrips
+ * @brief	Provides the strips of an image to consumers that may run concurrently, such as the rows of `CellMapper::run()`.
+ *\n		When a `StripReader` can decode the image, each strip is decoded into its own buffer only when it is requested, and is released as soon as its consumer drops it, so the whole image is never in memory.
+ *\n		Other formats are loaded whole by OpenCV, converted to a `LabelImage` once, and the colors are released right away; each strip is then a view of the label image.
+ */
+class ImageStrips {
+	using CLK = std::chrono::steady_clock;
+
+	std::unique_ptr<StripReader> reader;
+	/// @brief	The region of every pixel, when the image isn't decoded one strip at a time.
+	LabelImage labels;
+	cv::Size imageSize;
+	int stripHeight;
+
+	std::mutex mtx;
+	std::condition_variable ready;
+	/// @brief	The index of the next strip to decode.
+	int next{ 0 };
+	/// @brief	Set when a strip fails to decode, so that requests for later strips fail instead of waiting forever.
+	bool failed{ false };
+	double decodeSeconds{ 0.0 }, convertSeconds{ 0.0 };
+
+public:
+	/**
+	 * @brief				Open an image file.
+	 * @param path			The location of the image file.
+	 * @param stripHeight	The number of rows in each strip.
+	 * @param lut			The regions to label the pixels of an image that is loaded whole with.
+	 * @param stream		When true, the image must be decodable by a `StripReader`; otherwise images that it can't decode are loaded whole.
+	 * @param pool			Optional thread pool to label an image that is loaded whole on.
+	 */
+	ImageStrips(const std::filesystem::path& path, const int& stripHeight, const ColorLUT& lut, const bool& stream = false, ThreadPool* pool = nullptr) noexcept(false) : stripHeight{ stripHeight }
+	{
+		if (stripHeight <= 0)
+			throw make_exception("Invalid strip height ", stripHeight, '!');
+		try {
+			reader = StripReader::open(path);
+			imageSize = reader->size();
+		} catch (const std::exception&) {
+			if (stream)
+				throw;
+			cv::Mat image{ cv::imread(path.string()) };
+			if (image.empty())
+				throw make_exception("Failed to load image file ", path, '!');
+			imageSize = image.size();
+
+			const auto& t_start{ CLK::now() };
+			labels = LabelImage{ image, lut, pool };
+			convertSeconds = std::chrono::duration<double>(CLK::now() - t_start).count();
+		}
+	}
+
+	/// @brief	Check if the image is decoded one strip at a time, rather than loaded whole.
+	bool streamed() const { return reader != nullptr; }
+
+	/// @brief	Get the size of the whole image, in pixels.
+	cv::Size size() const { return imageSize; }
+
+	/// @brief	Get the label image of an image that was loaded whole. Empty when the image is streamed.
+	const LabelImage& getLabels() const { return labels; }
+
+	/// @brief	Get the time spent decoding strips, in seconds. Doesn't include loading an image that isn't streamed.
+	double getDecodeSeconds() const { return decodeSeconds; }
+
+	/// @brief	Get the time spent converting an image that was loaded whole to labels, in seconds.
+	double getConvertSeconds() const { return convertSeconds; }
+
+	/**
+	 * @brief	Get one strip of the image.
+	 *\n		When the image is streamed, strips are decoded in order: each strip must be requested exactly once, and a request waits until every earlier strip has been decoded.
+	 *\n		Requests may come from several threads, as long as the strip before each one is always requested too. `ThreadPool::parallel_for()` claims indices in ascending order, so each of its iterations can request its own strip.
+	 * @param y	The index of the strip, starting from the top of the image.
+	 * @returns	The rows ( y * stripHeight ) - ( ( y + 1 ) * stripHeight ) of the image, as 3-channel BGR pixels when streamed, or as labels otherwise.
+	 */
+	cv::Mat get(const int& y) noexcept(false)
+	{
+		if (reader == nullptr)
+			return labels.rowRange(y * stripHeight, (y + 1) * stripHeight);
+
+		std::unique_lock lock{ mtx };
+		ready.wait(lock, [&] { return next >= y || failed; });
+		if (failed)
+			throw make_exception("Can't read the image strip for row ", y, " because an earlier strip failed!");
+		if (next != y)
+			throw make_exception("The image strip for row ", y, " was already read!");
+
+		cv::Mat strip;
+		const auto& t_start{ CLK::now() };
+		try {
+			if (!reader->read(strip, stripHeight))
+				throw make_exception("Failed to read the image strip for row ", y, '!');
+		} catch (...) {
+			failed = true;
+			ready.notify_all();
+			throw;
+		}
+		decodeSeconds += std::chrono::duration<double>(CLK::now() - t_start).count();
+		++next;
+		lock.unlock();
+		ready.notify_all();
+		return strip;
+	}
+
+	/**
+	 * @brief	Get the rows below the last whole strip, which are fewer than one strip tall.
+	 *\n		When the image is streamed, this must be called after every whole strip was requested with `get()`.
+	 * @returns	The rows ( stripCount * stripHeight ) - height of the image, in the same format as `get()`; or an empty image when its height is a multiple of the strip height.
+	 */
+	cv::Mat remainder() noexcept(false)
+	{
+		const int stripCount{ imageSize.height / stripHeight }, rows{ imageSize.height % stripHeight };
+		if (rows == 0)
+			return{};
+		if (reader == nullptr)
+			return labels.rowRange(stripCount * stripHeight, imageSize.height);
+
+		std::scoped_lock lock{ mtx };
+		if (failed || next != stripCount)
+			throw make_exception("The rows below the last image strip can only be read after every strip!");
+
+		cv::Mat strip;
+		const auto& t_start{ CLK::now() };
+		if (!reader->read(strip, rows))
+			throw make_exception("Failed to read the last ", rows, " rows of the image!");
+		decodeSeconds += std::chrono::duration<double>(CLK::now() - t_start).count();
+		++next;
+		return strip;
+	}
+};
@@ -0,0 +1,211 @@
+#pragma once
+#include "ColorLUT.hpp"
+#include "Logger.hpp"
+#include "Region.hpp"
+#include "RunStats.hpp"
+#include "Validation.hpp"
+#include "config.hpp"
+
+#include <make_exception.hpp>
+#include <fileio.hpp>
+#include <INIRedux.hpp>
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @struct	Job
+ * @brief	Everything needed to parse one image & write its output files.
+ *\n		Jobs come either from the command line, or from one section of a batch manifest.
+ */
+struct Job {
+	/// @brief	The filename (not extension) of the output files.
+	std::string worldspace;
+	/// @brief	The image to parse.
+	std::filesystem::path image;
+	/// @brief	The INI config files to read the regions from, in the order that they are merged.
+	std::vector<std::filesystem::path> inis;
+	/// @brief	The size of one cell, in pixels.
+	std::optional<cv::Size> partSize;
+	/// @brief	The threshold percentage _( 0.0 - 1.0 )_ of pixels that a region must have in a cell in order to be assigned to it.
+	float threshold{ 0.0f };
+	/// @brief	The directory to write the output files to.
+	std::filesystem::path outDir;
+};
+
+/**
+ * @struct	RegionConfig
+ * @brief	A merged set of INI config files, and the region table & color lookup built from it.
+ */
+struct RegionConfig {
+	file::MINI ini;
+	std::shared_ptr<const RegionTable> regionTable;
+	ColorLUT lut;
+};
+
+/**
+ * @brief						Read & merge a set of INI config files, then validate the regions and build their `ColorLUT`.
+ * @param inis					The INI config files, in the order that they are merged.
+ * @param nearColorDistance		Regions whose colors are within this distance of each other are logged as warnings. 0 disables this check.
+ * @param tolerance				The color tolerance of the `ColorLUT`.
+ * @param logger				Logger to write progress & warnings to.
+ * @param stats					Receives the time spent loading, validating & building the lookup.
+ * @returns						std::shared_ptr<const RegionConfig>
+ */
+inline std::shared_ptr<const RegionConfig> loadRegionConfig(const std::vector<std::filesystem::path>& inis, const unsigned& nearColorDistance, const unsigned& tolerance, Logger& logger, RunStats& stats) noexcept(false)
+{
+	std::optional<RunStats::Scope> iniLoadTime{ std::in_place, stats, "ini_load" };
+
+	file::MINI ini;
+	for (const auto& path : inis) {
+		if (!file::exists(path))
+			throw make_exception("Filepath '", path.generic_string(), "' doesn't exist!");
+		logger.info() << "Reading region config at '" << path.generic_string() << "'.\n";
+		ini.read(path);
+	}
+
+	if (ini.empty())
+		throw make_exception("Failed to retrieve any valid data from the provided INI config files!");
+
+	const auto& regionTable{ std::make_shared<const RegionTable>(cfg::getRegions(ini, logger)) };
+	iniLoadTime.reset();
+
+	const auto& nearColors{ stats.timed("validation", [&] {
+		ValidateRegionVec(regionTable->getRegions(), logger);
+		return FindNearColors(regionTable->getRegions(), nearColorDistance);
+	}) };
+	logger.info() << "Successfully validated the region config." << std::endl;
+	for (const auto& [first, second] : nearColors) {
+		const auto& a{ regionTable->getRegions()[first] }, & b{ regionTable->getRegions()[second] };
+		logger.warn() << term::get_warn() << "Region '" << a << "' ( " << a.color << " ) & region '" << b << "' ( " << b.color << " ) have very similar colors, which may be confused by anti-aliasing." << std::endl;
+	}
+
+	ColorLUT lut{ stats.timed("lut_build", [&] { return ColorLUT{ regionTable, tolerance }; }) };
+	return std::make_shared<const RegionConfig>(RegionConfig{ std::move(ini), regionTable, std::move(lut) });
+}
+
+/**
+ * @class	RegionConfigCache
+ * @brief	Loads each distinct set of INI config files only once, so that jobs with identical configs share one region table & `ColorLUT`.
+ *\n		Sets are identified by the canonical path of each file, in merge order.
+ */
+class RegionConfigCache {
+	std::mutex mtx;
+	std::map<std::vector<std::filesystem::path>, std::shared_ptr<const RegionConfig>> configs;
+	unsigned nearColorDistance;
+	unsigned tolerance;
+
+public:
+	/**
+	 * @brief						Constructor.
+	 * @param nearColorDistance		Regions whose colors are within this distance of each other are logged as warnings. 0 disables this check.
+	 * @param tolerance				The color tolerance of every `ColorLUT`.
+	 */
+	RegionConfigCache(const unsigned& nearColorDistance, const unsigned& tolerance) : nearColorDistance{ nearColorDistance }, tolerance{ tolerance } {}
+
+	/**
+	 * @brief			Get the config for a set of INI files, loading it if it wasn't already loaded.
+	 * @param inis		The INI config files, in the order that they are merged.
+	 * @param logger	Logger to write progress & warnings to.
+	 * @param stats		Receives the time spent loading the config, when it isn't already loaded.
+	 * @returns			std::shared_ptr<const RegionConfig>
+	 */
+	std::shared_ptr<const RegionConfig> get(const std::vector<std::filesystem::path>& inis, Logger& logger, RunStats& stats) noexcept(false)
+	{
+		std::vector<std::filesystem::path> key;
+		key.reserve(inis.size());
+		for (const auto& path : inis)
+			key.emplace_back(std::filesystem::weakly_canonical(path));
+
+		std::scoped_lock lock{ mtx };
+		auto& config{ configs[key] };
+		if (config == nullptr)
+			config = loadRegionConfig(inis, nearColorDistance, tolerance, logger, stats);
+		return config;
+	}
+
+	/// @brief	Get the number of distinct configs that were loaded.
+	size_t size() const { return configs.size(); }
+};
+
+/**
+ * @brief			Read a batch manifest, where each section describes one job.
+ *\n				The name of each section is the worldspace name of its job, and the following keys are supported:
+ *\n				- `file`		The image to parse. Required.
+ *\n				- `ini`			The INI config files, separated by `;`. Defaults to `defaults.inis`.
+ *\n				- `dim`			The size of one cell, as `<X>:<Y>`. Defaults to `defaults.partSize`.
+ *\n				- `threshold`	The threshold percentage _( 0 - 100 )_. Defaults to `defaults.threshold`.
+ *\n				- `out`			The output directory. Defaults to `defaults.outDir`.
+ *\n				Relative paths are relative to the directory that contains the manifest.
+ * @param path		The location of the manifest file.
+ * @param defaults	Values to use for keys that a section doesn't specify. Its worldspace & image are ignored.
+ * @returns			std::vector<Job>
+ */
+inline std::vector<Job> readManifest(const std::filesystem::path& path, const Job& defaults) noexcept(false)
+{
+	if (!file::exists(path))
+		throw make_exception("Batch manifest '", path.generic_string(), "' doesn't exist!");
+
+	file::MINI manifest;
+	manifest.read(path);
+
+	const auto& trim{ [](const std::string& str) {
+		const auto& first{ str.find_first_not_of(" \t") };
+		return first == std::string::npos ? std::string{} : str.substr(first, str.find_last_not_of(" \t") - first + 1ull);
+	} };
+	const auto& dir{ path.parent_path() };
+	const auto& resolve{ [&dir, &trim](const std::string& str) {
+		const std::filesystem::path p{ trim(str) };
+		return p.is_relative() ? dir / p : p;
+	} };
+
+	std::vector<Job> jobs;
+	jobs.reserve(manifest.size());
+	for (const auto& [name, sect] : manifest) {
+		Job& job{ jobs.emplace_back(defaults) };
+		job.worldspace = name;
+
+		if (const auto& image{ sect.get("file") }; image.has_value())
+			job.image = resolve(image.value());
+		else throw make_exception("Batch job '", name, "' doesn't specify a 'file'!");
+
+		if (const auto& inis{ sect.get("ini") }; inis.has_value()) {
+			job.inis.clear();
+			std::stringstream ss{ inis.value() };
+			for (std::string ini; std::getline(ss, ini, ';');)
+				if (!trim(ini).empty())
+					job.inis.emplace_back(resolve(ini));
+		}
+
+		if (const auto& dim{ sect.get("dim") }; dim.has_value()) {
+			const auto& [xstr, ystr] { str::split(dim.value(), ":,") };
+			if (xstr.empty() || ystr.empty() || !std::all_of(xstr.begin(), xstr.end(), isdigit) || !std::all_of(ystr.begin(), ystr.end(), isdigit))
+				throw make_exception("Batch job '", name, "' has an invalid 'dim' value '", dim.value(), "'!");
+			job.partSize = cv::Size{ str::stoi(xstr), str::stoi(ystr) };
+		}
+
+		if (const auto& threshold{ sect.get("threshold") }; threshold.has_value()) {
+			if (threshold.value().empty() || !std::all_of(threshold.value().begin(), threshold.value().end(), isdigit))
+				throw make_exception("Batch job '", name, "' has an invalid 'threshold' value '", threshold.value(), "'! (Only digits are allowed)");
+			job.threshold = static_cast<float>(str::stoi(threshold.value())) / 100.0f;
+		}
+
+		if (const auto& out{ sect.get("out") }; out.has_value())
+			job.outDir = resolve(out.value());
+
+		if (!job.partSize.has_value())
+			throw make_exception("Batch job '", name, "' doesn't specify a 'dim', and no default was set with '-d'/'--dim'!");
+		if (job.inis.empty())
+			throw make_exception("Batch job '", name, "' doesn't specify any 'ini' files, and no defaults were found!");
+	}
+	return jobs;
+}
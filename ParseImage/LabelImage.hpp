@@ -0,0 +1,175 @@
+#pragma once
+#include "ColorLUT.hpp"
+#include "RegionRaster.hpp"
+#include "ThreadPool.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <make_exception.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class	LabelImage
+ * @brief	Single-channel image of `RegionIndex` values, where 0 is `ColorLUT::NONE`.
+ *\n		Pixels are stored in 8 bits when there are fewer than 256 regions, and in 16 bits otherwise, so the image is 3 to 1.5 times smaller than the BGR image that it was converted from.
+ *\n		Everything downstream of decoding only needs to know which region each pixel belongs to, so the color image can be released as soon as it is converted.
+ */
+class LabelImage {
+	cv::Mat labels;
+
+public:
+	/**
+	 * @brief				Get the OpenCV type of label images for a number of regions.
+	 * @param regionCount	The number of regions, not including `ColorLUT::NONE`.
+	 * @returns				`CV_8UC1` or `CV_16UC1`
+	 */
+	static int typeFor(const size_t& regionCount) { return regionCount <= std::numeric_limits<uchar>::max() ? CV_8UC1 : CV_16UC1; }
+
+	/**
+	 * @brief			Convert rows of BGR pixels to labels.
+	 * @param bgr		A 3-channel BGR image.
+	 * @param lut		Reference of the `ColorLUT` to use when checking pixels.
+	 * @param out		Receives the labels. It is reallocated unless it already has the same size as `bgr` and the type returned by `typeFor()`.
+	 * @param pool		Optional thread pool to convert rows on.
+	 */
+	static void convert(const cv::Mat& bgr, const ColorLUT& lut, cv::Mat& out, ThreadPool* pool = nullptr) noexcept(false)
+	{
+		if (bgr.type() != CV_8UC3)
+			throw make_exception("Label images can only be converted from 3-channel BGR images!");
+
+		out.create(bgr.rows, bgr.cols, typeFor(lut.size()));
+		const size_t width{ static_cast<size_t>(bgr.cols) };
+
+		const auto& convertRow{ [&](const size_t& i) {
+			const int y{ static_cast<int>(i) };
+			if (out.depth() == CV_16U)
+				lut.classify(bgr.ptr<uchar>(y), width, out.ptr<RegionIndex>(y));
+			else {
+				thread_local std::vector<RegionIndex> indices;
+				indices.resize(width);
+				lut.classify(bgr.ptr<uchar>(y), width, indices.data());
+				std::transform(indices.begin(), indices.end(), out.ptr<uchar>(y), [](const RegionIndex& index) { return static_cast<uchar>(index); });
+			}
+		} };
+
+		if (pool != nullptr)
+			pool->parallel_for(static_cast<size_t>(bgr.rows), convertRow);
+		else for (size_t y{ 0ull }; y < static_cast<size_t>(bgr.rows); ++y)
+			convertRow(y);
+	}
+
+	/// @brief	Default Constructor.
+	LabelImage() = default;
+	/**
+	 * @brief			Convert a BGR image to labels.
+	 * @param bgr		A 3-channel BGR image. It can be released as soon as this returns.
+	 * @param lut		Reference of the `ColorLUT` to use when checking pixels.
+	 * @param pool		Optional thread pool to convert rows on.
+	 */
+	LabelImage(const cv::Mat& bgr, const ColorLUT& lut, ThreadPool* pool = nullptr) noexcept(false) { convert(bgr, lut, labels, pool); }
+	/**
+	 * @brief			Decode a region raster file to labels.
+	 *\n				Regions are matched to `regions` by editor ID, since the raster may have been written with a different region config.
+	 * @param raster	A region raster file, as written by `RasterEncoder`.
+	 * @param regions	The regions that the labels will refer to.
+	 * @param unmatched	Optional list that receives the editor ID of every region of the raster that isn't in `regions`. Its pixels are decoded as `ColorLUT::NONE`.
+	 * @param pool		Optional thread pool to decode rows on.
+	 */
+	LabelImage(const raster::Reader& raster, const RegionTable& regions, std::vector<std::string>* unmatched = nullptr, ThreadPool* pool = nullptr) noexcept(false)
+	{
+		if (raster.width() > static_cast<std::uint32_t>(std::numeric_limits<int>::max()) || raster.height() > static_cast<std::uint32_t>(std::numeric_limits<int>::max()))
+			throw make_exception("The region raster ( ", raster.width(), " x ", raster.height(), " ) is too large!");
+
+		std::unordered_map<std::string_view, RegionIndex> indexOf;
+		indexOf.reserve(regions.size());
+		for (RegionIndex index{ 1 }; index <= regions.size(); ++index)
+			indexOf.try_emplace(regions[index].editorID, index);
+
+		// raster region index => region index
+		std::vector<RegionIndex> remap(static_cast<size_t>(raster.regionCount()) + 1ull, ColorLUT::NONE);
+		for (std::uint32_t i{ 1u }; i <= raster.regionCount(); ++i) {
+			const auto& editorID{ raster.editorID(static_cast<std::uint16_t>(i)) };
+			if (const auto& it{ indexOf.find(editorID) }; it != indexOf.end())
+				remap[i] = it->second;
+			else if (unmatched != nullptr)
+				unmatched->emplace_back(editorID);
+		}
+
+		labels.create(static_cast<int>(raster.height()), static_cast<int>(raster.width()), typeFor(regions.size()));
+		const auto& decodeRow{ [&](const size_t& i) {
+			const int y{ static_cast<int>(i) };
+			if (labels.depth() == CV_16U) {
+				RegionIndex* out{ labels.ptr<RegionIndex>(y) };
+				for (const auto& run : raster.row(static_cast<std::uint32_t>(y)))
+					out = std::fill_n(out, run.length, remap[run.region]);
+			}
+			else {
+				uchar* out{ labels.ptr<uchar>(y) };
+				for (const auto& run : raster.row(static_cast<std::uint32_t>(y)))
+					out = std::fill_n(out, run.length, static_cast<uchar>(remap[run.region]));
+			}
+		} };
+
+		if (pool != nullptr)
+			pool->parallel_for(static_cast<size_t>(labels.rows), decodeRow);
+		else for (size_t y{ 0ull }; y < static_cast<size_t>(labels.rows); ++y)
+			decodeRow(y);
+	}
+
+	/// @brief	Check if the image doesn't contain any pixels.
+	bool empty() const { return labels.empty(); }
+	/// @brief	Get the size of the image, in pixels.
+	cv::Size size() const { return labels.size(); }
+	/// @brief	Get the underlying single-channel image.
+	const cv::Mat& mat() const { return labels; }
+	/// @brief	Get the number of bytes used by the pixels.
+	size_t bytes() const { return labels.total() * labels.elemSize(); }
+
+	/**
+	 * @brief		Get a range of rows, without copying.
+	 * @param start	The first row, inclusive.
+	 * @param end	The last row, exclusive.
+	 * @returns		cv::Mat
+	 */
+	cv::Mat rowRange(const int& start, const int& end) const { return labels.rowRange(start, end); }
+
+	/**
+	 * @brief			Convert an area of the image back to BGR pixels for display, using the color of each region.
+	 * @param labels	A single-channel label image, or part of one.
+	 * @param regions	The regions that the labels refer to.
+	 * @param none		The color of pixels that don't belong to any region.
+	 * @returns			cv::Mat
+	 */
+	static cv::Mat colorize(const cv::Mat& labels, const RegionTable& regions, const RGB& none = RGB{ 0, 0, 0 })
+	{
+		std::vector<RGB> palette{ none };
+		palette.reserve(regions.size() + 1ull);
+		for (const auto& region : regions.getRegions())
+			palette.emplace_back(region.color);
+
+		cv::Mat bgr(labels.rows, labels.cols, CV_8UC3);
+		for (int y{ 0 }; y < labels.rows; ++y) {
+			uchar* px{ bgr.ptr<uchar>(y) };
+			for (int x{ 0 }; x < labels.cols; ++x, px += 3) {
+				const size_t index{ static_cast<size_t>(labels.depth() == CV_16U ? labels.ptr<RegionIndex>(y)[x] : labels.ptr<uchar>(y)[x]) };
+				const RGB& color{ index < palette.size() ? palette[index] : none };
+				px[0] = color.b();
+				px[1] = color.g();
+				px[2] = color.r();
+			}
+		}
+		return bgr;
+	}
+	/**
+	 * @brief			Convert an area of this image back to BGR pixels for display, using the color of each region.
+	 * @param area		The area to convert.
+	 * @param regions	The regions that the labels refer to.
+	 * @returns			cv::Mat
+	 */
+	cv::Mat colorize(const cv::Rect& area, const RegionTable& regions) const { return colorize(labels(area), regions); }
+};
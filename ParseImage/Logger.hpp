@@ -0,0 +1,164 @@
+#pragma once
+#include "RingBuffer.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+
+/// @brief	Log verbosity levels, from least to most verbose.
+enum class LogLevel : unsigned char {
+	Error,
+	Warning,
+	Info,
+	Debug,
+};
+
+/**
+ * @class	Logger
+ * @brief	Asynchronous leveled logger.
+ *\n		Records are formatted on the calling thread only when their level is enabled, then pushed into a lock-free `RingBuffer`.
+ *\n		A background thread drains the buffer into the output stream, so callers never wait for the stream itself.
+ *\n		When the buffer is full, `Debug` records are dropped so that hot loops never stall; every other level waits for room instead.
+ */
+class Logger {
+	struct Entry {
+		LogLevel level{ LogLevel::Info };
+		std::string text;
+	};
+
+	LogLevel level;
+	std::ostream& sink;
+	RingBuffer<Entry> buffer;
+	/// @brief	Incremented whenever there is something new for the writer thread to do.
+	std::atomic<std::uint64_t> signal{ 0ull };
+	std::atomic<std::uint64_t> pushed{ 0ull };
+	std::atomic<std::uint64_t> written{ 0ull };
+	std::atomic<std::uint64_t> dropped{ 0ull };
+	std::jthread writer;
+
+	void work(std::stop_token stoken)
+	{
+		Entry entry;
+		for (;;) {
+			const auto& seen{ signal.load(std::memory_order_acquire) };
+			std::uint64_t count{ 0ull };
+			while (buffer.try_pop(entry)) {
+				sink << entry.text;
+				++count;
+			}
+			if (count != 0ull) {
+				sink.flush();
+				written.fetch_add(count, std::memory_order_release);
+				written.notify_all();
+			}
+			else if (stoken.stop_requested())
+				return;
+			else signal.wait(seen, std::memory_order_acquire);
+		}
+	}
+
+public:
+	/**
+	 * @class	Record
+	 * @brief	A single log message that is pushed to its `Logger` when it goes out of scope.
+	 *\n		Streaming into a record of a disabled level does nothing, and doesn't format its arguments.
+	 */
+	class Record {
+		Logger* logger;
+		LogLevel level;
+		std::ostringstream ss;
+
+	public:
+		Record(Logger* logger, const LogLevel& level) : logger{ logger }, level{ level } {}
+		Record(Record&& o) noexcept : logger{ std::exchange(o.logger, nullptr) }, level{ o.level }, ss{ std::move(o.ss) } {}
+		~Record()
+		{
+			if (logger != nullptr)
+				logger->push(level, ss.str());
+		}
+
+		template<typename T>
+		Record& operator<<(const T& value)
+		{
+			if (logger != nullptr)
+				ss << value;
+			return *this;
+		}
+		Record& operator<<(std::ostream& (*manip)(std::ostream&))
+		{
+			if (logger != nullptr)
+				ss << manip;
+			return *this;
+		}
+	};
+
+	/**
+	 * @brief			Constructor.
+	 * @param level		The most verbose level to write.
+	 * @param sink		The stream to write records to. Must outlive the logger, and must not be written to directly while the logger exists.
+	 * @param capacity	The maximum number of records that can be waiting to be written.
+	 */
+	Logger(const LogLevel& level, std::ostream& sink, const size_t& capacity = 8192ull) : level{ level }, sink{ sink }, buffer{ capacity }, writer{ [this](std::stop_token stoken) { work(stoken); } } {}
+	/// @brief	Destructor. Writes every remaining record, then stops the writer thread.
+	~Logger() noexcept
+	{
+		flush();
+		if (const auto& count{ dropped.load() }; count != 0ull)
+			push(LogLevel::Warning, std::to_string(count) + " debug log records were dropped because they were logged faster than they could be written.\n");
+		writer.request_stop();
+		signal.fetch_add(1ull, std::memory_order_release);
+		signal.notify_one();
+		writer.join();
+	}
+
+	Logger(const Logger&) = delete;
+	Logger& operator=(const Logger&) = delete;
+
+	/// @brief	Check if records of a given level are written.
+	bool enabled(const LogLevel& lvl) const { return lvl <= level; }
+
+	/**
+	 * @brief		Push a record that has already been formatted.
+	 * @param lvl	The level of the record. Nothing happens if it isn't enabled.
+	 * @param text	The text of the record, including any trailing newline.
+	 */
+	void push(const LogLevel& lvl, std::string&& text)
+	{
+		if (!enabled(lvl) || text.empty())
+			return;
+		Entry entry{ lvl, std::move(text) };
+		while (!buffer.try_push(std::move(entry))) {
+			if (lvl == LogLevel::Debug) {
+				dropped.fetch_add(1ull, std::memory_order_relaxed);
+				return;
+			}
+			std::this_thread::yield();
+		}
+		pushed.fetch_add(1ull, std::memory_order_relaxed);
+		signal.fetch_add(1ull, std::memory_order_release);
+		signal.notify_one();
+	}
+
+	/**
+	 * @brief		Start a new record.
+	 * @param lvl	The level of the record.
+	 * @returns		Record that is pushed when it goes out of scope.
+	 */
+	Record operator()(const LogLevel& lvl) { return{ enabled(lvl) ? this : nullptr, lvl }; }
+	Record error() { return (*this)(LogLevel::Error); }
+	Record warn() { return (*this)(LogLevel::Warning); }
+	Record info() { return (*this)(LogLevel::Info); }
+	Record debug() { return (*this)(LogLevel::Debug); }
+
+	/// @brief	Wait until every record that was pushed before this call has been written.
+	void flush()
+	{
+		const auto& target{ pushed.load(std::memory_order_relaxed) };
+		for (auto done{ written.load(std::memory_order_acquire) }; done < target; done = written.load(std::memory_order_acquire))
+			written.wait(done, std::memory_order_acquire);
+	}
+};
@@ -0,0 +1,188 @@
+#pragma once
+#include "CellMapper.hpp"
+#include "RegionAreaMap.hpp"
+#include "TMap.hpp"
+
+#include <make_exception.hpp>
+
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @namespace	maptext
+ * @brief		Writer of the text map file (`<worldspace>.map.txt`).
+ *\n			The whole file is formatted into one string whose capacity is reserved up front, with integers formatted by `std::to_chars` instead of iostreams, and then written in a single call.
+ *
+ *\n			Sections, in order:
+ *\n			- `[RegionAreas]`	`EditorID = [(x,y), ...], ...` with every ring of every polygon of a region. Outer rings are counter-clockwise & holes are clockwise.
+ *\n			- `[HoldMap]`		`(x,y) = [ "EditorID", ... ]` with the regions assigned to each cell.
+ *\n			- `[WinnerMap]`		`(x,y) = "EditorID"` with the region that wins each cell by priority. Only written when requested.
+ */
+namespace maptext {
+	/// @brief	The maximum number of characters in a formatted `int`, including the sign.
+	inline constexpr size_t MAX_INT_CHARS{ 11ull };
+
+	/**
+	 * @class	Buffer
+	 * @brief	Appends text to a string whose capacity was reserved up front.
+	 */
+	class Buffer {
+		std::string text;
+
+	public:
+		/// @param capacity	The number of characters to reserve. Appending more than this reallocates, so it should be an upper bound.
+		explicit Buffer(const size_t& capacity) { text.reserve(capacity); }
+
+		Buffer& operator<<(const char& c)
+		{
+			text.push_back(c);
+			return *this;
+		}
+		Buffer& operator<<(const std::string_view& s)
+		{
+			text.append(s);
+			return *this;
+		}
+		Buffer& operator<<(const int& value)
+		{
+			char digits[MAX_INT_CHARS];
+			text.append(digits, std::to_chars(digits, digits + MAX_INT_CHARS, value).ptr);
+			return *this;
+		}
+		/// @brief	Append a point, in the `x,y` format of `operator<<(std::ostream&, const cv::Point&)`.
+		Buffer& operator<<(const cv::Point& p) { return *this << p.x << ',' << p.y; }
+
+		/// @brief	Take the formatted text.
+		std::string release() { return std::move(text); }
+	};
+
+	/// @brief	Append every ring of every polygon, separated by commas.
+	inline void appendPolygons(Buffer& buf, const std::vector<contour::Polygon>& polygons)
+	{
+		const auto& appendRing{ [&buf](const contour::Ring& ring) {
+			buf << '[';
+			for (size_t i{ 0ull }; i < ring.size(); ++i) {
+				if (i != 0ull)
+					buf << std::string_view{ ", " };
+				buf << '(' << ring[i] << ')';
+			}
+			buf << ']';
+		} };
+
+		bool first{ true };
+		for (const auto& polygon : polygons) {
+			if (!first)
+				buf << std::string_view{ ", " };
+			appendRing(polygon.outer);
+			for (const auto& hole : polygon.holes) {
+				buf << std::string_view{ ", " };
+				appendRing(hole);
+			}
+			first = false;
+		}
+	}
+
+	/**
+	 * @brief				Format the results of parsing an image as the text map file.
+	 * @param regions		The table of regions that the results refer to.
+	 * @param gridSize		The number of cells along each axis.
+	 * @param regionAreas	The outline polygons of each region.
+	 * @param holdMap		The regions assigned to each cell, by cell coordinate.
+	 * @param winners		Optional winning region of each cell, in row-major order of grid index. When this is `nullptr`, the `[WinnerMap]` section is omitted.
+	 * @returns				The contents of the file.
+	 */
+	inline std::string serialize(const RegionTable& regions, const cv::Size& gridSize, const RegionAreaMap& regionAreas, const HoldMap& holdMap, const RegionIndexVec* winners = nullptr) noexcept(false)
+	{
+		if (winners != nullptr && winners->size() != static_cast<size_t>(gridSize.area()))
+			throw make_exception("The winner grid ( ", winners->size(), " cells ) doesn't match the cell grid ( ", gridSize.area(), " cells )!");
+
+		// an upper bound of the size of the file, so that the buffer never reallocates
+		constexpr size_t pointChars{ 2ull * MAX_INT_CHARS + 1ull }, cellPrefixChars{ pointChars + 6ull }; //< "x,y" & "(x,y) = "
+		size_t capacity{ 64ull };
+		for (const auto& [index, polygons] : regionAreas) {
+			capacity += regions[index].editorID.size() + 4ull;
+			for (const auto& polygon : polygons) {
+				capacity += (polygon.outer.size() + 1ull) * (pointChars + 4ull) + 4ull;
+				for (const auto& hole : polygon.holes)
+					capacity += (hole.size() + 1ull) * (pointChars + 4ull) + 4ull;
+			}
+		}
+		for (const auto& [pos, indices] : holdMap) {
+			capacity += cellPrefixChars + 5ull;
+			for (const auto& index : indices)
+				capacity += regions[index].editorID.size() + 4ull;
+		}
+		if (winners != nullptr) {
+			for (const auto& winner : *winners)
+				if (winner != ColorLUT::NONE)
+					capacity += cellPrefixChars + regions[winner].editorID.size() + 3ull;
+		}
+
+		Buffer buf{ capacity };
+		buf << std::string_view{ "[RegionAreas]\n" };
+		for (const auto& [index, polygons] : regionAreas) {
+			buf << std::string_view{ regions[index].editorID } << std::string_view{ " = " };
+			appendPolygons(buf, polygons);
+			buf << '\n';
+		}
+
+		buf << std::string_view{ "\n[HoldMap]\n" };
+		for (const auto& [pos, indices] : holdMap) {
+			buf << '(' << pos << std::string_view{ ") = [ " };
+			for (size_t i{ 0ull }; i < indices.size(); ++i) {
+				if (i != 0ull)
+					buf << std::string_view{ ", " };
+				buf << '"' << std::string_view{ regions[indices[i]].editorID } << '"';
+			}
+			buf << std::string_view{ " ]\n" };
+		}
+
+		if (winners != nullptr) {
+			buf << std::string_view{ "\n[WinnerMap]\n" };
+			// the axes of cell coordinates are independent, so each column & row is only translated once
+			std::vector<int> cellX(static_cast<size_t>(gridSize.width)), cellY(static_cast<size_t>(gridSize.height));
+			for (int x{ 0 }; x < gridSize.width; ++x)
+				cellX[x] = offsetCellCoordinates(cv::Point{ x, 0 }).x;
+			for (int y{ 0 }; y < gridSize.height; ++y)
+				cellY[y] = offsetCellCoordinates(cv::Point{ 0, y }).y;
+
+			const RegionIndex* winner{ winners->data() };
+			for (int y{ 0 }; y < gridSize.height; ++y)
+				for (int x{ 0 }; x < gridSize.width; ++x, ++winner)
+					if (*winner != ColorLUT::NONE)
+						buf << '(' << cellX[x] << ',' << cellY[y] << std::string_view{ ") = \"" } << std::string_view{ regions[*winner].editorID } << std::string_view{ "\"\n" };
+		}
+		return buf.release();
+	}
+
+	/**
+	 * @brief		Write text to a file in a single call, without any newline translation.
+	 * @param path	The location of the output file. It is overwritten if it already exists.
+	 * @param text	The contents of the file.
+	 * @returns		true when successful.
+	 */
+	inline bool writeFile(const std::filesystem::path& path, const std::string_view& text)
+	{
+		std::ofstream ofs{ path, std::ios_base::binary | std::ios_base::trunc };
+		return ofs.is_open() && ofs.write(text.data(), static_cast<std::streamsize>(text.size()));
+	}
+
+	/**
+	 * @brief				Write the results of parsing an image to a text map file.
+	 * @param path			The location of the output file. It is overwritten if it already exists.
+	 * @param regions		The table of regions that the results refer to.
+	 * @param gridSize		The number of cells along each axis.
+	 * @param regionAreas	The outline polygons of each region.
+	 * @param holdMap		The regions assigned to each cell, by cell coordinate.
+	 * @param winners		Optional winning region of each cell, in row-major order of grid index. When this is `nullptr`, the `[WinnerMap]` section is omitted.
+	 * @returns				true when successful.
+	 */
+	inline bool write(const std::filesystem::path& path, const RegionTable& regions, const cv::Size& gridSize, const RegionAreaMap& regionAreas, const HoldMap& holdMap, const RegionIndexVec* winners = nullptr) noexcept(false)
+	{
+		return writeFile(path, serialize(regions, gridSize, regionAreas, holdMap, winners));
+	}
+}
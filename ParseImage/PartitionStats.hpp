@@ -2,10 +2,12 @@
 #include "Region.hpp"
 #include "config.hpp"
 #include "TMap.hpp"
+#include "ColorLUT.hpp"
 
 #include <color-transform.hpp>
 
-#include <unordered_map>
+#include <span>
+#include <vector>
 
 /**
  * @brief		Convert from OpenCV's BGR pixel color format to RGB.
@@ -18,52 +20,77 @@ struct PartitionStats {
 	using count = unsigned;
 private:
 	cv::Size partSize{ 0, 0 };
-	std::map<Region, count> pxCount;
+	/// @brief	Pixel counts indexed by `RegionIndex`. Index 0 (`ColorLUT::NONE`) counts pixels that don't belong to any region.
+	std::vector<count> pxCount;
+	/// @brief	Scratch buffer that receives the region index of each pixel in a row.
+	std::vector<RegionIndex> indices;
+	count matched{ 0u };
 	bool is_valid{ false };
 
+public:
+	/**
+	 * @brief				Select the regions from a histogram of pixel counts that are above a specified threshold.
+	 * @param counts		Pixel counts indexed by `RegionIndex`.
+	 * @param totalPixels	The total number of pixels that were counted, including unmatched pixels.
+	 * @param threshold		The threshold percentage _( 0.0 - 1.0, using operation `>=` )_ of pixels that a region must have in order to be selected.
+	 * @param out			Output vector that receives the selected region indices. Any previous contents are cleared.
+	 */
+	static void select(std::span<const count> counts, const int& totalPixels, const float& threshold, std::vector<RegionIndex>& out) noexcept(false)
+	{
+		if (threshold < 0.0f || threshold > 1.0f)
+			throw make_exception("Invalid threshold value '", threshold, "' is out-of-range: ( 0.0 - 1.0 )!");
+		out.clear();
+		const float totalPixelCount{ static_cast<float>(totalPixels) };
+		for (size_t i{ 1ull }; i < counts.size(); ++i)
+			if (const auto& count{ counts[i] }; count > 0u && (static_cast<float>(count) / totalPixelCount) >= threshold)
+				out.emplace_back(static_cast<RegionIndex>(i));
+	}
+
+	/// @brief	Default Constructor.
+	PartitionStats() = default;
 	/**
-	 * @brief			Parse an image partition using the given `ColorMap`, and save the results internally.
-	 * @param part		An rvalue of the image partition to parse.
-	 * @param colormap	Reference of the `ColorMap` to use when checking pixels.
+	 * @brief			Constructor that calls the `parse()` function automatically. Documentation for `parse()`:
+	 *\n				Parse an image partition using the given `ColorLUT`, and save the results internally.
+	 * @param part		The image partition to parse.
+	 * @param lut		Reference of the `ColorLUT` to use when checking pixels.
 	 */
-	static PartitionStats parse(cv::Mat&& part, const ColorMap& colormap) noexcept(false)
+	PartitionStats(cv::Mat&& part, const ColorLUT& lut)
 	{
-		PartitionStats stats;
+		parse(std::forward<cv::Mat>(part), lut);
+	}
 
-		if (stats.partSize = { std::forward<cv::Mat>(part).cols, std::forward<cv::Mat>(part).rows }; stats.partSize.width > 0 && stats.partSize.height > 0)
-			stats.is_valid = true;
-		else return stats;
+	/**
+	 * @brief			Parse an image partition using the given `ColorLUT`, and save the results internally.
+	 *\n				Any previous results are discarded; the counter storage is reused so that parsing many partitions with the same object doesn't allocate.
+	 * @param part		The image partition to parse.
+	 * @param lut		Reference of the `ColorLUT` to use when checking pixels.
+	 */
+	void parse(const cv::Mat& part, const ColorLUT& lut) noexcept(false)
+	{
+		pxCount.assign(lut.size() + 1ull, 0u);
+		matched = 0u;
+
+		if (partSize = { part.cols, part.rows }; partSize.width > 0 && partSize.height > 0)
+			is_valid = true;
+		else {
+			is_valid = false;
+			return;
+		}
 
 		if (const auto& channels{ part.channels() }; channels != 3)
 			throw make_exception("Loaded image with an incorrect number of color channels!");
 
 		const auto& rows{ part.rows }, & cols{ part.cols };
 
-		for (int y{ 0 }; y < rows; ++y) {
-			for (int x{ 0 }; x < cols; ++x) {
-				RGB color{ Vec3b_to_RGB(std::move(std::forward<cv::Mat>(part).at<cv::Vec3b>(cv::Point{ x, y }))) };
+		indices.resize(static_cast<size_t>(cols));
 
-				if (const auto& mapped{ colormap.find(color) }; mapped != colormap.end())
-					++stats.pxCount[mapped->second];
-				else continue;
-			}
+		for (int y{ 0 }; y < rows; ++y) {
+			lut.classify(part.ptr<uchar>(y), indices.size(), indices.data());
+			for (const auto& index : indices)
+				++pxCount[index];
 		}
 
-		return stats;
-	}
-
-public:
-	/// @brief	Default Constructor.
-	PartitionStats() = default;
-	/**
-	 * @brief			Constructor that calls the `parse()` function automatically. Documentation for `parse()`:
-	 *\n				Parse an image partition using the given `ColorMap`, and save the results internally.
-	 * @param part		The image partition to parse.
-	 * @param colormap	Reference of the `ColorMap` to use when checking pixels.
-	 */
-	PartitionStats(cv::Mat&& part, const ColorMap& colormap)
-	{
-		*this = PartitionStats::parse(std::forward<cv::Mat>(part), colormap);
+		matched = static_cast<count>(partSize.area()) - pxCount[ColorLUT::NONE];
 	}
 
 	/**
@@ -77,70 +104,74 @@ public:
 	 * @attention	This will always return true if the partition isn't valid, be sure to check that as well!
 	 * @returns		true when the partition doesn't contain any recognized region colors.
 	 */
-	bool empty() const { return pxCount.empty(); }
+	bool empty() const { return matched == 0u; }
 
-	/// @brief	Get an iterator to the beginning of the `pxCount` container.
-	auto begin() const { return pxCount.begin(); }
-	/// @brief	Get an iterator to the end of the `pxCount` container.
-	auto end() const { return pxCount.end(); }
+	/// @brief	Get the number of pixels in the partition that belong to any region.
+	count getMatchedCount() const { return matched; }
+	/// @brief	Get the number of pixels in the partition that don't belong to any region.
+	count getUnmatchedCount() const { return pxCount.empty() ? 0u : pxCount[ColorLUT::NONE]; }
+
+	/// @brief	Get a view of the raw pixel counts, indexed by `RegionIndex`.
+	std::span<const count> getCounts() const { return pxCount; }
 
 	/**
 	 * @brief			Check if the partition contains a region.
-	 * @param region	The `Region` to check for.
+	 * @param index		The `RegionIndex` to check for.
 	 * @returns			true when the partition DOES contain the given region.
 	 */
-	bool contains(Region const& region) const { return pxCount.contains(region); }
+	bool contains(const RegionIndex& index) const { return getCount(index) > 0u; }
 
 	/**
 	 * @brief			Get the number of pixels in the partition that match the specified region.
-	 * @param region	The `Region` to check for.
+	 * @param index		The `RegionIndex` to check for.
 	 * @returns			count
 	 */
-	count getCount(Region const& region) const
+	count getCount(const RegionIndex& index) const
 	{
-		if (const auto& it{ pxCount.find(region) }; it != pxCount.end())
-			return it->second;
+		if (index != ColorLUT::NONE && index < pxCount.size())
+			return pxCount[index];
 		else return 0u;
 	}
 
 	/**
 	 * @brief			Get the percentage of pixels in the partition that match the given region.
-	 * @param region	The `Region` to check for.
+	 * @param index		The `RegionIndex` to check for.
 	 * @returns			float between 0.0 (0%) and 1.0 (100%)
 	 */
-	float getPercentage(Region const& region) const { return static_cast<float>(getCount(region)) / static_cast<float>(partSize.width * partSize.height); }
+	float getPercentage(const RegionIndex& index) const { return static_cast<float>(getCount(index)) / static_cast<float>(partSize.width * partSize.height); }
+
+	/**
+	 * @brief				Get the regions present in this partition that are above a specified threshold, without allocating when `out` already has enough capacity.
+	 * @param out			Output vector that receives the indices of all regions with a higher percentage of pixels than the given threshold. Any previous contents are cleared.
+	 * @param threshold		The threshold percentage _( 0.0 - 1.0, using operation `>=` )_ of pixels that a region must have in order to be returned.
+	 */
+	void getIndices(std::vector<RegionIndex>& out, const float& threshold = 0.0f) const noexcept(false)
+	{
+		select(pxCount, partSize.area(), threshold, out);
+	}
 
 	/**
 	 * @brief				Get the regions present in this partition that are above a specified threshold.
 	 * @param threshold		The threshold percentage _( 0.0 - 1.0, using operation `>=` )_ of pixels that a region must have in order to be returned.
-	 * @returns				RegionList containing all regions with a higher percentage of pixels than the given threshold.
+	 * @returns				Vector containing the indices of all regions with a higher percentage of pixels than the given threshold.
 	 */
-	std::vector<Region> getRegions(const float& threshold = 0.0f) const noexcept(false)
+	std::vector<RegionIndex> getIndices(const float& threshold = 0.0f) const noexcept(false)
 	{
-		if (threshold < 0.0f || threshold > 1.0f)
-			throw make_exception("Invalid threshold value '", threshold, "' is out-of-range: ( 0.0 - 1.0 )!");
-		const float totalPixelCount{ static_cast<float>(partSize.width * partSize.height) };
-		std::vector<Region> vec;
-		vec.reserve(pxCount.size());
-		for (const auto& [region, count] : pxCount)
-			if ((static_cast<float>(count) / totalPixelCount) >= threshold)
-				vec.emplace_back(region);
-		vec.shrink_to_fit();
+		std::vector<RegionIndex> vec;
+		getIndices(vec, threshold);
 		return vec;
 	}
 
 	/**
 	 * @brief	Retrieve a list of every region with at least one matching pixel present in the partition.
-	 * @returns RegionList
+	 * @returns Vector containing region indices.
 	 */
-	std::vector<Region> getAllRegions() const
+	std::vector<RegionIndex> getAllIndices() const
 	{
-		std::vector<Region> vec;
-		vec.reserve(pxCount.size());
-		for (const auto& [region, _] : pxCount)
-			vec.emplace_back(region);
-		vec.shrink_to_fit();
+		std::vector<RegionIndex> vec;
+		for (size_t i{ 1ull }; i < pxCount.size(); ++i)
+			if (pxCount[i] > 0u)
+				vec.emplace_back(static_cast<RegionIndex>(i));
 		return vec;
 	}
 };
-
@@ -0,0 +1,172 @@
+#pragma once
+#include "Region.hpp"
+
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PARSEIMG_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC allows intrinsics from any instruction set without per-function target attributes
+#define PARSEIMG_TARGET(isa)
+#else
+#define PARSEIMG_TARGET(isa) __attribute__((target(isa)))
+#endif
+#else
+#define PARSEIMG_X86 0
+#endif
+
+/**
+ * @namespace	kernel
+ * @brief		Pixel classification kernels that convert rows of 3-channel BGR pixels to `RegionIndex` values.
+ *\n			Every kernel produces exactly the same output as `classify_scalar()`, which is checked by `tests/test_kernels.cpp`; the vectorized kernels are selected at runtime depending on what the CPU supports.
+ */
+namespace kernel {
+	/// @brief	Instruction sets that a classification kernel can be built for.
+	enum class ISA : uchar {
+		Scalar,
+		SSE42,
+		AVX2,
+	};
+
+	/// @brief	Get the display name of an instruction set.
+	inline constexpr const char* getName(const ISA& isa)
+	{
+		switch (isa) {
+		case ISA::AVX2:
+			return "AVX2";
+		case ISA::SSE42:
+			return "SSE4.2";
+		default:
+			return "Scalar";
+		}
+	}
+
+	/**
+	 * @brief			Signature shared by all kernels.
+	 * @param bgr		Pointer to the first channel of the first pixel.
+	 * @param count		The number of pixels to classify.
+	 * @param out		Output array with room for `count` indices.
+	 * @param table		Dense lookup table with one entry for every 24-bit key, plus one padding entry.
+	 */
+	using ClassifyFn = void(*)(const uchar* bgr, size_t count, RegionIndex* out, const RegionIndex* table);
+
+	/// @brief	Pack a pixel stored in Blue-Green-Red channel order into a 24-bit key.
+	inline constexpr unsigned pack(const uchar* bgr) { return static_cast<unsigned>(bgr[0]) | (static_cast<unsigned>(bgr[1]) << 8) | (static_cast<unsigned>(bgr[2]) << 16); }
+
+	/// @brief	Reference kernel that looks up every pixel in the table.
+	inline void classify_scalar(const uchar* bgr, size_t count, RegionIndex* out, const RegionIndex* table)
+	{
+		for (size_t i{ 0ull }; i < count; ++i, bgr += 3)
+			out[i] = table[pack(bgr)];
+	}
+
+#if PARSEIMG_X86
+	/// @brief	SSE4.2 kernel; deinterleaves 4 pixels at a time into 32-bit keys, and classifies runs of identical pixels with a single lookup.
+	PARSEIMG_TARGET("sse4.2") inline void classify_sse42(const uchar* bgr, size_t count, RegionIndex* out, const RegionIndex* table)
+	{
+		// moves each 3-byte pixel into the low bytes of a 32-bit lane, zeroing the high byte
+		const __m128i shuffle{ _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1) };
+
+		size_t i{ 0ull };
+		// each iteration reads 16 bytes, so stop while at least 16 bytes (6 pixels) remain
+		for (; i + 6ull <= count; i += 4ull) {
+			const __m128i keys{ _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bgr + i * 3ull)), shuffle) };
+
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(keys, _mm_shuffle_epi32(keys, 0))) == 0xFFFF) { // all 4 pixels have the same color
+				const RegionIndex index{ table[static_cast<unsigned>(_mm_cvtsi128_si32(keys))] };
+				out[i] = out[i + 1ull] = out[i + 2ull] = out[i + 3ull] = index;
+				continue;
+			}
+
+			// there is no gather instruction, so look the keys up individually
+			alignas(16) unsigned k[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(k), keys);
+			out[i] = table[k[0]];
+			out[i + 1ull] = table[k[1]];
+			out[i + 2ull] = table[k[2]];
+			out[i + 3ull] = table[k[3]];
+		}
+
+		classify_scalar(bgr + i * 3ull, count - i, out + i, table);
+	}
+
+	/// @brief	AVX2 kernel; deinterleaves 8 pixels at a time into 32-bit keys, classifies runs of identical pixels with a single lookup, and uses gather instructions for everything else.
+	PARSEIMG_TARGET("avx2") inline void classify_avx2(const uchar* bgr, size_t count, RegionIndex* out, const RegionIndex* table)
+	{
+		const __m256i shuffle{ _mm256_setr_epi8(
+			0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+			0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1
+		) };
+		const __m256i lowMask{ _mm256_set1_epi32(0xFFFF) };
+
+		size_t i{ 0ull };
+		// each iteration reads 16 bytes at offsets 0 & 12, so stop while at least 28 bytes (10 pixels) remain
+		for (; i + 10ull <= count; i += 8ull) {
+			const uchar* px{ bgr + i * 3ull };
+			const __m256i keys{ _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(px))), _mm_loadu_si128(reinterpret_cast<const __m128i*>(px + 12)), 1), shuffle) };
+
+			if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(keys, _mm256_broadcastd_epi32(_mm256_castsi256_si128(keys)))) == -1) { // all 8 pixels have the same color
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_set1_epi16(static_cast<short>(table[static_cast<unsigned>(_mm256_cvtsi256_si32(keys))])));
+				continue;
+			}
+
+			// each gather reads 32 bits starting at the 16-bit entry, which is why the table is padded by one entry
+			const __m256i index{ _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(table), keys, 2), lowMask) };
+			// packus works within 128-bit lanes, so move the two packed halves next to each other before storing them
+			const __m256i packed{ _mm256_permute4x64_epi64(_mm256_packus_epi32(index, index), 0xD8) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(packed));
+		}
+
+		classify_scalar(bgr + i * 3ull, count - i, out + i, table);
+	}
+#endif
+
+	/// @brief	Get the best instruction set supported by the current CPU.
+	inline ISA detect()
+	{
+#if PARSEIMG_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 0);
+		const int maxLeaf{ info[0] };
+		__cpuid(info, 1);
+		const bool sse42{ (info[2] & (1 << 20)) != 0 }, osxsave{ (info[2] & (1 << 27)) != 0 }, avx{ (info[2] & (1 << 28)) != 0 };
+		if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+			__cpuidex(info, 7, 0);
+			if ((info[1] & (1 << 5)) != 0)
+				return ISA::AVX2;
+		}
+		if (sse42)
+			return ISA::SSE42;
+#else
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			return ISA::AVX2;
+		if (__builtin_cpu_supports("sse4.2"))
+			return ISA::SSE42;
+#endif
+#endif
+		return ISA::Scalar;
+	}
+
+	/**
+	 * @brief		Get the kernel for an instruction set.
+	 * @param isa	The instruction set to use. This must be supported by the current CPU!
+	 * @returns		ClassifyFn
+	 */
+	inline ClassifyFn get(const ISA& isa)
+	{
+		switch (isa) {
+#if PARSEIMG_X86
+		case ISA::AVX2:
+			return classify_avx2;
+		case ISA::SSE42:
+			return classify_sse42;
+#endif
+		default:
+			return classify_scalar;
+		}
+	}
+}
@@ -0,0 +1,266 @@
+#pragma once
+#include "BinaryMap.hpp"
+#include "BinaryMapWriter.hpp"
+
+#include <make_exception.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <vector>
+
+/**
+ * @class	QueryIndex
+ * @brief	Resident copy of the results of parsing an image, for answering cell & point lookups.
+ *\n		The results are kept in the binary map format, so an index built from a parse & one loaded from a `<worldspace>.map.bin` file behave identically.
+ *\n		Cell lookups index directly into the cell grid.
+ *\n		Point lookups use a uniform grid of buckets over the polygon edges. Each bucket stores the edges that pass through it, and the regions that a horizontal ray from its right side is inside of,
+ *\n		so a lookup only tests the few edges in the bucket that contains the point.
+ */
+class QueryIndex {
+	/// @brief	A polygon edge that isn't horizontal, since horizontal edges never cross the horizontal rays used by point lookups.
+	struct Edge {
+		double x0, y0, x1, y1;
+		std::uint16_t region;
+		/// @brief	The columns of the buckets that the edge passes through.
+		std::int32_t firstCol, lastCol;
+	};
+
+	std::vector<std::byte> bytes;
+	binmap::Reader reader;
+
+	std::vector<Edge> edges;
+	/// @brief	The position of the bottom-left corner of the first bucket.
+	double originX{ 0.0 }, originY{ 0.0 };
+	/// @brief	The width of one bucket, in cell units. Buckets are always 1 unit tall, so that no vertex is ever strictly inside of a row, and every edge in a row crosses all of it.
+	double bucketWidth{ 1.0 };
+	std::int32_t cols{ 0 }, rows{ 0 };
+	/// @brief	The edges of the bucket at column `x` & row `y` are in the range `[ bucketOffsets[i], bucketOffsets[i + 1] )` of `bucketEdges`, where `i = y * cols + x`.
+	std::vector<std::uint32_t> bucketOffsets, bucketEdges;
+	/// @brief	The regions that a ray from the right side of each bucket is inside of, indexed the same way as the edges.
+	std::vector<std::uint32_t> insideOffsets;
+	std::vector<std::uint16_t> insideRegions;
+
+	std::int32_t column(const double& x) const { return static_cast<std::int32_t>(std::floor((x - originX) / bucketWidth)); }
+	std::int32_t row(const double& y) const { return static_cast<std::int32_t>(std::floor(y - originY)); }
+
+	/// @brief	Sort a list of regions, and keep only the ones that appear in it an odd number of times.
+	static void keepOdd(std::vector<std::uint16_t>& vec)
+	{
+		std::sort(vec.begin(), vec.end());
+		auto it{ vec.begin() };
+		for (auto read{ vec.begin() }; read != vec.end();) {
+			const auto& run{ std::find_if(read, vec.end(), [&read](const std::uint16_t& index) { return index != *read; }) };
+			if ((run - read) % 2 != 0)
+				*it++ = *read;
+			read = run;
+		}
+		vec.erase(it, vec.end());
+	}
+
+	/// @brief	Sort the edges of every polygon into buckets, then find the regions to the right of each bucket.
+	void buildEdgeGrid()
+	{
+		double minX{ HUGE_VAL }, minY{ HUGE_VAL }, maxX{ -HUGE_VAL }, maxY{ -HUGE_VAL };
+		for (std::uint16_t index{ 1u }; index <= reader.regionCount(); ++index) {
+			for (const auto& polygon : reader.polygons(index)) {
+				for (std::uint32_t r{ polygon.firstRing }; r < polygon.firstRing + polygon.ringCount; ++r) {
+					const auto& ring{ reader.ring(r) };
+					for (size_t i{ 0ull }, j{ ring.size() - 1ull }; i < ring.size(); j = i++) {
+						if (ring[i].y == ring[j].y)
+							continue;
+						const Edge& e{ edges.emplace_back(Edge{ static_cast<double>(ring[j].x), static_cast<double>(ring[j].y), static_cast<double>(ring[i].x), static_cast<double>(ring[i].y), index, 0, 0 }) };
+						minX = std::min({ minX, e.x0, e.x1 });
+						minY = std::min({ minY, e.y0, e.y1 });
+						maxX = std::max({ maxX, e.x0, e.x1 });
+						maxY = std::max({ maxY, e.y0, e.y1 });
+					}
+				}
+			}
+		}
+		if (edges.empty())
+			return;
+
+		// rows are as tall as a cell, and buckets are widened until they hold a few edges each on average
+		size_t rowSpans{ 0ull };
+		for (const auto& e : edges)
+			rowSpans += static_cast<size_t>(std::abs(e.y1 - e.y0));
+		originX = minX;
+		originY = minY;
+		rows = static_cast<std::int32_t>(maxY - minY);
+		bucketWidth = std::max(1.0, std::floor(4.0 * (maxX - minX) * rows / static_cast<double>(rowSpans)));
+		cols = column(maxX) + 1;
+
+		// an edge from y0 to y1 is crossed by rays in the rows from min(y0, y1) up to, but not including, max(y0, y1)
+		const auto& forEachBucket{ [this](Edge& e, const auto& func) {
+			e.firstCol = column(std::min(e.x0, e.x1));
+			e.lastCol = column(std::max(e.x0, e.x1));
+			for (std::int32_t y{ row(std::min(e.y0, e.y1)) }, yEnd{ row(std::max(e.y0, e.y1)) }; y < yEnd; ++y)
+				for (std::int32_t x{ e.firstCol }; x <= e.lastCol; ++x)
+					func(static_cast<size_t>(y) * cols + x);
+		} };
+		const size_t bucketCount{ static_cast<size_t>(cols) * rows };
+		bucketOffsets.assign(bucketCount + 1ull, 0u);
+		for (auto& e : edges)
+			forEachBucket(e, [this](const size_t& i) { ++bucketOffsets[i + 1ull]; });
+		for (size_t i{ 1ull }; i < bucketOffsets.size(); ++i)
+			bucketOffsets[i] += bucketOffsets[i - 1ull];
+		bucketEdges.resize(bucketOffsets.back());
+		std::vector<std::uint32_t> next(bucketOffsets.begin(), bucketOffsets.end() - 1);
+		for (std::uint32_t i{ 0u }; i < edges.size(); ++i)
+			forEachBucket(edges[i], [&](const size_t& b) { bucketEdges[next[b]++] = i; });
+
+		// sweep each row from right to left; the edges that start in the next column are the only ones that change which regions the ray is inside of
+		std::vector<std::vector<std::uint16_t>> inside(bucketCount);
+		std::vector<std::uint16_t> toggled;
+		for (std::int32_t y{ 0 }; y < rows; ++y) {
+			for (std::int32_t x{ cols - 2 }; x >= 0; --x) {
+				const size_t b{ static_cast<size_t>(y) * cols + x };
+				toggled.clear();
+				for (std::uint32_t i{ bucketOffsets[b + 1ull] }; i < bucketOffsets[b + 2ull]; ++i)
+					if (const Edge& e{ edges[bucketEdges[i]] }; e.firstCol == x + 1)
+						toggled.emplace_back(e.region);
+				keepOdd(toggled);
+				std::set_symmetric_difference(inside[b + 1ull].begin(), inside[b + 1ull].end(), toggled.begin(), toggled.end(), std::back_inserter(inside[b]));
+			}
+		}
+		insideOffsets.reserve(bucketCount + 1ull);
+		insideOffsets.emplace_back(0u);
+		for (const auto& regions : inside) {
+			insideRegions.insert(insideRegions.end(), regions.begin(), regions.end());
+			insideOffsets.emplace_back(static_cast<std::uint32_t>(insideRegions.size()));
+		}
+	}
+
+public:
+	/// @brief	The width & height of one exterior cell, in world units.
+	static constexpr double UNITS_PER_CELL{ 4096.0 };
+
+	/**
+	 * @brief			Index a binary map file.
+	 * @param buffer	The entire contents of a binary map file.
+	 */
+	explicit QueryIndex(std::vector<std::byte>&& buffer) noexcept(false) : bytes{ std::move(buffer) }, reader{ bytes } { buildEdgeGrid(); }
+	/**
+	 * @brief				Index the results of parsing an image.
+	 * @param regions		The table of regions that the results refer to.
+	 * @param gridSize		The number of cells along each axis.
+	 * @param regionAreas	The outline polygons of each region.
+	 * @param holdMap		The regions assigned to each cell, by cell coordinate.
+	 * @param winners		The winning region of each cell, in row-major order of grid index.
+	 */
+	QueryIndex(const RegionTable& regions, const cv::Size& gridSize, const RegionAreaMap& regionAreas, const HoldMap& holdMap, const RegionIndexVec& winners) noexcept(false) : QueryIndex(binmap::serialize(regions, gridSize, regionAreas, holdMap, winners)) {}
+
+	// the reader refers to the buffer of this instance
+	QueryIndex(const QueryIndex&) = delete;
+	QueryIndex& operator=(const QueryIndex&) = delete;
+
+	/**
+	 * @brief		Check if a file starts with the magic bytes of a binary map file.
+	 * @param path	The location of the file.
+	 * @returns		true if the file is a binary map file, otherwise false.
+	 */
+	static bool isBinaryMap(const std::filesystem::path& path)
+	{
+		std::ifstream ifs{ path, std::ios_base::binary };
+		char magic[sizeof(binmap::MAGIC)]{};
+		return ifs.read(magic, sizeof(magic)) && std::memcmp(magic, binmap::MAGIC, sizeof(magic)) == 0;
+	}
+
+	/**
+	 * @brief		Read the contents of a binary map file, to pass to the constructor.
+	 * @param path	The location of a `<worldspace>.map.bin` file.
+	 * @returns		std::vector<std::byte>
+	 */
+	static std::vector<std::byte> readFile(const std::filesystem::path& path) noexcept(false)
+	{
+		std::ifstream ifs{ path, std::ios_base::binary };
+		if (!ifs.is_open())
+			throw make_exception("Failed to open binary map file '", path.generic_string(), "'!");
+		std::vector<std::byte> buffer(static_cast<size_t>(std::filesystem::file_size(path)));
+		if (!ifs.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size())))
+			throw make_exception("Failed to read binary map file '", path.generic_string(), "'!");
+		return buffer;
+	}
+
+	/// @brief	Get the underlying binary map.
+	const binmap::Reader& getReader() const { return reader; }
+	/// @brief	Get the contents of the underlying binary map, which are identical to a `<worldspace>.map.bin` file.
+	std::span<const std::byte> data() const { return bytes; }
+	/// @brief	Get the number of regions. Valid region indices are in the range ( 1 - regionCount() ).
+	std::uint32_t regionCount() const { return reader.regionCount(); }
+
+	/**
+	 * @brief	Get the regions assigned to a cell.
+	 * @param x	The X-axis cell coordinate.
+	 * @param y	The Y-axis cell coordinate.
+	 * @returns	Region indices, in the same order as the map file. Empty when the cell is outside of the grid.
+	 */
+	std::span<const std::uint16_t> cell(const std::int32_t& x, const std::int32_t& y) const
+	{
+		const auto& header{ reader.getHeader() };
+		const std::int64_t col{ static_cast<std::int64_t>(x) - header.originX }, row{ static_cast<std::int64_t>(header.originY) - y };
+		if (col < 0 || col >= header.gridWidth || row < 0 || row >= header.gridHeight)
+			return{};
+		return reader.cell(static_cast<std::int32_t>(col), static_cast<std::int32_t>(row));
+	}
+
+	/**
+	 * @brief	Get the region that wins a cell by priority.
+	 * @param x	The X-axis cell coordinate.
+	 * @param y	The Y-axis cell coordinate.
+	 * @returns	A region index, or 0 when the cell has no regions or is outside of the grid.
+	 */
+	std::uint16_t winner(const std::int32_t& x, const std::int32_t& y) const
+	{
+		const auto& header{ reader.getHeader() };
+		const std::int64_t col{ static_cast<std::int64_t>(x) - header.originX }, row{ static_cast<std::int64_t>(header.originY) - y };
+		if (col < 0 || col >= header.gridWidth || row < 0 || row >= header.gridHeight)
+			return 0u;
+		return reader.winner(static_cast<std::int32_t>(col), static_cast<std::int32_t>(row));
+	}
+
+	/**
+	 * @brief		Find the regions whose polygons contain a point.
+	 *\n			Points on the left & bottom edges of a polygon are inside of it, and points on its right & top edges are not, so that every point is in the same regions as the cell that contains it.
+	 * @param x		The X-axis position, in cell units. Positions that aren't finite are outside of every region.
+	 * @param y		The Y-axis position, in cell units. Positions that aren't finite are outside of every region.
+	 * @param out	Receives the index of every region that contains the point, in ascending order. It is not cleared first.
+	 */
+	void regionsAt(const double& x, const double& y, std::vector<std::uint16_t>& out) const
+	{
+		// the bucket is range-checked before it is converted to an integer, since points come from clients and may be NaN, infinite, or far outside of int32
+		if (edges.empty() || !std::isfinite(x) || !std::isfinite(y))
+			return;
+		const double bucketRow{ std::floor(y - originY) }, bucketCol{ std::floor((x - originX) / bucketWidth) };
+		if (bucketRow < 0.0 || bucketRow >= rows || bucketCol >= cols)
+			return;
+		// points to the left of every bucket are tested against the first column, since the ray from them crosses all of it
+		const std::int32_t r{ static_cast<std::int32_t>(bucketRow) }, c{ bucketCol < 0.0 ? 0 : static_cast<std::int32_t>(bucketCol) };
+
+		// every edge in this bucket that crosses the ray to the right of the point toggles whether the point is inside of the edge's region
+		thread_local std::vector<std::uint16_t> toggled;
+		toggled.clear();
+		const size_t bucket{ static_cast<size_t>(r) * cols + c };
+		for (std::uint32_t i{ bucketOffsets[bucket] }; i < bucketOffsets[bucket + 1ull]; ++i) {
+			const Edge& e{ edges[bucketEdges[i]] };
+			if ((e.y1 > y) != (e.y0 > y) && x < (e.x1 - e.x0) * (y - e.y0) / (e.y1 - e.y0) + e.x0)
+				toggled.emplace_back(e.region);
+		}
+		keepOdd(toggled);
+		std::set_symmetric_difference(insideRegions.begin() + insideOffsets[bucket], insideRegions.begin() + insideOffsets[bucket + 1ull], toggled.begin(), toggled.end(), std::back_inserter(out));
+	}
+	/**
+	 * @brief		Find the regions whose polygons contain a position in world units, where one cell is `UNITS_PER_CELL` units wide.
+	 * @param x		The X-axis position, in world units.
+	 * @param y		The Y-axis position, in world units.
+	 * @param out	Receives the index of every region that contains the point, in ascending order. It is not cleared first.
+	 */
+	void regionsAtWorld(const double& x, const double& y, std::vector<std::uint16_t>& out) const { regionsAt(x / UNITS_PER_CELL, y / UNITS_PER_CELL, out); }
+};
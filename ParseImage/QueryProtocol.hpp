@@ -0,0 +1,89 @@
+#pragma once
+/**
+ * @file	QueryProtocol.hpp
+ * @brief	Messages of the binary query protocol that `--serve` answers over a Unix domain socket.
+ *\n		This header only depends on the standard library, so it can be copied into clients.
+ *
+ *\n		All values are little-endian. A connection carries any number of requests, and the server answers each one in order before reading the next.
+ *\n		Every request is a `RequestHeader` followed by `count` payload records, and every response is a `ResponseHeader` followed by its payload:
+ *\n		- `Command::Info`		No payload. Responds with one `InfoRecord`.
+ *\n		- `Command::Cells`		`CellQuery[count]`. Responds with `count` results.
+ *\n		- `Command::Points`		`PointQuery[count]`. Responds with `count` results.
+ *\n		- `Command::Regions`	No payload. Responds with `count` results, where result `i` is the editor ID of region index `i + 1` as UTF-8 bytes.
+ *\n		- `Command::Reload`		No payload. Re-parses the source & responds with one `ReloadRecord`. Queries from other connections keep using the old results until it finishes.
+ *\n		- `Command::Stop`		No payload. Responds without a payload, then stops the server.
+ *\n		- `Command::Winners`	`CellQuery[count]`. Responds with `uint16_t[count]`: the region that wins each cell by priority, or 0 for cells without regions. This is the only command whose results aren't lists.
+ *\n		Lists of results are sent as `uint32_t offsets[count + 1]`, followed by the elements of every result: result `i` is the range `[ offsets[i], offsets[i + 1] )`.
+ *\n		The elements are `uint16_t` region indices for cells & points, and bytes for regions. Lists that end on an odd number of bytes are not padded.
+ *\n		When the status isn't `Status::Ok`, `count` is the length of an error message that follows the header instead.
+ */
+#include <cstdint>
+
+namespace query {
+	/// @brief	The protocol version reported by `Command::Info`.
+	inline constexpr std::uint32_t VERSION{ 2u };
+	/// @brief	The largest `count` that a request may have. Larger requests are rejected without reading their payload, and the connection is closed.
+	inline constexpr std::uint32_t MAX_COUNT{ 1u << 22 };
+
+	enum class Command : std::uint16_t {
+		Info = 0,
+		Cells = 1,
+		Points = 2,
+		Regions = 3,
+		Reload = 4,
+		Stop = 5,
+		Winners = 6,
+	};
+
+	enum class Status : std::uint16_t {
+		Ok = 0,
+		/// @brief	The command is unknown, or its count is too large.
+		BadRequest = 1,
+		/// @brief	The command was valid but failed, such as a reload of a file that no longer parses. The server keeps its previous results.
+		Failed = 2,
+	};
+
+	struct RequestHeader {
+		std::uint16_t command;
+		std::uint16_t _pad;
+		std::uint32_t count;
+	};
+
+	struct ResponseHeader {
+		std::uint16_t status;
+		std::uint16_t _pad;
+		std::uint32_t count;
+	};
+
+	/// @brief	A cell, in the same cell coordinates as the `[HoldMap]` of the map file.
+	struct CellQuery {
+		std::int32_t x, y;
+	};
+
+	/// @brief	A point, in the same units as the region polygons: cell `( x, y )` covers the square between `( x, y )` and `( x + 1, y + 1 )`.
+	struct PointQuery {
+		double x, y;
+	};
+
+	struct InfoRecord {
+		std::uint32_t version;
+		std::uint32_t regionCount;
+		/// @brief	The number of cells along each axis of the cell grid.
+		std::int32_t gridWidth, gridHeight;
+		/// @brief	The cell coordinates of the top-left cell.
+		std::int32_t originX, originY;
+		/// @brief	Incremented by every successful reload, starting from 0.
+		std::uint64_t generation;
+	};
+
+	struct ReloadRecord {
+		/// @brief	The generation of the new results.
+		std::uint64_t generation;
+		/// @brief	The number of cells that had to be classified again.
+		std::uint64_t cellsParsed;
+		/// @brief	The number of cells whose pixels were unchanged, and were reused from the previous results.
+		std::uint64_t cellsReused;
+	};
+
+	static_assert(sizeof(RequestHeader) == 8ull && sizeof(ResponseHeader) == 8ull && sizeof(CellQuery) == 8ull && sizeof(PointQuery) == 16ull && sizeof(InfoRecord) == 32ull && sizeof(ReloadRecord) == 24ull, "Unexpected struct padding!");
+}
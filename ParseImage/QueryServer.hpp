@@ -0,0 +1,426 @@
+#pragma once
+#include "Logger.hpp"
+#include "QueryIndex.hpp"
+#include "QueryProtocol.hpp"
+
+#include <make_exception.hpp>
+#include <TermAPI.hpp>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <afunix.h>
+#else
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @class	QueryServer
+ * @brief	Answers cell & point queries about a resident `QueryIndex` over a Unix domain socket, using the protocol described in `QueryProtocol.hpp`.
+ *\n		Each connection is served on its own thread. Reloads build a new index while queries keep using the old one, which is then swapped in atomically.
+ */
+class QueryServer {
+public:
+	/// @brief	The result of loading the index.
+	struct Load {
+		std::shared_ptr<const QueryIndex> index;
+		/// @brief	The number of cells that had to be classified.
+		std::uint64_t cellsParsed{ 0ull };
+		/// @brief	The number of cells that were reused from the previous load.
+		std::uint64_t cellsReused{ 0ull };
+	};
+	/// @brief	Loads the index. Called once by the constructor, then again for every reload, but never concurrently.
+	using Loader = std::function<Load()>;
+
+private:
+#ifdef _WIN32
+	using socket_t = SOCKET;
+	static constexpr socket_t INVALID{ INVALID_SOCKET };
+	static void closeSocket(const socket_t& s) { ::closesocket(s); }
+	static void shutdownSocket(const socket_t& s) { ::shutdown(s, SD_BOTH); }
+	static int pollSocket(const socket_t& s, const int& timeoutMs)
+	{
+		WSAPOLLFD pfd{ s, POLLRDNORM, 0 };
+		return ::WSAPoll(&pfd, 1u, timeoutMs);
+	}
+	static constexpr int SEND_FLAGS{ 0 };
+#else
+	using socket_t = int;
+	static constexpr socket_t INVALID{ -1 };
+	static void closeSocket(const socket_t& s) { ::close(s); }
+	static void shutdownSocket(const socket_t& s) { ::shutdown(s, SHUT_RDWR); }
+	static int pollSocket(const socket_t& s, const int& timeoutMs)
+	{
+		pollfd pfd{ s, POLLIN, 0 };
+		return ::poll(&pfd, 1u, timeoutMs);
+	}
+#ifdef MSG_NOSIGNAL
+	static constexpr int SEND_FLAGS{ MSG_NOSIGNAL }; // don't raise SIGPIPE when a client disconnects early
+#else
+	static constexpr int SEND_FLAGS{ 0 };
+#endif
+#endif
+
+	/// @brief	Owns a socket handle.
+	class Socket {
+		socket_t s{ INVALID };
+
+	public:
+		Socket() = default;
+		explicit Socket(const socket_t& s) : s{ s } {}
+		Socket(Socket&& o) noexcept : s{ std::exchange(o.s, INVALID) } {}
+		~Socket() noexcept
+		{
+			if (s != INVALID)
+				closeSocket(s);
+		}
+		Socket& operator=(Socket&&) = delete;
+
+		const socket_t& get() const { return s; }
+		bool valid() const { return s != INVALID; }
+	};
+
+	struct Connection {
+		Socket socket;
+		std::atomic<bool> done{ false };
+		// declared last, so the thread is joined before its socket is closed
+		std::jthread thread;
+	};
+
+	/// @brief	Initializes Winsock for the lifetime of the server. Does nothing on other platforms.
+	struct Startup {
+#ifdef _WIN32
+		Startup()
+		{
+			WSADATA data{};
+			if (::WSAStartup(MAKEWORD(2, 2), &data) != 0)
+				throw make_exception("Failed to initialize Winsock!");
+		}
+		~Startup() noexcept { ::WSACleanup(); }
+#endif
+	};
+
+	Startup startup;
+	std::filesystem::path path;
+	Loader loader;
+	Logger& logger;
+
+	std::mutex indexMutex;
+	std::shared_ptr<const QueryIndex> index;
+	std::uint64_t generation{ 0ull };
+	std::mutex reloadMutex;
+
+	std::atomic<bool> stopping{ false };
+	std::mutex connectionMutex;
+	std::list<Connection> connections;
+
+	static sockaddr_un makeAddress(const std::filesystem::path& path) noexcept(false)
+	{
+		sockaddr_un addr{};
+		addr.sun_family = AF_UNIX;
+		const auto& str{ path.string() };
+		if (str.size() >= sizeof(addr.sun_path))
+			throw make_exception("Socket path '", path.generic_string(), "' is longer than the limit of ", sizeof(addr.sun_path) - 1ull, " characters!");
+		std::memcpy(addr.sun_path, str.c_str(), str.size());
+		return addr;
+	}
+
+	static bool recvAll(const socket_t& s, void* data, size_t size)
+	{
+		for (char* p{ static_cast<char*>(data) }; size != 0ull;) {
+			const auto& n{ ::recv(s, p, static_cast<int>(std::min<size_t>(size, 1ull << 30)), 0) };
+			if (n <= 0)
+				return false;
+			p += n;
+			size -= static_cast<size_t>(n);
+		}
+		return true;
+	}
+	static bool sendAll(const socket_t& s, const void* data, size_t size)
+	{
+		for (const char* p{ static_cast<const char*>(data) }; size != 0ull;) {
+			const auto& n{ ::send(s, p, static_cast<int>(std::min<size_t>(size, 1ull << 30)), SEND_FLAGS) };
+			if (n <= 0)
+				return false;
+			p += n;
+			size -= static_cast<size_t>(n);
+		}
+		return true;
+	}
+
+	template<typename T>
+	static void append(std::vector<std::byte>& out, const T* data, const size_t& count)
+	{
+		const auto* bytes{ reinterpret_cast<const std::byte*>(data) };
+		out.insert(out.end(), bytes, bytes + count * sizeof(T));
+	}
+	static void appendHeader(std::vector<std::byte>& out, const query::Status& status, const size_t& count)
+	{
+		const query::ResponseHeader header{ static_cast<std::uint16_t>(status), 0u, static_cast<std::uint32_t>(count) };
+		append(out, &header, 1ull);
+	}
+	static void appendError(std::vector<std::byte>& out, const query::Status& status, const std::string& message)
+	{
+		appendHeader(out, status, message.size());
+		append(out, message.data(), message.size());
+	}
+
+	std::shared_ptr<const QueryIndex> snapshot(std::uint64_t* gen = nullptr)
+	{
+		std::scoped_lock lock{ indexMutex };
+		if (gen != nullptr)
+			*gen = generation;
+		return index;
+	}
+
+	/**
+	 * @brief			Answer a batch of queries that each return a list of region indices.
+	 * @param out		Receives the response.
+	 * @param queries	The queries.
+	 * @param offsets	Scratch buffer for the offset of each result.
+	 * @param entries	Scratch buffer for the elements of every result.
+	 * @param lookup	Appends the result of one query to a vector.
+	 */
+	template<typename Q, typename F>
+	static void answerLists(std::vector<std::byte>& out, const std::vector<Q>& queries, std::vector<std::uint32_t>& offsets, std::vector<std::uint16_t>& entries, F&& lookup)
+	{
+		offsets.assign(1ull, 0u);
+		entries.clear();
+		for (const auto& q : queries) {
+			lookup(q, entries);
+			offsets.emplace_back(static_cast<std::uint32_t>(entries.size()));
+		}
+		out.reserve(sizeof(query::ResponseHeader) + offsets.size() * sizeof(std::uint32_t) + entries.size() * sizeof(std::uint16_t));
+		appendHeader(out, query::Status::Ok, queries.size());
+		append(out, offsets.data(), offsets.size());
+		append(out, entries.data(), entries.size());
+	}
+
+	template<typename Q>
+	static bool receiveQueries(const socket_t& s, std::vector<Q>& queries, const std::uint32_t& count)
+	{
+		queries.resize(count);
+		return recvAll(s, queries.data(), queries.size() * sizeof(Q));
+	}
+
+	// answers requests from one client until it disconnects or the server stops
+	void serve(const socket_t& s)
+	{
+		std::vector<std::byte> out;
+		std::vector<query::CellQuery> cellQueries;
+		std::vector<query::PointQuery> pointQueries;
+		std::vector<std::uint32_t> offsets;
+		std::vector<std::uint16_t> entries;
+
+		for (query::RequestHeader request{}; !stopping && recvAll(s, &request, sizeof(request));) {
+			out.clear();
+			const auto& command{ static_cast<query::Command>(request.command) };
+			const bool hasPayload{ command == query::Command::Cells || command == query::Command::Points || command == query::Command::Winners };
+			// the payload of a rejected request is never read, so the connection can't continue after it
+			if (request.command > static_cast<std::uint16_t>(query::Command::Winners) || request.count > query::MAX_COUNT || (!hasPayload && request.count != 0u)) {
+				appendError(out, query::Status::BadRequest, "Invalid request with command " + std::to_string(request.command) + " & count " + std::to_string(request.count) + '!');
+				sendAll(s, out.data(), out.size());
+				return;
+			}
+
+			const auto& t_start{ std::chrono::steady_clock::now() };
+			switch (command) {
+			case query::Command::Info: {
+				std::uint64_t gen{ 0ull };
+				const auto& idx{ snapshot(&gen) };
+				const auto& header{ idx->getReader().getHeader() };
+				const query::InfoRecord info{ query::VERSION, header.regionCount, header.gridWidth, header.gridHeight, header.originX, header.originY, gen };
+				appendHeader(out, query::Status::Ok, 1ull);
+				append(out, &info, 1ull);
+				break;
+			}
+			case query::Command::Cells: {
+				if (!receiveQueries(s, cellQueries, request.count))
+					return;
+				const auto& idx{ snapshot() };
+				answerLists(out, cellQueries, offsets, entries, [&idx](const query::CellQuery& q, std::vector<std::uint16_t>& vec) {
+					const auto& regions{ idx->cell(q.x, q.y) };
+					vec.insert(vec.end(), regions.begin(), regions.end());
+				});
+				break;
+			}
+			case query::Command::Points: {
+				if (!receiveQueries(s, pointQueries, request.count))
+					return;
+				const auto& idx{ snapshot() };
+				answerLists(out, pointQueries, offsets, entries, [&idx](const query::PointQuery& q, std::vector<std::uint16_t>& vec) { idx->regionsAt(q.x, q.y, vec); });
+				break;
+			}
+			case query::Command::Winners: {
+				if (!receiveQueries(s, cellQueries, request.count))
+					return;
+				const auto& idx{ snapshot() };
+				entries.clear();
+				for (const auto& q : cellQueries)
+					entries.emplace_back(idx->winner(q.x, q.y));
+				appendHeader(out, query::Status::Ok, entries.size());
+				append(out, entries.data(), entries.size());
+				break;
+			}
+			case query::Command::Regions: {
+				const auto& idx{ snapshot() };
+				const auto& reader{ idx->getReader() };
+				offsets.assign(1ull, 0u);
+				std::string names;
+				for (std::uint16_t i{ 1u }; i <= reader.regionCount(); ++i) {
+					names += reader.editorID(i);
+					offsets.emplace_back(static_cast<std::uint32_t>(names.size()));
+				}
+				appendHeader(out, query::Status::Ok, reader.regionCount());
+				append(out, offsets.data(), offsets.size());
+				append(out, names.data(), names.size());
+				break;
+			}
+			case query::Command::Reload: {
+				std::string error;
+				if (const auto& record{ reload(error) }; record.has_value()) {
+					appendHeader(out, query::Status::Ok, 1ull);
+					append(out, &record.value(), 1ull);
+				}
+				else appendError(out, query::Status::Failed, error);
+				break;
+			}
+			case query::Command::Stop:
+				logger.info() << "Received a stop request." << std::endl;
+				appendHeader(out, query::Status::Ok, 0ull);
+				stopping = true;
+				break;
+			}
+
+			if (!sendAll(s, out.data(), out.size()))
+				return;
+			if (logger.enabled(LogLevel::Debug))
+				logger.debug() << "Answered command " << request.command << " with " << request.count << " queries in " << std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t_start).count() << " us" << std::endl;
+		}
+	}
+
+	/**
+	 * @brief			Load a new index & swap it in, or keep the current one if loading fails.
+	 * @param error		Receives the reason that loading failed.
+	 * @returns			The generation & cell counts of the new index, or std::nullopt if loading failed.
+	 */
+	std::optional<query::ReloadRecord> reload(std::string& error)
+	{
+		std::scoped_lock reloadLock{ reloadMutex };
+		logger.info() << "Reloading..." << std::endl;
+		try {
+			const auto& t_start{ std::chrono::steady_clock::now() };
+			auto load{ loader() };
+			std::uint64_t gen;
+			{
+				std::scoped_lock lock{ indexMutex };
+				index = std::move(load.index);
+				gen = ++generation;
+			}
+			logger.info() << "Reloaded in " << color::setcolor::green << std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count() << 's' << color::setcolor::reset
+				<< "  ( " << color::setcolor::green << load.cellsParsed << color::setcolor::reset << " cells parsed, " << color::setcolor::green << load.cellsReused << color::setcolor::reset << " reused )" << std::endl;
+			return query::ReloadRecord{ gen, load.cellsParsed, load.cellsReused };
+		} catch (const std::exception& ex) {
+			logger.error() << term::get_error() << "Reload failed, the previous results are kept: " << ex.what() << std::endl;
+			error = ex.what();
+			return std::nullopt;
+		}
+	}
+
+public:
+	/**
+	 * @brief			Load the index for the first time.
+	 * @param path		The location of the socket file to listen on.
+	 * @param loader	Loads the index. Called once by the constructor, then again for every reload, but never concurrently.
+	 * @param logger	Logger to write progress to.
+	 */
+	QueryServer(std::filesystem::path path, Loader loader, Logger& logger) noexcept(false) : path{ std::move(path) }, loader{ std::move(loader) }, logger{ logger }
+	{
+		index = this->loader().index;
+		if (index == nullptr)
+			throw make_exception("Failed to load the query index!");
+	}
+
+	QueryServer(const QueryServer&) = delete;
+	QueryServer& operator=(const QueryServer&) = delete;
+
+	/// @brief	Listen on the socket & answer queries until a client sends `query::Command::Stop`. The socket file is removed before returning.
+	void run() noexcept(false)
+	{
+		const auto& addr{ makeAddress(path) };
+		Socket listener{ ::socket(AF_UNIX, SOCK_STREAM, 0) };
+		if (!listener.valid())
+			throw make_exception("Failed to create a Unix domain socket!");
+
+		// a leftover socket file from a previous server is replaced, but one that is still being listened on is not
+		if (std::filesystem::exists(path)) {
+			if (Socket probe{ ::socket(AF_UNIX, SOCK_STREAM, 0) }; probe.valid() && ::connect(probe.get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0)
+				throw make_exception("Socket '", path.generic_string(), "' is already in use by another server!");
+			std::filesystem::remove(path);
+		}
+		if (::bind(listener.get(), reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listener.get(), SOMAXCONN) != 0)
+			throw make_exception("Failed to listen on socket '", path.generic_string(), "'!");
+
+		logger.info() << "Listening for queries on '" << color::setcolor::yellow << path.generic_string() << color::setcolor::reset << '\'' << std::endl;
+
+		while (!stopping) {
+			// wake up regularly to check if a client requested a stop
+			if (pollSocket(listener.get(), 200) <= 0)
+				continue;
+			Socket client{ ::accept(listener.get(), nullptr, nullptr) };
+			if (!client.valid())
+				continue;
+#ifdef SO_NOSIGPIPE
+			const int on{ 1 };
+			::setsockopt(client.get(), SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+			std::scoped_lock lock{ connectionMutex };
+			// threads that already finished are joined immediately
+			connections.remove_if([](const Connection& c) { return c.done.load(); });
+			auto& connection{ connections.emplace_back(std::move(client)) };
+			connection.thread = std::jthread{ [this, &connection] {
+				serve(connection.socket.get());
+				// the handle is closed when the connection is removed, but the client is told right away
+				shutdownSocket(connection.socket.get());
+				connection.done = true;
+			} };
+		}
+
+		// wake up every connection that is waiting for a request, then join them
+		{
+			std::scoped_lock lock{ connectionMutex };
+			for (const auto& connection : connections)
+				shutdownSocket(connection.socket.get());
+		}
+		connections.clear();
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+		logger.info() << "Stopped listening for queries." << std::endl;
+	}
+};
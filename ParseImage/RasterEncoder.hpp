@@ -0,0 +1,139 @@
+#pragma once
+#include "BinaryMapWriter.hpp"
+#include "Region.hpp"
+#include "RegionRaster.hpp"
+
+#include <make_exception.hpp>
+
+#include <opencv2/opencv.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+/**
+ * @class	RasterEncoder
+ * @brief	Run-length encodes the label strips that are classified, to be written as a region raster file described in `RegionRaster.hpp`.
+ *\n		Each strip is encoded from the labels that `CellMapper` found while classifying it, so the image never has to be decoded or looked up again. Strips of different rows may be encoded concurrently.
+ */
+class RasterEncoder {
+	int width;
+	std::vector<std::vector<raster::Run>> rows;
+
+	template<typename T>
+	static void encodeRow(const T* labels, const int& width, std::vector<raster::Run>& out)
+	{
+		out.clear();
+		for (int x{ 0 }; x < width;) {
+			const T region{ labels[x] };
+			int end{ x + 1 };
+			while (end < width && labels[end] == region && end - x < std::numeric_limits<std::uint16_t>::max())
+				++end;
+			out.emplace_back(raster::Run{ static_cast<std::uint16_t>(region), static_cast<std::uint16_t>(end - x) });
+			x = end;
+		}
+		out.shrink_to_fit();
+	}
+
+public:
+	/**
+	 * @brief			Constructor.
+	 * @param width		The width of every strip, in pixels.
+	 * @param height	The total number of rows of pixels in every strip.
+	 */
+	RasterEncoder(const int& width, const int& height) : width{ width }, rows(static_cast<size_t>(height)) {}
+
+	/**
+	 * @brief			Encode every row of a label strip.
+	 * @param strip		A single-channel label strip, as returned by `LabelImage::rowRange()` or `LabelImage::convert()`.
+	 * @param firstRow	The index of the first row of the strip, in the whole image.
+	 */
+	void encode(const cv::Mat& strip, const int& firstRow) noexcept(false)
+	{
+		if (strip.type() != CV_8UC1 && strip.type() != CV_16UC1)
+			throw make_exception("Only label strips can be encoded!");
+		if (strip.cols != width || firstRow < 0 || firstRow + strip.rows > static_cast<int>(rows.size()))
+			throw make_exception("Label strip ( ", strip.cols, " x ", strip.rows, " at row ", firstRow, " ) is outside of the raster!");
+		for (int y{ 0 }; y < strip.rows; ++y) {
+			if (strip.type() == CV_16UC1)
+				encodeRow(strip.ptr<RegionIndex>(y), width, rows[static_cast<size_t>(firstRow + y)]);
+			else encodeRow(strip.ptr<uchar>(y), width, rows[static_cast<size_t>(firstRow + y)]);
+		}
+	}
+
+	/**
+	 * @brief			Serialize the encoded rows into the region raster format.
+	 * @param regions	The table of regions that the labels refer to.
+	 * @returns			The contents of the file.
+	 */
+	std::vector<std::byte> serialize(const RegionTable& regions) const noexcept(false)
+	{
+		raster::Header header{};
+		std::memcpy(header.magic, raster::MAGIC, sizeof(raster::MAGIC));
+		header.version = raster::VERSION;
+		header.headerSize = sizeof(raster::Header);
+		header.width = static_cast<std::uint32_t>(width);
+		header.height = static_cast<std::uint32_t>(rows.size());
+		header.regionCount = static_cast<std::uint32_t>(regions.size());
+
+		std::string strings;
+		const auto& regionRecords{ binmap::makeRegionRecords(regions, strings) };
+
+		std::vector<std::uint32_t> rowOffsets;
+		rowOffsets.reserve(rows.size() + 1ull);
+		rowOffsets.emplace_back(0u);
+		std::uint64_t runCount{ 0ull };
+		for (const auto& row : rows) {
+			if (row.empty() && width != 0)
+				throw make_exception("Row ", rowOffsets.size() - 1ull, " of the raster was never encoded!");
+			runCount += row.size();
+			if (runCount > std::numeric_limits<std::uint32_t>::max())
+				throw make_exception("The raster has too many runs to be written!");
+			rowOffsets.emplace_back(static_cast<std::uint32_t>(runCount));
+		}
+		header.runCount = runCount;
+
+		// lay out every section after the header, each aligned to 8 bytes
+		std::uint64_t size{ sizeof(raster::Header) };
+		const auto& place{ [&size](binmap::Section& section, const std::uint64_t& bytes) {
+			section = { size, bytes };
+			size += (bytes + 7ull) & ~7ull;
+		} };
+		place(header.regions, regionRecords.size() * sizeof(binmap::RegionRecord));
+		place(header.rowOffsets, rowOffsets.size() * sizeof(std::uint32_t));
+		place(header.runs, runCount * sizeof(raster::Run));
+		place(header.strings, strings.size());
+
+		std::vector<std::byte> bytes(static_cast<size_t>(size), std::byte{ 0 });
+		const auto& copy{ [&bytes](const std::uint64_t& offset, const void* src, const size_t& count) {
+			if (count != 0ull)
+				std::memcpy(bytes.data() + offset, src, count);
+		} };
+		std::memcpy(bytes.data(), &header, sizeof(raster::Header));
+		copy(header.regions.offset, regionRecords.data(), static_cast<size_t>(header.regions.size));
+		copy(header.rowOffsets.offset, rowOffsets.data(), static_cast<size_t>(header.rowOffsets.size));
+		std::uint64_t offset{ header.runs.offset };
+		for (const auto& row : rows) {
+			copy(offset, row.data(), row.size() * sizeof(raster::Run));
+			offset += row.size() * sizeof(raster::Run);
+		}
+		copy(header.strings.offset, strings.data(), strings.size());
+		return bytes;
+	}
+
+	/**
+	 * @brief			Write the encoded rows to a region raster file.
+	 * @param path		The location of the output file. It is overwritten if it already exists.
+	 * @param regions	The table of regions that the labels refer to.
+	 * @returns			true when successful.
+	 */
+	bool write(const std::filesystem::path& path, const RegionTable& regions) const noexcept(false)
+	{
+		const auto& bytes{ serialize(regions) };
+		std::ofstream ofs{ path, std::ios_base::binary | std::ios_base::trunc };
+		return ofs.is_open() && ofs.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+	}
+};
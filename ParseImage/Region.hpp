@@ -1,6 +1,8 @@
 #pragma once
 #include <color-transform.hpp>
+#include <make_exception.hpp>
 
+#include <limits>
 #include <string>
 #include <vector>
 #include <ostream>
@@ -8,6 +10,8 @@
 using uchar = unsigned char;
 using ushort = unsigned short;
 using ID = unsigned int;
+/// @brief	Compact handle of a region in a `RegionTable`. Index `0` is reserved for pixels that don't belong to any region.
+using RegionIndex = ushort;
 
 /// @brief	RGB color.
 using RGB = color::RGB<uchar>;
@@ -65,3 +69,71 @@ inline std::ostream& operator<<(std::ostream& os, const RegionVec& regionList)
 	}
 	return os << " ]";
 }
+
+/**
+ * @class	RegionTable
+ * @brief	Central immutable table of regions.
+ *\n		Everything else refers to regions by their `RegionIndex` in this table, so names are only looked up when writing output.
+ *\n		Regions are indexed in the order they appear in the vector, starting at 1.
+ */
+class RegionTable {
+	RegionVec regions;
+
+public:
+	/**
+	 * @brief			Constructor.
+	 * @param regionVec	Vector of regions to store in the table.
+	 */
+	RegionTable(RegionVec regionVec) noexcept(false) : regions{ std::move(regionVec) }
+	{
+		if (regions.size() >= static_cast<size_t>(std::numeric_limits<RegionIndex>::max()))
+			throw make_exception("Too many regions! (", regions.size(), ")");
+	}
+
+	/**
+	 * @brief		Get the region associated with an index.
+	 * @param index	A region index in the range ( 1 - size() ).
+	 * @returns		const Region&
+	 */
+	const Region& operator[](const RegionIndex& index) const { return regions[static_cast<size_t>(index) - 1ull]; }
+
+	/// @brief	Get the number of regions in the table.
+	size_t size() const { return regions.size(); }
+	/// @brief	Check if the table doesn't contain any regions.
+	bool empty() const { return regions.empty(); }
+
+	/// @brief	Get the underlying vector of regions, where each region is stored at its index minus one.
+	const RegionVec& getRegions() const { return regions; }
+};
+
+/// @brief	Vector of region indices.
+using RegionIndexVec = std::vector<RegionIndex>;
+
+/**
+ * @struct	Named
+ * @brief	Pairs an object that refers to regions by index with the `RegionTable` that is used to resolve their names when the object is written to a stream.
+ * @tparam T	The type of object being written.
+ */
+template<typename T>
+struct Named {
+	const T& value;
+	const RegionTable& table;
+};
+template<typename T> Named(const T&, const RegionTable&) -> Named<T>;
+
+/**
+ * @brief				Stream writing operator for a RegionIndexVec, which writes the same format as the RegionVec operator.
+ * @param os			Output stream to write to.
+ * @param indices		RegionIndexVec & the table to resolve names with.
+ * @returns				std::ostream&
+ */
+inline std::ostream& operator<<(std::ostream& os, const Named<RegionIndexVec>& indices)
+{
+	os << "[ ";
+	for (auto it{ indices.value.begin() }, endit{ indices.value.end() }; it != endit; ++it) {
+		os << '"' << indices.table[*it] << '"';
+		if (std::next(it) != endit)
+			os << ", ";
+	}
+	return os << " ]";
+}
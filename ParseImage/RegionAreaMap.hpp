@@ -0,0 +1,43 @@
+#pragma once
+#include "Contour.hpp"
+#include "Region.hpp"
+#include "RegionStatsMap.hpp"
+#include "ThreadPool.hpp"
+
+#include <map>
+#include <vector>
+
+/**
+ * @struct	RegionAreaMap
+ * @brief	Map of the outline polygons of each region, keyed by `RegionIndex`.
+ *\n		Tracing the outlines is done once when the map is created, so that every output format can share the results.
+ *\n		Regions are traced independently of each other, so they can be traced concurrently.
+ */
+struct RegionAreaMap : std::map<RegionIndex, std::vector<contour::Polygon>> {
+	using base = std::map<RegionIndex, std::vector<contour::Polygon>>;
+	using base::base;
+
+	/**
+	 * @brief				Trace the outlines of every region.
+	 * @param regionStats	The cells that each region was found in.
+	 * @param pool			Optional thread pool to trace regions on. The results are identical to tracing them serially.
+	 */
+	RegionAreaMap(const RegionStatsMap& regionStats, ThreadPool* pool = nullptr) noexcept(false)
+	{
+		if (pool == nullptr) {
+			for (const auto& [index, stats] : regionStats)
+				emplace_hint(end(), index, stats.filter_region_area());
+			return;
+		}
+
+		// each region is traced into its own slot, then the slots are inserted in key order
+		std::vector<const RegionStatsMap::value_type*> entries;
+		entries.reserve(regionStats.size());
+		for (const auto& entry : regionStats)
+			entries.emplace_back(&entry);
+		std::vector<std::vector<contour::Polygon>> polygons(entries.size());
+		pool->parallel_for(entries.size(), [&entries, &polygons](const size_t& i) { polygons[i] = entries[i]->second.filter_region_area(); });
+		for (size_t i{ 0ull }; i < entries.size(); ++i)
+			emplace_hint(end(), entries[i]->first, std::move(polygons[i]));
+	}
+};
@@ -0,0 +1,219 @@
+#pragma once
+/**
+ * @file	RegionRaster.hpp
+ * @brief	Layout of the region raster file (`<worldspace>.raster.bin`), and a reader that views it in place.
+ *\n		The raster stores the region of every pixel of the image, including the rows & columns that don't fill a whole cell, as run-length encoded rows, so that the cells can be classified again with any cell size or threshold without the source image.
+ *\n		This header only depends on the standard library & `BinaryMap.hpp`, so both can be copied into other projects that consume the raster file.
+ *
+ *\n		All values are little-endian, and every section starts at an offset that is a multiple of 8 bytes.
+ *\n		Sections, in order:
+ *\n		- `Header`
+ *\n		- `binmap::RegionRecord[regionCount]`, where region index `i` (starting at 1) is stored at position `i - 1`.
+ *\n		- Row offsets: `uint32_t[height + 1]`. The runs of row `y` are stored in the range `[ offsets[y], offsets[y + 1] )` of the runs.
+ *\n		- Runs: `Run[runCount]`. The runs of each row are in order from left to right, and their lengths add up to `width`.
+ *\n		- Strings: UTF-8 text referred to by `binmap::RegionRecord`, without null terminators.
+ */
+#include "BinaryMap.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace raster {
+	/// @brief	The first 8 bytes of every region raster file.
+	inline constexpr char MAGIC[8]{ 'P', 'I', 'M', 'G', 'R', 'L', 'E', '\0' };
+	/// @brief	The format version written by this version of the program. Readers reject files with any other version.
+	inline constexpr std::uint32_t VERSION{ 1u };
+
+	struct Header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t headerSize;
+		/// @brief	The size of the raster, in pixels. The top-left pixel is the top-left corner of the cell grid.
+		std::uint32_t width, height;
+		std::uint32_t regionCount;
+		std::uint32_t _pad;
+		std::uint64_t runCount;
+		binmap::Section regions;
+		binmap::Section rowOffsets;
+		binmap::Section runs;
+		binmap::Section strings;
+	};
+
+	/// @brief	A span of consecutive pixels in one row that belong to the same region. Longer spans are split into several runs.
+	struct Run {
+		/// @brief	The region index, or 0 for pixels that don't belong to any region.
+		std::uint16_t region;
+		/// @brief	The number of pixels, which is never 0.
+		std::uint16_t length;
+	};
+
+	static_assert(sizeof(Header) % 8ull == 0ull && sizeof(Run) == 4ull, "Unexpected struct padding!");
+
+	/**
+	 * @class	Reader
+	 * @brief	Read-only view of a region raster file that is already in memory.
+	 *\n		The constructor validates every section once; after that, accessors only index into the buffer. The buffer must outlive the reader.
+	 */
+	class Reader {
+		std::span<const std::byte> data;
+		const Header* header{ nullptr };
+
+		template<typename T>
+		std::span<const T> section(const binmap::Section& s) const { return{ reinterpret_cast<const T*>(data.data() + s.offset), static_cast<size_t>(s.size / sizeof(T)) }; }
+
+		template<typename T>
+		void check(const binmap::Section& s, const std::uint64_t& count, const char* name) const
+		{
+			if (s.offset % alignof(T) != 0ull || s.offset > data.size() || s.size > data.size() - s.offset || s.size != count * sizeof(T))
+				throw std::invalid_argument(std::string("Region raster file has an invalid ") + name + " section!");
+		}
+
+	public:
+		/**
+		 * @brief		Validate a region raster file.
+		 * @param bytes	The entire contents of the file. Must be aligned to at least 8 bytes, which is always true for memory-mapped files & heap allocations.
+		 */
+		explicit Reader(std::span<const std::byte> bytes) : data{ bytes }
+		{
+			if (reinterpret_cast<std::uintptr_t>(data.data()) % 8ull != 0ull)
+				throw std::invalid_argument("Region raster buffer isn't aligned to 8 bytes!");
+			if (data.size() < sizeof(Header) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0)
+				throw std::invalid_argument("Not a region raster file!");
+			header = reinterpret_cast<const Header*>(data.data());
+			if (header->version != VERSION || header->headerSize != sizeof(Header))
+				throw std::invalid_argument("Unsupported region raster file version!");
+			// region indices are 16-bit, so a file with more regions can't refer to all of them
+			if (header->regionCount > std::numeric_limits<std::uint16_t>::max())
+				throw std::invalid_argument("Region raster file has too many regions!");
+
+			check<binmap::RegionRecord>(header->regions, header->regionCount, "region");
+			check<std::uint32_t>(header->rowOffsets, static_cast<std::uint64_t>(header->height) + 1ull, "row offset");
+			check<Run>(header->runs, header->runCount, "run");
+			check<char>(header->strings, header->strings.size, "string");
+
+			const auto& offsets{ section<std::uint32_t>(header->rowOffsets) };
+			if (offsets.front() != 0u || offsets.back() != header->runCount)
+				throw std::invalid_argument("Region raster file has out-of-range row offsets!");
+			const auto& runs{ section<Run>(header->runs) };
+			for (size_t y{ 0ull }; y < header->height; ++y) {
+				if (offsets[y + 1ull] < offsets[y])
+					throw std::invalid_argument("Region raster file has decreasing row offsets!");
+				std::uint64_t length{ 0ull };
+				for (std::uint32_t i{ offsets[y] }; i < offsets[y + 1ull]; ++i) {
+					if (runs[i].length == 0u || runs[i].region > header->regionCount)
+						throw std::invalid_argument("Region raster file has an invalid run in row " + std::to_string(y) + '!');
+					length += runs[i].length;
+				}
+				if (length != header->width)
+					throw std::invalid_argument("Row " + std::to_string(y) + " of the region raster file isn't " + std::to_string(header->width) + " pixels wide!");
+			}
+			for (const auto& region : section<binmap::RegionRecord>(header->regions))
+				if (region.editorIDOffset > header->strings.size || region.editorIDLength > header->strings.size - region.editorIDOffset
+					|| region.mapNameOffset > header->strings.size || region.mapNameLength > header->strings.size - region.mapNameOffset)
+					throw std::invalid_argument("Region raster file has an out-of-range string!");
+		}
+
+		const Header& getHeader() const { return *header; }
+
+		/// @brief	Get the width of the raster, in pixels.
+		std::uint32_t width() const { return header->width; }
+		/// @brief	Get the height of the raster, in pixels.
+		std::uint32_t height() const { return header->height; }
+		/// @brief	Get the number of regions. Valid region indices are in the range ( 1 - regionCount() ).
+		std::uint32_t regionCount() const { return header->regionCount; }
+
+		/// @brief	Get the record of a region. Region indices start at 1.
+		const binmap::RegionRecord& region(const std::uint16_t& index) const { return section<binmap::RegionRecord>(header->regions)[index - 1u]; }
+		/// @brief	Get the editor ID of a region.
+		std::string_view editorID(const std::uint16_t& index) const
+		{
+			const auto& r{ region(index) };
+			return{ reinterpret_cast<const char*>(data.data() + header->strings.offset + r.editorIDOffset), r.editorIDLength };
+		}
+		/// @brief	Get the map name of a region.
+		std::string_view mapName(const std::uint16_t& index) const
+		{
+			const auto& r{ region(index) };
+			return{ reinterpret_cast<const char*>(data.data() + header->strings.offset + r.mapNameOffset), r.mapNameLength };
+		}
+
+		/// @brief	Get the runs of a row, from left to right.
+		std::span<const Run> row(const std::uint32_t& y) const
+		{
+			const auto& offsets{ section<std::uint32_t>(header->rowOffsets) };
+			return section<Run>(header->runs).subspan(offsets[y], offsets[y + 1u] - offsets[y]);
+		}
+
+		/**
+		 * @brief		Expand a row to the region index of every pixel.
+		 * @param y		The row index, starting from the top.
+		 * @param out	Receives `width()` region indices.
+		 */
+		void decodeRow(const std::uint32_t& y, std::uint16_t* out) const
+		{
+			for (const auto& run : row(y))
+				out = std::fill_n(out, run.length, run.region);
+		}
+
+		/**
+		 * @brief			Count the pixels of each region in a rectangle, such as one cell of a grid with any cell size.
+		 * @param x			The left column of the rectangle.
+		 * @param y			The top row of the rectangle.
+		 * @param w			The width of the rectangle. The rectangle must be inside of the raster.
+		 * @param h			The height of the rectangle.
+		 * @param counts	Pixel counts indexed by region index, with `regionCount() + 1` elements. The counts are added to it, and index 0 receives the pixels without a region.
+		 */
+		void count(const std::uint32_t& x, const std::uint32_t& y, const std::uint32_t& w, const std::uint32_t& h, std::span<std::uint32_t> counts) const
+		{
+			for (std::uint32_t r{ y }; r < y + h; ++r) {
+				std::uint32_t start{ 0u };
+				for (const auto& run : row(r)) {
+					const std::uint32_t end{ start + run.length };
+					if (end > x && start < x + w)
+						counts[run.region] += std::min(end, x + w) - std::max(start, x);
+					if (end >= x + w)
+						break;
+					start = end;
+				}
+			}
+		}
+	};
+
+	/**
+	 * @brief		Check if a file starts with the magic bytes of a region raster file.
+	 * @param path	The location of the file.
+	 * @returns		true if the file is a region raster file, otherwise false.
+	 */
+	inline bool isRasterFile(const std::filesystem::path& path)
+	{
+		std::ifstream ifs{ path, std::ios_base::binary };
+		char magic[sizeof(MAGIC)]{};
+		return ifs.read(magic, sizeof(magic)) && std::memcmp(magic, MAGIC, sizeof(magic)) == 0;
+	}
+
+	/**
+	 * @brief		Read the contents of a region raster file, to pass to a `Reader`.
+	 * @param path	The location of a `<worldspace>.raster.bin` file.
+	 * @returns		std::vector<std::byte>
+	 */
+	inline std::vector<std::byte> readFile(const std::filesystem::path& path) noexcept(false)
+	{
+		std::ifstream ifs{ path, std::ios_base::binary };
+		if (!ifs.is_open())
+			throw std::runtime_error("Failed to open region raster file '" + path.generic_string() + "'!");
+		std::vector<std::byte> buffer(static_cast<size_t>(std::filesystem::file_size(path)));
+		if (!ifs.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size())))
+			throw std::runtime_error("Failed to read region raster file '" + path.generic_string() + "'!");
+		return buffer;
+	}
+}
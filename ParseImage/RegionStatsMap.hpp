@@ -4,15 +4,18 @@
 
 #include <map>
 
-struct RegionStatsMap : std::map<Region, RegionStats> {
-	using base = std::map<Region, RegionStats>;
+/**
+ * @struct	RegionStatsMap
+ * @brief	Map of the cells that each region was found in, keyed by `RegionIndex`.
+ */
+struct RegionStatsMap : std::map<RegionIndex, RegionStats> {
+	using base = std::map<RegionIndex, RegionStats>;
 	using base::base;
 
-	RegionStats get(const ID& regionID) const
+	const RegionStats& get(const RegionIndex& index) const
 	{
-		for (const auto& [region, stats] : *this)
-			if (region.getID() == regionID)
-				return stats;
-		throw make_exception("No region with ID ", regionID, " was found!");
+		if (const auto& it{ find(index) }; it != end())
+			return it->second;
+		throw make_exception("No region with index ", index, " was found!");
 	}
 };
@@ -0,0 +1,86 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+/**
+ * @class		RingBuffer
+ * @brief		Bounded lock-free queue for any number of producer threads and a single consumer thread.
+ *\n			Each slot has a sequence number that tells producers & the consumer whether it is free or filled, so neither side ever takes a lock or waits for the other.
+ * @tparam T	The element type. Must be default constructible & move assignable.
+ */
+template<typename T>
+class RingBuffer {
+	struct Slot {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	std::unique_ptr<Slot[]> slots;
+	size_t mask;
+	/// @brief	The position of the next slot to push to. Producers claim slots by incrementing this.
+	alignas(64) std::atomic<size_t> head{ 0ull };
+	/// @brief	The position of the next slot to pop from. Only the consumer touches this.
+	alignas(64) size_t tail{ 0ull };
+
+public:
+	/**
+	 * @brief			Constructor.
+	 * @param capacity	The minimum number of elements that the buffer can hold. This is rounded up to the next power of 2.
+	 */
+	explicit RingBuffer(const size_t& capacity) : slots{ std::make_unique<Slot[]>(std::bit_ceil(std::max<size_t>(capacity, 2ull))) }, mask{ std::bit_ceil(std::max<size_t>(capacity, 2ull)) - 1ull }
+	{
+		for (size_t i{ 0ull }; i <= mask; ++i)
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	RingBuffer(const RingBuffer&) = delete;
+	RingBuffer& operator=(const RingBuffer&) = delete;
+
+	/// @brief	Get the number of elements that the buffer can hold.
+	size_t capacity() const { return mask + 1ull; }
+
+	/**
+	 * @brief		Push an element without waiting. Safe to call from any thread.
+	 * @param value	The element to push. It is only moved from when the push succeeds.
+	 * @returns		true when the element was pushed; false when the buffer is full.
+	 */
+	bool try_push(T&& value)
+	{
+		size_t pos{ head.load(std::memory_order_relaxed) };
+		for (;;) {
+			Slot& slot{ slots[pos & mask] };
+			const auto& diff{ static_cast<std::intptr_t>(slot.sequence.load(std::memory_order_acquire)) - static_cast<std::intptr_t>(pos) };
+			if (diff == 0) { // the slot is free; try to claim it
+				if (head.compare_exchange_weak(pos, pos + 1ull, std::memory_order_relaxed)) {
+					slot.value = std::move(value);
+					slot.sequence.store(pos + 1ull, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0) // the consumer hasn't emptied this slot since the last lap
+				return false;
+			else pos = head.load(std::memory_order_relaxed); // another producer claimed this slot first
+		}
+	}
+
+	/**
+	 * @brief		Pop the oldest element without waiting. Must only be called from the consumer thread.
+	 * @param out	Receives the element when the pop succeeds.
+	 * @returns		true when an element was popped; false when the buffer is empty.
+	 */
+	bool try_pop(T& out)
+	{
+		Slot& slot{ slots[tail & mask] };
+		if (slot.sequence.load(std::memory_order_acquire) != tail + 1ull)
+			return false;
+		out = std::move(slot.value);
+		slot.sequence.store(tail + mask + 1ull, std::memory_order_release);
+		++tail;
+		return true;
+	}
+};
@@ -0,0 +1,192 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+/**
+ * @namespace	alloc
+ * @brief		Counters that are incremented by the replacement global `operator new` in main.cpp.
+ *\n			They stay at 0 in programs that don't replace it, and while `enabled` is false.
+ */
+namespace alloc {
+	/// @brief	Whether allocations are counted. It is only read with relaxed loads, so it should be set before any threads are started.
+	inline std::atomic<bool> enabled{ false };
+	inline std::atomic<std::uint64_t> count{ 0ull };
+	inline std::atomic<std::uint64_t> bytes{ 0ull };
+}
+
+/**
+ * @class	RunStats
+ * @brief	Collects the wall time of each phase of a run & any number of counters, and writes them as JSON.
+ *\n		Phases & counters are written in the order they were first recorded.
+ *\n		The reports of the jobs in a batch are kept separately rather than summed, since jobs overlap in time and each one has its own config.
+ */
+class RunStats {
+	using CLK = std::chrono::steady_clock;
+
+	using Phases = std::vector<std::pair<std::string, double>>;
+	using Counters = std::vector<std::pair<std::string, std::uint64_t>>;
+
+	/// @brief	The phases & counters of one job in a batch.
+	struct JobReport {
+		std::string name;
+		Phases phases;
+		Counters counters;
+	};
+
+	Phases phases;
+	Counters counters;
+	std::vector<JobReport> jobs;
+
+	template<typename T>
+	static T& get(std::vector<std::pair<std::string, T>>& vec, const std::string& name)
+	{
+		for (auto& [key, value] : vec)
+			if (key == name)
+				return value;
+		return vec.emplace_back(name, T{}).second;
+	}
+
+public:
+	/**
+	 * @class	Scope
+	 * @brief	Adds the time between its construction & destruction to a phase.
+	 */
+	class Scope {
+		RunStats& stats;
+		std::string name;
+		CLK::time_point t_start;
+
+	public:
+		Scope(RunStats& stats, std::string name) : stats{ stats }, name{ std::move(name) }, t_start{ CLK::now() } {}
+		~Scope() { stats.addTime(name, std::chrono::duration<double>(CLK::now() - t_start).count()); }
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+
+	/**
+	 * @brief		Call a function & add the time it takes to a phase.
+	 * @param name	The name of the phase.
+	 * @param func	The function to call.
+	 * @returns		The result of the function.
+	 */
+	template<typename F>
+	decltype(auto) timed(const std::string& name, F&& func)
+	{
+		const Scope scope{ *this, name };
+		return func();
+	}
+
+	/**
+	 * @brief			Add time to a phase.
+	 * @param name		The name of the phase.
+	 * @param seconds	The amount of time to add, in seconds.
+	 */
+	void addTime(const std::string& name, const double& seconds) { get(phases, name) += seconds; }
+
+	/**
+	 * @brief		Set the value of a counter.
+	 * @param name	The name of the counter.
+	 * @param value	The new value of the counter.
+	 */
+	void set(const std::string& name, const std::uint64_t& value) { get(counters, name) = value; }
+
+	/**
+	 * @brief		Add the report of one job in a batch. Jobs are written in the order they were added.
+	 * @param name	The name of the job.
+	 * @param job	The phases & counters of the job.
+	 */
+	void addJob(const std::string& name, const RunStats& job) { jobs.emplace_back(JobReport{ name, job.phases, job.counters }); }
+
+	/// @brief	Get the peak resident set size of this process, in bytes, or 0 if it can't be determined.
+	static std::uint64_t peakRSS()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters{};
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return static_cast<std::uint64_t>(counters.PeakWorkingSetSize);
+		return 0ull;
+#else
+		rusage usage{};
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+			return 0ull;
+#ifdef __APPLE__
+		return static_cast<std::uint64_t>(usage.ru_maxrss); // bytes
+#else
+		return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024ull; // kilobytes
+#endif
+#endif
+	}
+
+	/// @brief	Write the phases, the counters, the report of each job, the allocation counters & the peak RSS as a JSON object.
+	friend std::ostream& operator<<(std::ostream& os, const RunStats& stats)
+	{
+		const auto& writeObject{ [&os](const auto& vec, const std::string& indent) {
+			os << '{';
+			for (auto it{ vec.begin() }, end{ vec.end() }; it != end; ++it) {
+				os << '\n' << indent << "  \"" << it->first << "\": " << it->second;
+				if (std::next(it) != end)
+					os << ',';
+			}
+			os << (vec.empty() ? "}" : '\n' + indent + '}');
+		} };
+
+		const auto& flags{ os.flags() };
+		os << std::fixed << std::setprecision(6) << "{\n  \"phases\": ";
+		writeObject(stats.phases, "  ");
+		os << ",\n  \"counters\": ";
+		writeObject(stats.counters, "  ");
+		if (!stats.jobs.empty()) {
+			os << ",\n  \"jobs\": [";
+			for (auto it{ stats.jobs.begin() }, end{ stats.jobs.end() }; it != end; ++it) {
+				os << "\n    {\n      \"name\": \"" << it->name << "\",\n      \"phases\": ";
+				writeObject(it->phases, "      ");
+				os << ",\n      \"counters\": ";
+				writeObject(it->counters, "      ");
+				os << "\n    }";
+				if (std::next(it) != end)
+					os << ',';
+			}
+			os << "\n  ]";
+		}
+		os.flags(flags);
+		return os
+			<< ",\n  \"allocations\": " << alloc::count.load()
+			<< ",\n  \"allocated_bytes\": " << alloc::bytes.load()
+			<< ",\n  \"peak_rss_bytes\": " << peakRSS()
+			<< "\n}\n";
+	}
+
+	/**
+	 * @brief		Write the report to a JSON file.
+	 * @param path	The location of the output file. It is overwritten if it already exists.
+	 * @returns		true when successful.
+	 */
+	bool write(const std::filesystem::path& path) const
+	{
+		std::ofstream ofs{ path, std::ios_base::trunc };
+		return ofs.is_open() && (ofs << *this);
+	}
+};
@@ -0,0 +1,269 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <make_exception.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#ifdef PARSEIMG_HAS_PNG
+#include <png.h>
+#include <csetjmp>
+#endif
+
+/**
+ * @class	StripReader
+ * @brief	Interface for image decoders that read an image from top to bottom, a few rows at a time.
+ *\n		Only the most recently read strip is kept in memory, so peak memory usage depends on the image width & strip height rather than on the size of the whole image.
+ */
+class StripReader {
+public:
+	virtual ~StripReader() = default;
+
+	/// @brief	Get the size of the whole image, in pixels.
+	virtual cv::Size size() const = 0;
+
+	/**
+	 * @brief		Read the next rows of the image.
+	 * @param strip	Output image that receives the rows as 3-channel BGR pixels. Its buffer is reused when it already has the right size.
+	 * @param rows	The number of rows to read.
+	 * @returns		true when the rows were read; false when there are fewer than `rows` rows left in the image.
+	 */
+	virtual bool read(cv::Mat& strip, const int& rows) noexcept(false) = 0;
+
+	/**
+	 * @brief		Open an image file with the decoder that matches its contents.
+	 * @param path	The location of the image file. Uncompressed 24/32-bit BMP files are always supported; PNG files are supported when built with libpng.
+	 * @returns		std::unique_ptr<StripReader>
+	 */
+	static std::unique_ptr<StripReader> open(const std::filesystem::path& path) noexcept(false);
+};
+
+/**
+ * @class	BmpStripReader
+ * @brief	Strip decoder for uncompressed 24-bit & 32-bit BMP files, with a BITMAPINFOHEADER or any of the later V2 - V5 headers.
+ */
+class BmpStripReader : public StripReader {
+	std::ifstream ifs;
+	cv::Size imageSize;
+	int bytesPerPixel;
+	size_t rowStride;
+	std::streamoff dataOffset;
+	/// @brief	BMP files are usually stored bottom-up, with the last row of the image first.
+	bool bottomUp;
+	int nextRow{ 0 };
+	std::vector<uchar> buffer;
+
+	template<typename T>
+	static T get(const uchar* p)
+	{
+		T v{ 0 };
+		for (size_t i{ 0ull }; i < sizeof(T); ++i)
+			v |= static_cast<T>(static_cast<T>(p[i]) << (i * 8ull));
+		return v;
+	}
+
+public:
+	/**
+	 * @brief		Open a BMP file and read its headers.
+	 * @param path	The location of the BMP file.
+	 */
+	BmpStripReader(const std::filesystem::path& path) noexcept(false) : ifs{ path, std::ios_base::binary }
+	{
+		if (!ifs.is_open())
+			throw make_exception("Failed to open image file ", path, '!');
+
+		// BITMAPFILEHEADER, followed by the size of the info header that comes after it
+		std::array<uchar, 18ull> fileHeader{};
+		if (!ifs.read(reinterpret_cast<char*>(fileHeader.data()), fileHeader.size()) || fileHeader[0] != 'B' || fileHeader[1] != 'M')
+			throw make_exception("Image file ", path, " isn't a valid BMP file!");
+		dataOffset = static_cast<std::streamoff>(get<std::uint32_t>(&fileHeader[10]));
+
+		// BITMAPINFOHEADER is 40 bytes, and the V2 - V5 headers only add fields after it. The older 12-byte BITMAPCOREHEADER has a different layout.
+		const auto& infoSize{ get<std::uint32_t>(&fileHeader[14]) };
+		if (infoSize < 40u || infoSize > 124u)
+			throw make_exception("Image file ", path, " has an unsupported BMP header! ( ", infoSize, " bytes )");
+		// room for the channel masks, which follow a 40-byte header & are part of every larger one
+		std::vector<uchar> info(std::max<size_t>(infoSize, 56ull), 0u);
+		std::copy_n(&fileHeader[14], 4ull, info.data());
+		if (!ifs.read(reinterpret_cast<char*>(info.data() + 4), static_cast<std::streamsize>(infoSize - 4u)))
+			throw make_exception("Image file ", path, " isn't a valid BMP file!");
+
+		const auto& width{ static_cast<std::int32_t>(get<std::uint32_t>(&info[4])) }, & height{ static_cast<std::int32_t>(get<std::uint32_t>(&info[8])) };
+		const auto& bpp{ get<std::uint16_t>(&info[14]) };
+		const auto& compression{ get<std::uint32_t>(&info[16]) };
+
+		// 0 is BI_RGB; 3 is BI_BITFIELDS, which is accepted for 32-bit images whose masks select the bytes of the default BGRA channel order
+		if ((bpp != 24 && bpp != 32) || (compression != 0 && !(compression == 3 && bpp == 32)))
+			throw make_exception("Image file ", path, " can't be streamed because it isn't an uncompressed 24-bit or 32-bit BMP file!");
+		std::streamoff headersEnd{ 14 + static_cast<std::streamoff>(infoSize) };
+		if (compression == 3) {
+			if (infoSize == 40u) {
+				if (!ifs.read(reinterpret_cast<char*>(info.data() + 40), 12))
+					throw make_exception("Image file ", path, " isn't a valid BMP file!");
+				headersEnd += 12;
+			}
+			// the alpha mask is only part of the V3 header & later, and is ignored since alpha is dropped
+			const auto& alpha{ infoSize >= 56u ? get<std::uint32_t>(&info[52]) : 0u };
+			if (get<std::uint32_t>(&info[40]) != 0x00FF0000u || get<std::uint32_t>(&info[44]) != 0x0000FF00u || get<std::uint32_t>(&info[48]) != 0x000000FFu || (alpha != 0u && alpha != 0xFF000000u))
+				throw make_exception("Image file ", path, " can't be streamed because its channel masks aren't in BGRA order!");
+		}
+		if (width <= 0 || height == 0 || height == std::numeric_limits<std::int32_t>::min())
+			throw make_exception("Image file ", path, " has invalid dimensions!");
+
+		imageSize = { width, height < 0 ? -height : height };
+		bottomUp = height > 0;
+		bytesPerPixel = bpp / 8;
+		rowStride = ((static_cast<size_t>(width) * bpp + 31ull) / 32ull) * 4ull;
+
+		if (dataOffset < headersEnd || static_cast<std::uintmax_t>(dataOffset) + rowStride * static_cast<std::uintmax_t>(imageSize.height) > std::filesystem::file_size(path))
+			throw make_exception("Image file ", path, " is truncated, or its pixel data offset is invalid!");
+	}
+
+	cv::Size size() const override { return imageSize; }
+
+	bool read(cv::Mat& strip, const int& rows) noexcept(false) override
+	{
+		if (rows <= 0 || nextRow + rows > imageSize.height)
+			return false;
+
+		// rows that are next to each other in the image are also next to each other in the file, so each strip is one contiguous read
+		const size_t firstFileRow{ static_cast<size_t>(bottomUp ? imageSize.height - nextRow - rows : nextRow) };
+		buffer.resize(rowStride * rows);
+		ifs.seekg(dataOffset + static_cast<std::streamoff>(firstFileRow * rowStride));
+		if (!ifs.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size())))
+			throw make_exception("Failed to read image rows ", nextRow, " - ", nextRow + rows, '!');
+
+		strip.create(rows, imageSize.width, CV_8UC3);
+		for (int y{ 0 }; y < rows; ++y) {
+			const uchar* src{ buffer.data() + rowStride * static_cast<size_t>(bottomUp ? rows - 1 - y : y) };
+			uchar* dst{ strip.ptr<uchar>(y) };
+			if (bytesPerPixel == 3)
+				std::copy_n(src, static_cast<size_t>(imageSize.width) * 3ull, dst);
+			else for (int x{ 0 }; x < imageSize.width; ++x, src += 4, dst += 3)
+				std::copy_n(src, 3ull, dst);
+		}
+
+		nextRow += rows;
+		return true;
+	}
+};
+
+#ifdef PARSEIMG_HAS_PNG
+/**
+ * @class	PngStripReader
+ * @brief	Strip decoder for non-interlaced PNG files, using libpng.
+ *\n		All bit depths and color types are converted to 8-bit BGR.
+ */
+class PngStripReader : public StripReader {
+	std::FILE* fp{ nullptr };
+	png_structp png{ nullptr };
+	png_infop info{ nullptr };
+	cv::Size imageSize;
+	int nextRow{ 0 };
+
+	// libpng reports errors with longjmp, so nothing with a destructor may be alive between setjmp & the libpng calls in these helpers
+	bool readHeader()
+	{
+		if (setjmp(png_jmpbuf(png)))
+			return false;
+		png_init_io(png, fp);
+		png_read_info(png, info);
+
+		const auto& colorType{ png_get_color_type(png, info) };
+		if (colorType == PNG_COLOR_TYPE_PALETTE || png_get_bit_depth(png, info) < 8)
+			png_set_expand(png);
+		if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+			png_set_gray_to_rgb(png);
+		png_set_strip_16(png);
+		png_set_strip_alpha(png);
+		png_set_bgr(png);
+		png_read_update_info(png, info);
+		return true;
+	}
+	bool readRows(cv::Mat& strip, const int& rows)
+	{
+		if (setjmp(png_jmpbuf(png)))
+			return false;
+		for (int y{ 0 }; y < rows; ++y)
+			png_read_row(png, strip.ptr<uchar>(y), nullptr);
+		return true;
+	}
+
+public:
+	/**
+	 * @brief		Open a PNG file and read its headers.
+	 * @param path	The location of the PNG file.
+	 */
+	PngStripReader(const std::filesystem::path& path) noexcept(false)
+	{
+		if (fp = std::fopen(path.string().c_str(), "rb"); fp == nullptr)
+			throw make_exception("Failed to open image file ", path, '!');
+		png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+		info = png != nullptr ? png_create_info_struct(png) : nullptr;
+
+		if (info == nullptr || !readHeader()) {
+			close();
+			throw make_exception("Image file ", path, " isn't a valid PNG file!");
+		}
+		if (png_get_interlace_type(png, info) != PNG_INTERLACE_NONE) {
+			close();
+			throw make_exception("Image file ", path, " can't be streamed because it is interlaced!");
+		}
+
+		imageSize = { static_cast<int>(png_get_image_width(png, info)), static_cast<int>(png_get_image_height(png, info)) };
+	}
+	~PngStripReader() noexcept override { close(); }
+
+	/// @brief	Free the libpng structures & close the file.
+	void close() noexcept
+	{
+		if (png != nullptr)
+			png_destroy_read_struct(&png, info != nullptr ? &info : nullptr, nullptr);
+		if (fp != nullptr)
+			std::fclose(fp);
+		png = nullptr;
+		info = nullptr;
+		fp = nullptr;
+	}
+
+	cv::Size size() const override { return imageSize; }
+
+	bool read(cv::Mat& strip, const int& rows) noexcept(false) override
+	{
+		if (rows <= 0 || nextRow + rows > imageSize.height)
+			return false;
+
+		strip.create(rows, imageSize.width, CV_8UC3);
+		if (!readRows(strip, rows))
+			throw make_exception("Failed to decode image rows ", nextRow, " - ", nextRow + rows, '!');
+
+		nextRow += rows;
+		return true;
+	}
+};
+#endif
+
+inline std::unique_ptr<StripReader> StripReader::open(const std::filesystem::path& path) noexcept(false)
+{
+	std::array<char, 8ull> magic{};
+	if (std::ifstream ifs{ path, std::ios_base::binary }; !ifs.read(magic.data(), magic.size()))
+		throw make_exception("Failed to read image file ", path, '!');
+
+	if (magic[0] == 'B' && magic[1] == 'M')
+		return std::make_unique<BmpStripReader>(path);
+	if (magic[0] == '\x89' && magic[1] == 'P' && magic[2] == 'N' && magic[3] == 'G') {
+#ifdef PARSEIMG_HAS_PNG
+		return std::make_unique<PngStripReader>(path);
+#else
+		throw make_exception("Image file ", path, " can't be streamed because this build doesn't include libpng!");
+#endif
+	}
+	throw make_exception("Image file ", path, " can't be streamed! (Only BMP & PNG files are supported)");
+}
@@ -3,7 +3,6 @@
 
 #include <opencv2/opencv.hpp>
 
-#include <ostream>
 #include <map>
 #include <vector>
 
@@ -28,13 +27,6 @@ public:
 	}
 };
 
-///// @brief	A vector of pairs where the first element is a `cv::Point` and the second is a vector of `Region` types. This is used as an intermediary type between the raw input image, and the output file.
-using HoldMap = std::vector<std::pair<cv::Point, std::vector<Region>>>;
+///// @brief	A vector of pairs where the first element is a `cv::Point` and the second is a vector of region indices. This is used as an intermediary type between the raw input image, and the output file.
+using HoldMap = std::vector<std::pair<cv::Point, RegionIndexVec>>;
 
-// file writing operators:
-inline std::ostream& operator<<(std::ostream& os, const HoldMap& holdmap)
-{
-	for (const auto& [pos, regions] : holdmap)
-		os << '(' << pos.x << ',' << pos.y << ") = " << regions << '\n';
-	return os;
-}
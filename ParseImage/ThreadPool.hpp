@@ -0,0 +1,146 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @class	ThreadPool
+ * @brief	Fixed-size pool of worker threads that run queued tasks.
+ *\n		Loops are spread across the pool with `parallel_for()`, where every participating thread claims the next unclaimed index as soon as it finishes its last one.
+ */
+class ThreadPool {
+	std::mutex mtx;
+	std::condition_variable_any cv;
+	std::deque<std::function<void()>> queue;
+	std::vector<std::jthread> workers;
+
+	void work(std::stop_token stoken)
+	{
+		for (;;) {
+			std::function<void()> task;
+			{
+				std::unique_lock lock{ mtx };
+				// returns false only when a stop was requested and there is nothing left to run
+				if (!cv.wait(lock, stoken, [this] { return !queue.empty(); }))
+					return;
+				task = std::move(queue.front());
+				queue.pop_front();
+			}
+			task();
+		}
+	}
+
+	void enqueue(std::function<void()>&& task)
+	{
+		{
+			std::scoped_lock lock{ mtx };
+			queue.emplace_back(std::move(task));
+		}
+		cv.notify_one();
+	}
+
+public:
+	/// @brief	Get the number of threads supported by the hardware, or 1 if it can't be determined.
+	static unsigned hardwareConcurrency() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+	/**
+	 * @brief				Constructor.
+	 * @param threadCount	The number of worker threads to start. When this is 0, all work runs on the calling thread.
+	 */
+	explicit ThreadPool(const unsigned& threadCount)
+	{
+		workers.reserve(threadCount);
+		for (unsigned i{ 0u }; i < threadCount; ++i)
+			workers.emplace_back([this](std::stop_token stoken) { work(stoken); });
+	}
+	/// @brief	Destructor. Finishes all queued tasks, then joins the worker threads.
+	~ThreadPool() noexcept
+	{
+		for (auto& worker : workers)
+			worker.request_stop();
+		cv.notify_all();
+		workers.clear();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/// @brief	Get the number of worker threads in the pool, not including the calling thread.
+	size_t size() const { return workers.size(); }
+
+	/**
+	 * @brief		Queue a task to be run by a worker thread.
+	 * @param func	The task to run.
+	 * @returns		std::future that receives the task's result, or the exception it threw.
+	 */
+	template<typename F>
+	auto submit(F&& func) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+	{
+		using result_t = std::invoke_result_t<std::decay_t<F>>;
+		auto task{ std::make_shared<std::packaged_task<result_t()>>(std::forward<F>(func)) };
+		auto future{ task->get_future() };
+		if (workers.empty())
+			(*task)();
+		else enqueue([task] { (*task)(); });
+		return future;
+	}
+
+	/**
+	 * @brief		Call `body(i)` for every `i` in the range [ 0, count ), using the calling thread and every worker thread.
+	 *\n			Indices are claimed in ascending order, but may finish in any order.
+	 *\n			This is safe to call from inside a task that is already running on the pool, since the calling thread keeps claiming indices until none are left.
+	 * @param count	The number of indices to process.
+	 * @param body	Callable with signature `void(size_t)`. If any call throws, the first exception is rethrown once all claimed indices have finished.
+	 */
+	template<typename F>
+	void parallel_for(const size_t& count, F&& body) noexcept(false)
+	{
+		struct State {
+			std::atomic<size_t> next{ 0ull };
+			size_t done{ 0ull };
+			size_t count;
+			std::mutex mtx;
+			std::condition_variable cv;
+			std::exception_ptr error;
+
+			State(const size_t& count) : count{ count } {}
+		};
+		const auto& state{ std::make_shared<State>(count) };
+
+		// Helpers that start after every index was claimed return without touching `body`, so it is only referenced while this function is still waiting.
+		const auto& run{ [state, &body] {
+			for (size_t i{ state->next.fetch_add(1ull) }; i < state->count; i = state->next.fetch_add(1ull)) {
+				std::exception_ptr error;
+				try {
+					body(i);
+				} catch (...) {
+					error = std::current_exception();
+				}
+				std::scoped_lock lock{ state->mtx };
+				if (error && !state->error)
+					state->error = error;
+				if (++state->done == state->count)
+					state->cv.notify_all();
+			}
+		} };
+
+		for (size_t i{ 0ull }, helpers{ std::min<size_t>(workers.size(), count > 0ull ? count - 1ull : 0ull) }; i < helpers; ++i)
+			enqueue(run);
+
+		run();
+
+		std::unique_lock lock{ state->mtx };
+		state->cv.wait(lock, [&state] { return state->done == state->count; });
+		if (state->error)
+			std::rethrow_exception(state->error);
+	}
+};
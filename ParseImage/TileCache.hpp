@@ -0,0 +1,178 @@
+#pragma once
+#include "Hash.hpp"
+#include "PartitionStats.hpp"
+#include "Region.hpp"
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <vector>
+
+/**
+ * @class	TileCache
+ * @brief	Persistent cache of the pixel counts of every cell, keyed by a hash of each cell's raw pixels.
+ *\n		Cells are hashed before their colors are looked up, so a cell that is found in the cache skips the `ColorLUT` entirely.
+ *\n		The whole cache is tied to a key made from the region colors & the cell grid, so it is discarded when either of them change.
+ *\n		Different cells may be read & written concurrently, but a single cell must only be accessed by one thread at a time.
+ */
+class TileCache {
+public:
+	using count = PartitionStats::count;
+
+private:
+	static constexpr std::array<char, 8ull> MAGIC{ 'P', 'I', 'M', 'G', 'T', 'I', 'L', 'E' };
+	static constexpr std::uint32_t VERSION{ 3u };
+
+	std::uint64_t key{ 0ull };
+	cv::Size gridSize{ 0, 0 };
+	size_t stride{ 0ull };
+	/// @brief	Whether each cell has a stored hash & counts.
+	std::vector<uchar> valid;
+	std::vector<std::uint64_t> hashes;
+	std::vector<count> counts;
+
+	size_t index(const int& x, const int& y) const { return static_cast<size_t>(y) * gridSize.width + x; }
+
+	template<typename T>
+	static bool readArray(std::istream& is, std::vector<T>& vec) { return static_cast<bool>(is.read(reinterpret_cast<char*>(vec.data()), static_cast<std::streamsize>(vec.size() * sizeof(T)))); }
+	template<typename T>
+	static void writeArray(std::ostream& os, const std::vector<T>& vec) { os.write(reinterpret_cast<const char*>(vec.data()), static_cast<std::streamsize>(vec.size() * sizeof(T))); }
+	template<typename T>
+	static bool readValue(std::istream& is, T& value) { return static_cast<bool>(is.read(reinterpret_cast<char*>(&value), sizeof(T))); }
+	template<typename T>
+	static void writeValue(std::ostream& os, const T& value) { os.write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+public:
+	/**
+	 * @brief				Create an empty cache.
+	 * @param regions		The regions that cells are classified with. Only their colors & order affect the key.
+	 * @param gridSize		The number of cells along each axis.
+	 * @param cellSize		The size of one cell, in pixels.
+	 * @param tolerance		The color tolerance that cells are classified with.
+	 */
+	TileCache(const RegionTable& regions, const cv::Size& gridSize, const cv::Size& cellSize, const unsigned& tolerance = 0u) :
+		key{ makeKey(regions, gridSize, cellSize, tolerance) },
+		gridSize{ gridSize },
+		stride{ regions.size() + 1ull },
+		valid(static_cast<size_t>(gridSize.area()), 0u),
+		hashes(static_cast<size_t>(gridSize.area()), 0ull),
+		counts(static_cast<size_t>(gridSize.area()) * stride, 0u) {}
+
+	/**
+	 * @brief				Get the key that a cache file must have in order to be used with a set of regions & cell grid.
+	 * @param regions		The regions that cells are classified with.
+	 * @param gridSize		The number of cells along each axis.
+	 * @param cellSize		The size of one cell, in pixels.
+	 * @param tolerance		The color tolerance that cells are classified with.
+	 * @returns				std::uint64_t
+	 */
+	static std::uint64_t makeKey(const RegionTable& regions, const cv::Size& gridSize, const cv::Size& cellSize, const unsigned& tolerance = 0u)
+	{
+		const std::array<int, 5ull> dims{ gridSize.width, gridSize.height, cellSize.width, cellSize.height, static_cast<int>(tolerance) };
+		std::uint64_t h{ hash::xxh64(dims.data(), sizeof(dims)) };
+		for (const auto& region : regions.getRegions()) {
+			const std::array<uchar, 3ull> rgb{ region.color.r(), region.color.g(), region.color.b() };
+			h = hash::xxh64(rgb.data(), rgb.size(), h);
+		}
+		return h;
+	}
+
+	/// @brief	Get the key of this cache, which is the result of `makeKey()` for the arguments that it was created with.
+	std::uint64_t getKey() const { return key; }
+
+	/**
+	 * @brief		Hash the raw pixels of one cell.
+	 * @param strip	An image strip exactly one cell tall. This is the decoded BGR strip when the image is streamed, and a label strip when it was loaded whole or read from a region raster file.
+	 * @param x		The column index of the cell.
+	 * @param width	The width of one cell, in pixels.
+	 * @returns		std::uint64_t
+	 */
+	static std::uint64_t hashCell(const cv::Mat& strip, const int& x, const int& width)
+	{
+		const size_t rowBytes{ static_cast<size_t>(width) * strip.elemSize() }, offset{ static_cast<size_t>(x) * rowBytes };
+		std::uint64_t h{ 0ull };
+		for (int y{ 0 }; y < strip.rows; ++y)
+			h = hash::xxh64(strip.ptr<uchar>(y) + offset, rowBytes, h);
+		return h;
+	}
+
+	/**
+	 * @brief		Load a cache file. Files that are missing, corrupt, or that were made with a different key are ignored.
+	 * @param path	The location of the cache file.
+	 * @returns		true when the file was loaded; false when the cache was left empty.
+	 */
+	bool load(const std::filesystem::path& path)
+	{
+		std::ifstream ifs{ path, std::ios_base::binary };
+		if (!ifs.is_open())
+			return false;
+
+		std::array<char, 8ull> magic{};
+		std::uint32_t version{ 0u }, fileStride{ 0u };
+		std::uint64_t fileKey{ 0ull };
+		if (!ifs.read(magic.data(), magic.size()) || magic != MAGIC || !readValue(ifs, version) || version != VERSION
+			|| !readValue(ifs, fileStride) || fileStride != stride || !readValue(ifs, fileKey) || fileKey != key)
+			return false;
+
+		if (!readArray(ifs, valid) || !readArray(ifs, hashes) || !readArray(ifs, counts)) {
+			std::fill(valid.begin(), valid.end(), 0u);
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * @brief		Save the cache to a file.
+	 * @param path	The location of the cache file. It is overwritten if it already exists.
+	 * @returns		true when successful.
+	 */
+	bool save(const std::filesystem::path& path) const
+	{
+		std::ofstream ofs{ path, std::ios_base::binary | std::ios_base::trunc };
+		if (!ofs.is_open())
+			return false;
+		ofs.write(MAGIC.data(), MAGIC.size());
+		writeValue(ofs, VERSION);
+		writeValue(ofs, static_cast<std::uint32_t>(stride));
+		writeValue(ofs, key);
+		writeArray(ofs, valid);
+		writeArray(ofs, hashes);
+		writeArray(ofs, counts);
+		return static_cast<bool>(ofs);
+	}
+
+	/**
+	 * @brief		Get the stored counts of a cell, if its pixels haven't changed.
+	 * @param x		The column index of the cell.
+	 * @param y		The row index of the cell.
+	 * @param hash	The hash of the cell's current pixels, from `hashCell()`.
+	 * @returns		The counts of the cell indexed by `RegionIndex`, or std::nullopt when the cell isn't cached or has changed.
+	 */
+	std::optional<std::span<const count>> find(const int& x, const int& y, const std::uint64_t& hash) const
+	{
+		if (const auto& i{ index(x, y) }; valid[i] != 0u && hashes[i] == hash)
+			return std::span<const count>{ counts.data() + i * stride, stride };
+		return std::nullopt;
+	}
+
+	/**
+	 * @brief			Store the counts of a cell.
+	 * @param x			The column index of the cell.
+	 * @param y			The row index of the cell.
+	 * @param hash		The hash of the cell's pixels, from `hashCell()`.
+	 * @param values	The counts of the cell, indexed by `RegionIndex`.
+	 */
+	void store(const int& x, const int& y, const std::uint64_t& hash, std::span<const count> values)
+	{
+		const auto& i{ index(x, y) };
+		valid[i] = 1u;
+		hashes[i] = hash;
+		std::copy_n(values.begin(), std::min(values.size(), stride), counts.begin() + i * stride);
+	}
+};
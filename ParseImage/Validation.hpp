@@ -0,0 +1,123 @@
+#pragma once
+#include "Logger.hpp"
+#include "Region.hpp"
+
+#include <TermAPI.hpp>
+#include <make_exception.hpp>
+#include <strmath.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// declared in the namespace of RGB so that it is found by argument-dependent lookup from within templates
+namespace color {
+	inline std::ostream& operator<<(std::ostream& os, const ::RGB& rgb)
+	{
+		return os << str::fromBase10(rgb.r(), 16) << str::fromBase10(rgb.g(), 16) << str::fromBase10(rgb.b(), 16);
+	}
+}
+
+/**
+ * @brief				Check that no two regions share the same color or map name.
+ *\n					Regions are grouped by hashing their color & map name, so this takes linear time.
+ *\n					Every duplicate is logged as an error before an exception is thrown.
+ * @param regionVec		The regions to check.
+ * @param logger		The logger to write each duplicate to.
+ */
+inline void ValidateRegionVec(RegionVec const& regionVec, Logger& logger)
+{
+	// groups the indices of regions by a key, in the order that each key first appears
+	const auto& findDuplicates{ [&regionVec]<typename Key>(const auto& getKey) {
+		std::unordered_map<Key, size_t> groupOf;
+		groupOf.reserve(regionVec.size());
+		std::vector<std::vector<size_t>> groups;
+		for (size_t i{ 0ull }; i < regionVec.size(); ++i) {
+			const auto& [it, inserted] { groupOf.try_emplace(getKey(regionVec[i]), groups.size()) };
+			if (inserted)
+				groups.emplace_back();
+			auto& group{ groups[it->second] };
+			// the same region may appear more than once
+			if (std::none_of(group.begin(), group.end(), [&](const size_t& j) { return regionVec[j].id == regionVec[i].id; }))
+				group.emplace_back(i);
+		}
+		std::erase_if(groups, [](const auto& group) { return group.size() < 2ull; });
+		return groups;
+	} };
+	const auto& getRegions{ [&regionVec](const std::vector<size_t>& group) {
+		RegionVec regions;
+		regions.reserve(group.size());
+		for (const auto& i : group)
+			regions.emplace_back(regionVec[i]);
+		return regions;
+	} };
+
+	const auto& color_errors{ findDuplicates.template operator()<std::uint32_t>([](const Region& region) { return (static_cast<std::uint32_t>(region.color.r()) << 16) | (static_cast<std::uint32_t>(region.color.g()) << 8) | region.color.b(); }) };
+	const auto& name_errors{ findDuplicates.template operator()<std::string_view>([](const Region& region) { return std::string_view{ region.mapName }; }) };
+
+	if (color_errors.empty() && name_errors.empty())
+		return;
+
+	for (const auto& group : color_errors)
+		logger.error() << term::get_error() << "Color '" << regionVec[group.front()].color << "' is assigned to multiple regions! " << getRegions(group) << std::endl;
+	for (const auto& group : name_errors)
+		logger.error() << term::get_error() << "Map Name '" << regionVec[group.front()].mapName << "' is assigned to multiple regions! " << getRegions(group) << std::endl;
+
+	throw make_exception("One or more regions have identical mapping data, the generator cannot continue!");
+}
+
+/**
+ * @brief				Find every pair of regions whose colors are different, but within a given distance of each other.
+ *\n					Anti-aliased edges blend neighbouring colors, so these are the colors most likely to be confused with each other.
+ *\n					Colors are bucketed in a uniform 3D grid with cells as wide as the distance, so only neighbouring buckets are compared.
+ * @param regionVec		The regions to check.
+ * @param distance		The maximum euclidean distance between two colors in RGB space for them to be considered near each other.
+ * @returns				The indices in `regionVec` of each pair of near regions, ordered by the first index and then the second.
+ */
+inline std::vector<std::pair<size_t, size_t>> FindNearColors(RegionVec const& regionVec, const unsigned& distance)
+{
+	std::vector<std::pair<size_t, size_t>> pairs;
+	if (distance == 0u)
+		return pairs;
+
+	const auto& bucketOf{ [&distance](const uchar& v) { return static_cast<int>(v / distance); } };
+	const auto& keyOf{ [](const int& r, const int& g, const int& b) { return (static_cast<std::uint32_t>(r) << 16) | (static_cast<std::uint32_t>(g) << 8) | static_cast<std::uint32_t>(b); } };
+	const int maxBucket{ bucketOf(255) };
+
+	std::unordered_map<std::uint32_t, std::vector<size_t>> buckets;
+	buckets.reserve(regionVec.size());
+	for (size_t i{ 0ull }; i < regionVec.size(); ++i) {
+		const auto& c{ regionVec[i].color };
+		buckets[keyOf(bucketOf(c.r()), bucketOf(c.g()), bucketOf(c.b()))].emplace_back(i);
+	}
+
+	const int limit{ static_cast<int>(distance * distance) };
+	for (size_t i{ 0ull }; i < regionVec.size(); ++i) {
+		const auto& c{ regionVec[i].color };
+		const int br{ bucketOf(c.r()) }, bg{ bucketOf(c.g()) }, bb{ bucketOf(c.b()) };
+		for (int r{ std::max(0, br - 1) }; r <= std::min(maxBucket, br + 1); ++r) {
+			for (int g{ std::max(0, bg - 1) }; g <= std::min(maxBucket, bg + 1); ++g) {
+				for (int b{ std::max(0, bb - 1) }; b <= std::min(maxBucket, bb + 1); ++b) {
+					const auto& it{ buckets.find(keyOf(r, g, b)) };
+					if (it == buckets.end())
+						continue;
+					for (const auto& j : it->second) {
+						if (j <= i || regionVec[j].id == regionVec[i].id)
+							continue; // each pair is only checked once
+						const auto& o{ regionVec[j].color };
+						const int dr{ c.r() - o.r() }, dg{ c.g() - o.g() }, db{ c.b() - o.b() };
+						if (const int d2{ dr * dr + dg * dg + db * db }; d2 != 0 && d2 <= limit)
+							pairs.emplace_back(i, j);
+					}
+				}
+			}
+		}
+	}
+
+	std::sort(pairs.begin(), pairs.end());
+	return pairs;
+}
@@ -0,0 +1,316 @@
+#include "../BinaryMapWriter.hpp"
+#include "../MapTextWriter.hpp"
+#include "../CellMapper.hpp"
+#include "../CellMatrix.hpp"
+#include "../ColorLUT.hpp"
+#include "../PartitionStats.hpp"
+#include "../QueryIndex.hpp"
+#include "../RegionAreaMap.hpp"
+#include "../TMap.hpp"
+#include "../Validation.hpp"
+
+#include <TermAPI.hpp>
+#include <ParamsAPI2.hpp>
+
+#include <opencv2/opencv.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+/**
+ * @struct	BenchResult
+ * @brief	The fastest time of one benchmark, and the amount of work that was done in that time.
+ */
+struct BenchResult {
+	std::string name;
+	double seconds{ 0.0 };
+	size_t pixels{ 0ull };
+	size_t cells{ 0ull };
+	size_t regions{ 0ull };
+	size_t queries{ 0ull };
+};
+
+/// @brief	Results are accumulated here so that the compiler can't remove the work being measured.
+static volatile size_t sink{ 0ull };
+
+/**
+ * @brief				Run a function several times and get the fastest time.
+ * @param iterations	The number of times to run the function.
+ * @param func			The function to measure.
+ * @returns				The fastest run, in seconds.
+ */
+template<typename F>
+double measure(const unsigned& iterations, F&& func)
+{
+	using CLK = std::chrono::steady_clock;
+	double best{ std::numeric_limits<double>::max() };
+	for (unsigned i{ 0u }; i < iterations; ++i) {
+		const auto& t_start{ CLK::now() };
+		func();
+		best = std::min(best, std::chrono::duration<double>(CLK::now() - t_start).count());
+	}
+	return best;
+}
+
+/**
+ * @brief			Create a set of regions with unique colors & names.
+ * @param count		The number of regions to create.
+ * @returns			RegionVec
+ */
+RegionVec makeRegions(const size_t& count)
+{
+	RegionVec vec;
+	vec.reserve(count);
+	for (size_t i{ 1ull }; i <= count; ++i) {
+		const std::string name{ "xxxMapRegion" + std::to_string(i) };
+		vec.emplace_back(name, "Region " + std::to_string(i), RGB{ static_cast<uchar>(i & 0xFF), static_cast<uchar>((i >> 8) & 0xFF), 0x80 }, static_cast<ushort>(i % 100ull));
+	}
+	return vec;
+}
+
+/**
+ * @brief			Create an image that looks like a hand-drawn region map.
+ *\n				Regions are drawn as large rectangles that span several cells, with gaps of unmatched pixels between them & a small amount of noise everywhere.
+ * @param size		The size of the image, in pixels.
+ * @param cellSize	The size of one cell, in pixels.
+ * @param regions	The regions to draw.
+ * @param seed		Seed for the noise.
+ * @returns			cv::Mat
+ */
+cv::Mat makeImage(const cv::Size& size, const cv::Size& cellSize, const RegionVec& regions, const unsigned& seed)
+{
+	cv::Mat image(size, CV_8UC3);
+	std::mt19937 rng{ seed };
+	const int blockW{ cellSize.width * 5 }, blockH{ cellSize.height * 3 };
+	for (int y{ 0 }; y < size.height; ++y) {
+		uchar* px{ image.ptr<uchar>(y) };
+		for (int x{ 0 }; x < size.width; ++x, px += 3) {
+			const size_t block{ (static_cast<size_t>(x / blockW) * 7ull + static_cast<size_t>(y / blockH) * 13ull) % (regions.size() + 1ull) };
+			if (block == 0ull || rng() % 100u < 2u) { // background & noise
+				px[0] = 0xFF;
+				px[1] = static_cast<uchar>(rng());
+				px[2] = static_cast<uchar>(rng());
+			}
+			else {
+				const auto& color{ regions[block - 1ull].color };
+				px[0] = color.b();
+				px[1] = color.g();
+				px[2] = color.r();
+			}
+		}
+	}
+	return image;
+}
+
+int main(const int argc, char** argv)
+{
+	try {
+		opt::ParamsAPI2 args{ argc, argv, 'W', "width", 'H', "height", 'c', "cell", 'r', "regions", 'n', "iterations", 's', "seed", 'j', "jobs" };
+
+		if (args.check_any<opt::Flag, opt::Option>('h', "help")) {
+			std::cout
+				<< "parseimg_bench Usage:\n"
+				<< "  parseimg_bench <OPTIONS>\n"
+				<< '\n'
+				<< "OPTIONS:\n"
+				<< "  -h  --help              Shows this usage guide.\n"
+				<< "  -W  --width <px>        The width of the synthetic image. Default is 3000.\n"
+				<< "  -H  --height <px>       The height of the synthetic image. Default is 2000.\n"
+				<< "  -c  --cell <px>         The width & height of one cell. Default is 20.\n"
+				<< "  -r  --regions <N>       The number of regions in the synthetic config. Default is 64.\n"
+				<< "  -n  --iterations <N>    The number of times to run each benchmark. The fastest run is reported. Default is 5.\n"
+				<< "  -s  --seed <N>          Seed for the synthetic image. Default is 1.\n"
+				<< "  -j  --jobs <N>          The number of threads to use for the CellMapper & RegionAreaMap benchmarks. Default is the number of hardware threads.\n"
+				<< "                           RegionAreaMap is also measured with every power of 2 below this, to show how it scales.\n"
+				;
+			return 0;
+		}
+
+		const auto& getUnsigned{ [&args](const char& flag, const std::string& name, const unsigned& defaultValue) {
+			return args.castgetv_any<unsigned, opt::Flag, opt::Option>([&name](std::string&& str) -> unsigned {
+				if (!str.empty() && std::all_of(str.begin(), str.end(), isdigit))
+					return static_cast<unsigned>(str::stoi(std::move(str)));
+				else throw make_exception("Invalid ", name, " value '", str, "' contains invalid characters! (Only digits are allowed)");
+			}, flag, name).value_or(defaultValue);
+		} };
+
+		const cv::Size imageSize{ static_cast<int>(getUnsigned('W', "width", 3000u)), static_cast<int>(getUnsigned('H', "height", 2000u)) };
+		const int cellLength{ static_cast<int>(std::max(1u, getUnsigned('c', "cell", 20u))) };
+		const cv::Size cellSize{ cellLength, cellLength };
+		const size_t regionCount{ std::clamp<size_t>(getUnsigned('r', "regions", 64u), 1ull, 65534ull) };
+		const unsigned iterations{ std::max(1u, getUnsigned('n', "iterations", 5u)) };
+		const unsigned seed{ getUnsigned('s', "seed", 1u) };
+		const unsigned jobs{ std::max(1u, getUnsigned('j', "jobs", ThreadPool::hardwareConcurrency())) };
+
+		const cv::Size gridSize{ imageSize.width / cellSize.width, imageSize.height / cellSize.height };
+		if (gridSize.area() == 0)
+			throw make_exception("The image is smaller than one cell!");
+
+		const auto& regionTable{ std::make_shared<const RegionTable>(makeRegions(regionCount)) };
+		const ColorLUT lut{ regionTable };
+		const cv::Mat image{ makeImage(imageSize, cellSize, regionTable->getRegions(), seed) };
+
+		const size_t pixels{ static_cast<size_t>(gridSize.width) * cellSize.width * static_cast<size_t>(gridSize.height) * cellSize.height };
+		const size_t cells{ static_cast<size_t>(gridSize.area()) };
+
+		std::cout
+			<< "Image:       " << imageSize.width << " x " << imageSize.height << " px\n"
+			<< "Cells:       " << gridSize.width << " x " << gridSize.height << "  ( " << cellSize.width << " x " << cellSize.height << " px )\n"
+			<< "Regions:     " << regionCount << '\n'
+			<< "Kernel:      " << kernel::getName(lut.getISA()) << '\n'
+			<< "Iterations:  " << iterations << '\n'
+			<< std::endl;
+
+		std::vector<BenchResult> results;
+
+		results.push_back({ "PartitionStats::parse", measure(iterations, [&] {
+			PartitionStats stats;
+			for (int y{ 0 }; y < gridSize.height; ++y) {
+				for (int x{ 0 }; x < gridSize.width; ++x) {
+					stats.parse(image(cv::Rect{ x * cellSize.width, y * cellSize.height, cellSize.width, cellSize.height }), lut);
+					sink = sink + stats.getMatchedCount();
+				}
+			}
+		}), pixels, cells });
+
+		results.push_back({ "CellMatrix", measure(iterations, [&] {
+			const CellMatrix matrix{ image, cellSize, lut };
+			sink = sink + matrix.getMatchedCount(0, 0);
+		}), pixels, cells });
+
+		CellMapper::Result mapped;
+		{
+			ThreadPool pool{ jobs - 1u };
+			const CellMapper mapper{ lut, gridSize, cellSize, 0.0f };
+			results.push_back({ "CellMapper::run (" + std::to_string(jobs) + " jobs)", measure(iterations, [&] {
+				mapped = mapper.run([&](const int& y) { return image.rowRange(y * cellSize.height, (y + 1) * cellSize.height); }, &pool);
+			}), pixels, cells });
+		}
+
+		results.push_back({ "ColorLUT::find", measure(iterations, [&] {
+			size_t matched{ 0ull };
+			for (int y{ 0 }; y < image.rows; ++y) {
+				const uchar* px{ image.ptr<uchar>(y) };
+				for (int x{ 0 }; x < image.cols; ++x, px += 3)
+					matched += lut.find(px) != ColorLUT::NONE;
+			}
+			sink = sink + matched;
+		}), static_cast<size_t>(image.total()) });
+
+		results.push_back({ "ColorLUT build (tolerance 8)", measure(iterations, [&] {
+			const ColorLUT fuzzy{ regionTable, 8u };
+			sink = sink + fuzzy.find(regionTable->getRegions().front().color);
+		}), 0ull, 0ull, regionCount });
+
+		{
+			const ColorMap colorMap{ regionTable->getRegions() };
+			results.push_back({ "ColorMap::find", measure(iterations, [&] {
+				size_t matched{ 0ull };
+				for (int y{ 0 }; y < image.rows; ++y) {
+					const uchar* px{ image.ptr<uchar>(y) };
+					for (int x{ 0 }; x < image.cols; ++x, px += 3)
+						matched += colorMap.find(RGB{ px[2], px[1], px[0] }) != colorMap.end();
+				}
+				sink = sink + matched;
+			}), static_cast<size_t>(image.total()) });
+		}
+
+		size_t regionCells{ 0ull };
+		for (const auto& [index, stats] : mapped.regionStats)
+			regionCells += stats.size();
+
+		results.push_back({ "RegionStats::filter_region_area", measure(iterations, [&] {
+			for (const auto& [index, stats] : mapped.regionStats)
+				sink = sink + stats.filter_region_area().size();
+		}), 0ull, regionCells, mapped.regionStats.size() });
+
+		// polygon tracing with an increasing number of threads, to show how it scales with the number of regions found
+		for (unsigned threads{ 1u }; ; threads = std::min(threads * 2u, jobs)) {
+			ThreadPool pool{ threads - 1u };
+			results.push_back({ "RegionAreaMap (" + std::to_string(threads) + " jobs)", measure(iterations, [&] {
+				sink = sink + RegionAreaMap{ mapped.regionStats, &pool }.size();
+			}), 0ull, regionCells, mapped.regionStats.size() });
+			if (threads == jobs)
+				break;
+		}
+
+		{
+			// the synthetic regions are all distinct, so nothing is ever logged
+			Logger logger{ LogLevel::Error, std::cerr };
+			results.push_back({ "ValidateRegionVec", measure(iterations, [&] {
+				ValidateRegionVec(regionTable->getRegions(), logger);
+			}), 0ull, 0ull, regionCount });
+		}
+
+		results.push_back({ "FindNearColors (distance 8)", measure(iterations, [&] {
+			sink = sink + FindNearColors(regionTable->getRegions(), 8u).size();
+		}), 0ull, 0ull, regionCount });
+
+		const RegionAreaMap regionAreas{ mapped.regionStats };
+
+		results.push_back({ "Text output", measure(iterations, [&] {
+			sink = sink + maptext::serialize(*regionTable, gridSize, regionAreas, mapped.holdMap, &mapped.winners).size();
+		}), 0ull, cells, regionCount });
+
+		results.push_back({ "Binary output", measure(iterations, [&] {
+			sink = sink + binmap::serialize(*regionTable, gridSize, regionAreas, mapped.holdMap, mapped.winners).size();
+		}), 0ull, cells, regionCount });
+
+		{
+			// random cells & points over the whole grid, including the parts that aren't in any region
+			const QueryIndex index{ *regionTable, gridSize, regionAreas, mapped.holdMap, mapped.winners };
+			const auto& header{ index.getReader().getHeader() };
+			constexpr size_t queryCount{ 1ull << 20 };
+			std::mt19937 rng{ seed };
+			std::uniform_real_distribution<double> xDist{ static_cast<double>(header.originX), static_cast<double>(header.originX + header.gridWidth) };
+			std::uniform_real_distribution<double> yDist{ static_cast<double>(header.originY - header.gridHeight + 1), static_cast<double>(header.originY + 1) };
+			std::vector<std::pair<double, double>> points(queryCount);
+			for (auto& [x, y] : points)
+				x = xDist(rng), y = yDist(rng);
+
+			results.push_back({ "QueryIndex::cell", measure(iterations, [&] {
+				size_t found{ 0ull };
+				for (const auto& [x, y] : points)
+					found += index.cell(static_cast<std::int32_t>(std::floor(x)), static_cast<std::int32_t>(std::floor(y))).size();
+				sink = sink + found;
+			}), 0ull, 0ull, 0ull, queryCount });
+
+			std::vector<std::uint16_t> found;
+			results.push_back({ "QueryIndex::regionsAt", measure(iterations, [&] {
+				for (const auto& [x, y] : points) {
+					found.clear();
+					index.regionsAt(x, y, found);
+					sink = sink + found.size();
+				}
+			}), 0ull, 0ull, 0ull, queryCount });
+		}
+
+		const auto& rate{ [](const size_t& count, const double& seconds) -> std::string {
+			if (count == 0ull)
+				return "-";
+			std::ostringstream ss;
+			ss << std::scientific << std::setprecision(3) << (static_cast<double>(count) / seconds);
+			return ss.str();
+		} };
+
+		std::cout << std::left << std::setw(36) << "Benchmark" << std::right << std::setw(12) << "Best (ms)" << std::setw(14) << "px/s" << std::setw(14) << "cells/s" << std::setw(14) << "regions/s" << std::setw(14) << "queries/s" << '\n';
+		for (const auto& result : results) {
+			std::cout
+				<< std::left << std::setw(36) << result.name << std::right
+				<< std::setw(12) << std::fixed << std::setprecision(3) << result.seconds * 1000.0
+				<< std::setw(14) << rate(result.pixels, result.seconds)
+				<< std::setw(14) << rate(result.cells, result.seconds)
+				<< std::setw(14) << rate(result.regions, result.seconds)
+				<< std::setw(14) << rate(result.queries, result.seconds)
+				<< '\n';
+		}
+		std::cout.flush();
+
+		return 0;
+	} catch (const std::exception& ex) {
+		std::cerr << term::get_error() << ex.what() << std::endl;
+		return 1;
+	}
+}
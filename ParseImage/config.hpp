@@ -1,4 +1,5 @@
 #pragma once
+#include "Logger.hpp"
 #include "Region.hpp"
 
 #include <TermAPI.hpp>
@@ -6,7 +7,15 @@
 #include <color-transform.hpp>
 
 namespace cfg {
-	inline RegionVec getRegions(file::MINI const& regions, ushort const& default_priority = 56)
+	/**
+	 * @brief					Read every region of a config.
+	 *\n						Regions without a valid color are skipped, with a warning or an error.
+	 * @param regions			The merged INI config files, where each section is a region.
+	 * @param logger			The logger to write skipped regions to.
+	 * @param default_priority	The priority of regions that don't specify one.
+	 * @returns					RegionVec
+	 */
+	inline RegionVec getRegions(file::MINI const& regions, Logger& logger, ushort const& default_priority = 56)
 	{
 		RegionVec vec;
 		vec.reserve(regions.size());
@@ -17,12 +26,12 @@ namespace cfg {
 				if (const auto& hexstr{ color.value() }; hexstr.size() == 6ull && std::all_of(hexstr.begin(), hexstr.end(), str::ishexdigit))
 					reg.color = color::hex_to_rgb(hexstr, { 0, 255 });
 				else {
-					std::cerr << term::get_error() << "Skipping region '" << edid << "' because '" << hexstr << "' isn't a valid 3-channel hexadecimal color value!" << std::endl;
+					logger.error() << term::get_error() << "Skipping region '" << edid << "' because '" << hexstr << "' isn't a valid 3-channel hexadecimal color value!" << std::endl;
 					continue;
 				}
 			}
 			else {
-				std::cerr << term::get_warn() << "Skipping region '" << edid << "' because it doesn't specify a color!" << std::endl;
+				logger.warn() << term::get_warn() << "Skipping region '" << edid << "' because it doesn't specify a color!" << std::endl;
 				continue;
 			}
 			// editor ID
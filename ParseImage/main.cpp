@@ -1,8 +1,20 @@
 #include "LogRedirect.hpp"
-#include "output_operators.hpp"
 #include "PartitionStats.hpp"
+#include "CellMapper.hpp"
 #include "config.hpp"
 #include "ImageWrapper.hpp"
+#include "ImageStrips.hpp"
+#include "TileCache.hpp"
+#include "BinaryMapWriter.hpp"
+#include "MapTextWriter.hpp"
+#include "RasterEncoder.hpp"
+#include "Validation.hpp"
+#include "RegionAreaMap.hpp"
+#include "RunStats.hpp"
+#include "Logger.hpp"
+#include "Job.hpp"
+#include "LabelImage.hpp"
+#include "QueryServer.hpp"
 #include "RegionStatsMap.hpp"
 
 #include <TermAPI.hpp>
@@ -14,6 +26,15 @@
 
 #include <opencv2/opencv.hpp>
 
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <optional>
+
+#ifdef _WIN32
+#include <malloc.h> //< _aligned_malloc
+#endif
+
 /**
  * @brief				Parse a given string by splitting it with one of the given delimiters, then converting both sides to integral types.
  * @tparam RetType		Either a `cv::Point` or `cv::Size` type.
@@ -30,73 +51,340 @@ RetType parse_string(const std::string& s, const std::string& seperators = ":,")
 	else throw make_exception("Cannot parse string '", s, "' into a valid pair of integrals!");
 }
 
-
-/// @brief	Translates index coordinates (origin 0,0 top-left) to cell coordinates (origin -74, 49 top-left)
-cv::Point offsetCellCoordinates(const cv::Point& p, const cv::Point& pMin = { 0, 0 }, const cv::Point& pMax = { 149, 99 })
-{
-	const cv::Point cellMin{ -74, 49 }, cellMax{ 75, -50 };
-
-	const auto& translateAxis{ [](const auto& v, const auto& oldMin, const auto& oldMax, const auto& newMin, const auto& newMax) {
-		if (oldMin == oldMax || newMin == newMax)
-			throw make_exception("Invalid translation: ( ", oldMin, " - ", oldMax, " ) => ( ", newMin, " - ", newMax, " )");
-		const auto
-			& oldRange{ oldMax - oldMin },
-			& newRange{ newMax - newMin };
-		return (((v - oldMin) * newRange) / oldRange) + newMin;
-	} };
-
-	return{
-		translateAxis(p.x, pMin.x, pMax.x, cellMin.x, cellMax.x),
-		translateAxis(p.y, pMin.y, pMax.y, cellMin.y, cellMax.y)
-	};
+// count every allocation for the '--stats' report; every replaceable form is replaced, so that memory is always freed by the function that matches its allocation
+namespace {
+	void* allocate(const std::size_t& size, const std::size_t& alignment = 0ull) noexcept
+	{
+		if (alloc::enabled.load(std::memory_order_relaxed)) {
+			alloc::count.fetch_add(1ull, std::memory_order_relaxed);
+			alloc::bytes.fetch_add(size, std::memory_order_relaxed);
+		}
+		const std::size_t n{ size == 0ull ? 1ull : size };
+		if (alignment == 0ull)
+			return std::malloc(n);
+#ifdef _WIN32
+		return _aligned_malloc(n, alignment);
+#else
+		// the size passed to aligned_alloc must be a multiple of the alignment
+		return std::aligned_alloc(alignment, (n + alignment - 1ull) & ~(alignment - 1ull));
+#endif
+	}
+	void deallocate(void* p, const bool& aligned = false) noexcept
+	{
+#ifdef _WIN32
+		if (aligned)
+			return _aligned_free(p);
+#endif
+		(void)aligned;
+		std::free(p);
+	}
+	void* allocateOrThrow(const std::size_t& size, const std::size_t& alignment = 0ull) noexcept(false)
+	{
+		if (void* p{ allocate(size, alignment) })
+			return p;
+		throw std::bad_alloc{};
+	}
 }
+void* operator new(std::size_t size) { return allocateOrThrow(size); }
+void* operator new[](std::size_t size) { return allocateOrThrow(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t al) { return allocateOrThrow(size, static_cast<std::size_t>(al)); }
+void* operator new[](std::size_t size, std::align_val_t al) { return allocateOrThrow(size, static_cast<std::size_t>(al)); }
+void* operator new(std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return allocate(size, static_cast<std::size_t>(al)); }
+void* operator new[](std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return allocate(size, static_cast<std::size_t>(al)); }
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, std::size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::size_t) noexcept { deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t) noexcept { deallocate(p, true); }
+void operator delete[](void* p, std::align_val_t) noexcept { deallocate(p, true); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { deallocate(p, true); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { deallocate(p, true); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(p, true); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(p, true); }
 
-inline std::ostream& operator<<(std::ostream& os, const RGB& rgb)
-{
-	return os << str::fromBase10(rgb.r(), 16) << str::fromBase10(rgb.g(), 16) << str::fromBase10(rgb.b(), 16);
-}
+/**
+ * @struct	JobOptions
+ * @brief	Command line options that apply to every job.
+ */
+struct JobOptions {
+	/// @brief	Fail instead of loading the whole image when it can't be decoded one row of cells at a time.
+	bool stream{ false };
+	/// @brief	Display each partition in a window while parsing.
+	bool display{ false };
+	/// @brief	Keypress timeout for OpenCV display windows.
+	int windowTimeout{ 0 };
+	/// @brief	Read & write the partition cache.
+	bool useCache{ true };
+	/// @brief	Also write the binary map file.
+	bool binary{ false };
+	/// @brief	Also write the winning region of each cell to the map file.
+	bool winners{ false };
+	/// @brief	Also write the region of every pixel to the region raster file.
+	bool raster{ false };
+	/// @brief	Prefix log messages with the worldspace name, to tell concurrent jobs apart.
+	bool tagged{ false };
+};
 
-inline void ValidateRegionVec(RegionVec const& regionVec)
+/**
+ * @brief			Parse one image and write its output files.
+ * @param job		The job to run. Its partition size must be set.
+ * @param config	The region config of the job.
+ * @param options	Options that apply to every job.
+ * @param pool		Thread pool to classify rows & trace region outlines on. Rows are classified serially on the calling thread when displaying.
+ * @param logger	Logger to write progress to.
+ * @param stats		Receives the time spent in each phase & the counters of the job.
+ */
+void runJob(const Job& job, const RegionConfig& config, const JobOptions& options, ThreadPool& pool, Logger& logger, RunStats& stats) noexcept(false)
 {
-	std::map<RGB, std::vector<Region>> color_errors;
-	std::map<std::string, std::vector<Region>> name_errors;
-
-	for (size_t i{ 0ull }; i < regionVec.size(); ++i) {
-		const auto& here{ regionVec.at(i) };
-		for (size_t j{ 0ull }; j < regionVec.size(); ++j) {
-			const auto& o{ regionVec.at(j) };
-			if (j != i && here.id != o.id) {
-				if (here.color == o.color) {
-					if (color_errors[here.color].empty())
-						color_errors[here.color].emplace_back(here);
-					color_errors[here.color].emplace_back(o);
-				}
-				if (here.mapName == o.mapName) {
-					if (name_errors[here.mapName].empty())
-						name_errors[here.mapName].emplace_back(here);
-					name_errors[here.mapName].emplace_back(o);
+	using CLK = std::chrono::high_resolution_clock;
+
+	const std::string tag{ options.tagged ? '[' + job.worldspace + "] " : std::string{} };
+	const RegionTable& regionTable{ *config.regionTable };
+	const cv::Size partSize{ job.partSize.value() };
+
+	// a region raster file from an earlier run can be classified again instead of the image
+	const bool rasterInput{ raster::isRasterFile(job.image) };
+	if (rasterInput && options.stream)
+		throw make_exception("'--stream' can't be used with region raster file '", job.image, '\'');
+
+	// images are decoded one row of cells at a time while earlier rows are classified, and each strip is classified straight from its colors, so neither the whole image nor a label image of it is kept in memory
+	// images that can't be streamed are labelled once when they are loaded, and only their labels are kept
+	std::optional<ImageStrips> strips;
+	// a region raster file is already labelled, so it is decoded whole instead
+	LabelImage labels;
+	if (rasterInput) {
+		logger.info() << tag << "Reading region raster file '" << job.image << '\'' << std::endl;
+		std::vector<std::string> unmatched;
+		labels = stats.timed("label_conversion", [&] {
+			const auto& bytes{ raster::readFile(job.image) };
+			return LabelImage{ raster::Reader{ bytes }, regionTable, &unmatched, &pool };
+		});
+		for (const auto& editorID : unmatched)
+			logger.warn() << term::get_warn() << tag << "Region '" << editorID << "' of the region raster file isn't in the config, its pixels are ignored." << std::endl;
+		logger.info() << tag << "Decoded the region raster to " << (labels.mat().depth() == CV_16U ? 16 : 8) << "-bit labels  ( " << color::setcolor::green << labels.bytes() / 1024ull << " KiB" << color::setcolor::reset << " )" << std::endl;
+	}
+	else {
+		const auto& t_load{ CLK::now() };
+		strips.emplace(job.image, partSize.height, config.lut, options.stream, &pool);
+		stats.addTime("image_decode", std::chrono::duration<double>(CLK::now() - t_load).count() - strips->getConvertSeconds());
+		if (strips->streamed())
+			logger.info() << tag << "Streaming image file '" << job.image << "'  ( " << strips->size().width << " x " << strips->size().height << " )" << std::endl;
+		else {
+			const LabelImage& loaded{ strips->getLabels() };
+			stats.addTime("label_conversion", strips->getConvertSeconds());
+			logger.info() << tag << "Successfully loaded image file '" << job.image << "' and converted it to " << (loaded.mat().depth() == CV_16U ? 16 : 8) << "-bit labels  ( " << color::setcolor::green << loaded.bytes() / 1024ull << " KiB" << color::setcolor::reset << " )" << std::endl;
+		}
+	}
+
+	const cv::Size imageSize{ strips.has_value() ? strips->size() : labels.size() };
+	logger.info() << tag << "Partition cv::Size:  [ " << partSize.width << " x " << partSize.height << " ]\n";
+
+	const int& cols{ imageSize.width / partSize.width };
+	const int& rows{ imageSize.height / partSize.height };
+
+	const bool display_each{ options.display };
+	const std::string windowName{ "Display" };
+
+	if (display_each)
+		cv::namedWindow(windowName); // open a window
+
+	if (!std::filesystem::is_directory(job.outDir))
+		throw make_exception("Invalid directory name: '", job.outDir.generic_string(), '\'');
+
+	std::filesystem::path outRegionData{ job.outDir / (job.worldspace + ".region.txt") }, outMapData{ job.outDir / (job.worldspace + ".map.txt") }, outCache{ job.outDir / (job.worldspace + ".cache") }, outBinaryMapData{ job.outDir / (job.worldspace + ".map.bin") }, outRaster{ job.outDir / (job.worldspace + ".raster.bin") };
+
+	// cells whose pixels haven't changed since the last run are reused from the cache
+	TileCache cache{ regionTable, cv::Size{ cols, rows }, partSize, config.lut.getTolerance() };
+	if (options.useCache) {
+		if (cache.load(outCache))
+			logger.info() << tag << "Loaded partition cache from '" << color::setcolor::yellow << outCache.generic_string() << color::setcolor::reset << '\'' << std::endl;
+		else logger.info() << tag << "No usable partition cache was found at '" << color::setcolor::yellow << outCache.generic_string() << color::setcolor::reset << "', all partitions will be processed." << std::endl;
+	}
+
+	const CellMapper mapper{ config.lut, cv::Size{ cols, rows }, partSize, job.threshold, &logger };
+
+	// every classified strip is run-length encoded as it passes through, so the image is never decoded again
+	std::optional<RasterEncoder> encoder;
+	if (options.raster)
+		encoder.emplace(imageSize.width, imageSize.height);
+
+	const auto t_start{ CLK::now() };
+
+	auto [regionStats, vec, winners, i, cached, matchedPixels, mergeSeconds, emptyCells, uniformCells, mixedCells] { mapper.run(
+		[&](const int& y) { return strips.has_value() ? strips->get(y) : labels.rowRange(y * partSize.height, (y + 1) * partSize.height); },
+		// the display window belongs to this thread, so displayed rows are classified serially
+		display_each ? nullptr : &pool,
+		{},
+		options.useCache ? &cache : nullptr,
+		// the raster & the display reuse the region of each pixel that was found while classifying the strip
+		encoder.has_value() || display_each ? CellMapper::LabelCallback{ [&](const int& y, const cv::Mat& labelStrip) {
+			if (encoder.has_value())
+				encoder->encode(labelStrip, y * partSize.height);
+			if (display_each) {
+				for (int x{ 0 }; x < cols; ++x) {
+					cv::imshow(windowName, LabelImage::colorize(labelStrip(cv::Rect(x * partSize.width, 0, partSize.width, partSize.height)), regionTable)); // display the image in the window
+					cv::waitKey(options.windowTimeout);
 				}
 			}
-		}
+		} } : CellMapper::LabelCallback{}
+	) };
+
+	// the rows below the last whole row of cells aren't classified, so a streamed strip of them is converted here; the raster still covers the whole image so that it can be classified again with any cell size
+	if (encoder.has_value() && rows * partSize.height < imageSize.height) {
+		const cv::Mat strip{ strips.has_value() ? strips->remainder() : labels.rowRange(rows * partSize.height, imageSize.height) };
+		cv::Mat labelStrip;
+		if (strip.type() == CV_8UC3)
+			LabelImage::convert(strip, config.lut, labelStrip);
+		else labelStrip = strip;
+		encoder->encode(labelStrip, rows * partSize.height);
 	}
 
-	if (color_errors.empty() && name_errors.empty())
-		return;
+	const auto& t_end{ CLK::now() };
+
+	if (i == 0) throw make_exception("Failed to partition the image!");
+
+	// strips are decoded inside of CellMapper::run
+	const double stripDecodeSeconds{ strips.has_value() ? strips->getDecodeSeconds() : 0.0 };
+	stats.addTime("image_decode", stripDecodeSeconds);
+	stats.addTime("classification", std::chrono::duration<double>(t_end - t_start).count() - stripDecodeSeconds - mergeSeconds);
+	stats.addTime("aggregation", mergeSeconds);
+	const std::uint64_t cellArea{ static_cast<std::uint64_t>(partSize.area()) };
+	stats.set("cells_total", static_cast<std::uint64_t>(cols) * rows);
+	stats.set("cells_processed", i);
+	stats.set("cells_cached", cached);
+	stats.set("cells_empty", emptyCells);
+	stats.set("cells_uniform", uniformCells);
+	stats.set("cells_mixed", mixedCells);
+	stats.set("cells_with_regions", vec.size());
+	stats.set("pixels_scanned", (i - cached) * cellArea);
+	stats.set("pixels_matched", matchedPixels);
+	stats.set("pixels_unmatched", i * cellArea - matchedPixels);
+	stats.set("regions", regionTable.size());
+	stats.set("regions_found", regionStats.size());
+
+	logger.info() << tag << "Finished processing image partitions after " << color::setcolor::green
+		<< std::chrono::duration_cast<std::chrono::seconds>(std::chrono::duration<double, std::nano>(t_end - t_start))
+		<< color::setcolor::reset << std::endl;
+	logger.info() << tag << color::setcolor::green << vec.size() << color::setcolor::reset << " / " << color::setcolor::green << i << color::setcolor::reset << " partitions had valid color map data." << std::endl;
+	logger.info() << tag << "Partitions:  " << color::setcolor::green << emptyCells << color::setcolor::reset << " empty, " << color::setcolor::green << uniformCells << color::setcolor::reset << " uniform, " << color::setcolor::green << mixedCells << color::setcolor::reset << " mixed." << std::endl;
+	if (options.useCache) {
+		logger.info() << tag << color::setcolor::green << cached << color::setcolor::reset << " / " << color::setcolor::green << i << color::setcolor::reset << " partitions were unchanged since the last run." << std::endl;
+		if (!stats.timed("write_cache", [&] { return cache.save(outCache); }))
+			logger.warn() << term::get_warn() << tag << "Failed to save the partition cache to '" << color::setcolor::yellow << outCache.generic_string() << color::setcolor::reset << '\'' << std::endl;
+	}
 
-	for (const auto& [color, regions] : color_errors)
-		std::cerr << term::get_error() << "Color '" << color << "' is assigned to multiple regions! " << regions << std::endl;
-	for (const auto& [name, regions] : name_errors)
-		std::cerr << term::get_error() << "Map Name '" << name << "' is assigned to multiple regions! " << regions << std::endl;
+	// check if all known regions were found in the map.
+	for (RegionIndex index{ 1 }; index <= regionTable.size(); ++index) {
+		if (const auto& region{ regionTable[index] }; !regionStats.contains(index))
+			logger.warn()
+			<< term::get_warn(true, 10) << tag << "No cells found for Region:\n"
+			<< indent(12) << "Editor ID:  '" << region.editorID << "'\n"
+			<< indent(12) << "Map Name:   '" << region.mapName << "'\n"
+			<< indent(12) << "Color:      '" << region.color << "'\n";
+	}
+
+	const RegionAreaMap regionAreas{ stats.timed("polygon_extraction", [&] { return RegionAreaMap{ regionStats, &pool }; }) };
+
+	// write the output region config file
+	if (stats.timed("write_region", [&] { return config.ini.write(outRegionData); }))
+		logger.info() << tag << "Successfully saved region data to '" << color::setcolor::yellow << outRegionData.generic_string() << color::setcolor::reset << '\'' << std::endl;
+	else logger.error() << term::get_error() << tag << "Failed to write region data to '" << color::setcolor::yellow << outRegionData.generic_string() << color::setcolor::reset << '\'' << std::endl;
+	// write the output region map file
+	if (stats.timed("write_map", [&] { return maptext::write(outMapData, regionTable, cv::Size{ cols, rows }, regionAreas, vec, options.winners ? &winners : nullptr); }))
+		logger.info() << tag << "Successfully saved the lookup matrix to '" << color::setcolor::yellow << outMapData.generic_string() << color::setcolor::reset << '\'' << std::endl;
+	else logger.error() << term::get_error() << tag << "Failed to write map data to '" << color::setcolor::yellow << outMapData.generic_string() << color::setcolor::reset << '\'' << std::endl;
+
+	// write the optional binary map file
+	if (options.binary) {
+		if (stats.timed("write_binary", [&] { return binmap::write(outBinaryMapData, regionTable, cv::Size{ cols, rows }, regionAreas, vec, winners); }))
+			logger.info() << tag << "Successfully saved the binary map to '" << color::setcolor::yellow << outBinaryMapData.generic_string() << color::setcolor::reset << '\'' << std::endl;
+		else logger.error() << term::get_error() << tag << "Failed to write the binary map to '" << color::setcolor::yellow << outBinaryMapData.generic_string() << color::setcolor::reset << '\'' << std::endl;
+	}
+
+	// write the optional region raster file
+	if (encoder.has_value()) {
+		if (stats.timed("write_raster", [&] { return encoder->write(outRaster, regionTable); }))
+			logger.info() << tag << "Successfully saved the region raster to '" << color::setcolor::yellow << outRaster.generic_string() << color::setcolor::reset << '\'' << std::endl;
+		else logger.error() << term::get_error() << tag << "Failed to write the region raster to '" << color::setcolor::yellow << outRaster.generic_string() << color::setcolor::reset << '\'' << std::endl;
+	}
 
-	throw make_exception("One or more regions have identical mapping data, the generator cannot continue!");
+	// if a window is open, close it
+	if (display_each) cv::destroyWindow(windowName);
 }
 
-int main(const int argc, char** argv)
+/**
+ * @brief						Keep the results of parsing an image in memory, and answer queries about them over a Unix domain socket until a client stops the server.
+ *\n							Reloads read the image & INI config files again, and only look up the colors of & classify the cells whose pixels changed.
+ * @param job					The job whose image is served. Instead of an image, this can also be a binary map file, which is read again on reload.
+ * @param socketPath			The location of the socket file.
+ * @param nearColorDistance		Regions whose colors are within this distance of each other are logged as warnings.
+ * @param tolerance				The color tolerance of the `ColorLUT`.
+ * @param pool					Thread pool to convert the image, classify rows & trace region outlines on.
+ * @param logger				Logger to write progress to.
+ * @param stats					Receives the time spent in each phase of every load.
+ */
+void serve(const Job& job, const std::filesystem::path& socketPath, const unsigned& nearColorDistance, const unsigned& tolerance, ThreadPool& pool, Logger& logger, RunStats& stats) noexcept(false)
 {
-	using CLK = std::chrono::high_resolution_clock;
+	QueryServer::Loader loader;
+	if (QueryIndex::isBinaryMap(job.image)) {
+		logger.info() << "Serving binary map file '" << job.image << '\'' << std::endl;
+		loader = [&job, &stats] {
+			return QueryServer::Load{ std::make_shared<const QueryIndex>(stats.timed("read_binary", [&] { return QueryIndex::readFile(job.image); })) };
+		};
+	}
+	else {
+		if (!job.partSize.has_value())
+			throw make_exception("'--serve' requires '-d'/'--dim' when '-f' is an image!");
+		logger.info() << "Serving image file '" << job.image << '\'' << std::endl;
+
+		// the counts of each cell are kept between reloads, so that only changed cells are classified again
+		std::shared_ptr<TileCache> cache;
+		loader = [&, cache]() mutable {
+			const cv::Size partSize{ job.partSize.value() };
+			const auto& config{ loadRegionConfig(job.inis, nearColorDistance, tolerance, logger, stats) };
+
+			// streamed strips are hashed before their colors are looked up, so unchanged cells skip the ColorLUT as well as the histogram
+			std::optional<ImageStrips> strips;
+			const auto& t_load{ std::chrono::steady_clock::now() };
+			strips.emplace(job.image, partSize.height, config->lut, false, &pool);
+			stats.addTime("image_decode", std::chrono::duration<double>(std::chrono::steady_clock::now() - t_load).count() - strips->getConvertSeconds());
+			if (!strips->streamed())
+				stats.addTime("label_conversion", strips->getConvertSeconds());
+			const cv::Size gridSize{ strips->size().width / partSize.width, strips->size().height / partSize.height };
+
+			if (cache == nullptr || cache->getKey() != TileCache::makeKey(*config->regionTable, gridSize, partSize, tolerance))
+				cache = std::make_shared<TileCache>(*config->regionTable, gridSize, partSize, tolerance);
+
+			const CellMapper mapper{ config->lut, gridSize, partSize, job.threshold, &logger };
+			const auto& t_start{ std::chrono::steady_clock::now() };
+			const auto& result{ mapper.run([&strips](const int& y) { return strips->get(y); }, &pool, {}, cache.get()) };
+			// strips are decoded inside of CellMapper::run
+			stats.addTime("image_decode", strips->getDecodeSeconds());
+			stats.addTime("classification", std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count() - strips->getDecodeSeconds());
+			if (result.partitions == 0ull)
+				throw make_exception("Failed to partition the image!");
+
+			const RegionAreaMap regionAreas{ stats.timed("polygon_extraction", [&] { return RegionAreaMap{ result.regionStats, &pool }; }) };
+			return QueryServer::Load{
+				std::make_shared<const QueryIndex>(*config->regionTable, gridSize, regionAreas, result.holdMap, result.winners),
+				result.partitions - result.cachedPartitions,
+				result.cachedPartitions
+			};
+		};
+	}
 
+	QueryServer server{ socketPath, std::move(loader), logger };
+	server.run();
+}
+
+int main(const int argc, char** argv)
+{
 	try {
-		opt::ParamsAPI2 args{ argc, argv, 'f', "file", 'd', "dim", 'T', "timeout", 'o', "out", 't', "threshold", 'i', "ini", 'w', "worldspace" };
+		opt::ParamsAPI2 args{ argc, argv, 'f', "file", 'd', "dim", 'T', "timeout", 'o', "out", 't', "threshold", 'i', "ini", 'w', "worldspace", 'j', "jobs", "stats", "near-color", "batch", "tolerance", "serve" };
 		env::PATH PATH;
 		const auto& [myPath, myName] { PATH.resolve_split(argv[0]) };
 
@@ -111,7 +399,26 @@ int main(const int argc, char** argv)
 				<< "  -f  --file <PATH>       Specify an image to load.\n"
 				<< "  -o  --out <PATH>        Specify a directory to export the results to.\n"
 				<< "  -d  --dim <X:Y>         Specify the image partition dimensions that the input image is divided into.\n"
+				<< "      --batch <PATH>      Run every job in a manifest file instead of a single '-f' image. Each section of the manifest is one job,\n"
+				<< "                           named after its worldspace, with the keys 'file', 'ini' (separated by ';'), 'dim', 'threshold' & 'out'.\n"
+				<< "                           Keys that are omitted default to the values of '-i', '-d', '-t' & '-o'.\n"
+				<< "      --serve <SOCKET>    Keep the results of '-f' in memory and answer queries about them over a Unix domain socket at '<SOCKET>',\n"
+				<< "                           until a client sends a stop request. '-f' can also be a '.map.bin' file exported with '--binary'.\n"
+				<< "                           The protocol is described in 'QueryProtocol.hpp'.\n"
 				<< "      --display           Displays each partition in a window while parsing.\n"
+				<< "      --stream            Fail instead of loading the whole image into memory when it can't be decoded one row of cells at a time.\n"
+				<< "                           Requires '--dim'. BMP & non-interlaced PNG files are always decoded one row of cells at a time.\n"
+				<< "      --binary            Also export the results as '<worldspace>.map.bin', which can be memory-mapped instead of parsed.\n"
+				<< "      --winners           Also export the region that wins each cell by priority as the '[WinnerMap]' section of the map file.\n"
+				<< "                           Ties are broken by the most pixels in the cell. The binary map file always includes the winners.\n"
+				<< "      --raster            Also export the region of every pixel as '<worldspace>.raster.bin', run-length encoded by row.\n"
+				<< "                           It can be passed to '-f' instead of the image, to classify it again with another '-d' or '-t'.\n"
+				<< "      --stats <PATH>      Write the time spent in each phase, counters & memory usage to a JSON file.\n"
+				<< "      --no-cache          Don't read or write the partition cache, which lets unchanged partitions be skipped on later runs.\n"
+				<< "      --tolerance <N>     Match pixels to the nearest region color within a distance of '<N>' in RGB space, instead of exact colors only.\n"
+				<< "                           This lets anti-aliased & slightly off pixels match. Default is 0. The maximum is 255.\n"
+				<< "      --near-color <N>    Warn about regions whose colors are within a distance of '<N>' of each other in RGB space.\n"
+				<< "                           These are easily confused by anti-aliasing. Default is 0, which disables the check.\n"
 				<< "  -T  --timeout <ms>      When '--display' is specified, closes the display window after '<ms>' milliseconds.\n"
 				<< "                           a value of 0 will wait forever, which is the default behaviour.\n"
 				<< "  -t  --threshold <%>     A percentage in the range (0 - 100) that determines the minimum number of matching\n"
@@ -119,176 +426,193 @@ int main(const int argc, char** argv)
 				<< "                           Setting this to `0` will NOT add any regions that don't have at least 1 pixel present!"
 				<< " -i  --ini <PATH>         Specify the location of the INI config file. Default is the current working directory, named 'regions.ini'\n"
 				<< " -w  --worldspace <NAME>  Specify the filename (not extension) of the output files.\n"
+				<< " -j  --jobs <N>           The number of threads to use when processing partitions. Default is the number of hardware threads.\n"
+				<< " -q  --quiet              Only log warnings & errors.\n"
+				<< " -v  --verbose            Also log the details of every partition. Takes precedence over '-q'/'--quiet'.\n"
 				;
 		}
 
-		file::MINI ini;
+		// log messages are written to STDERR on a background thread
+		Logger logger{
+			args.check_any<opt::Flag, opt::Option>('v', "verbose") ? LogLevel::Debug
+			: args.check_any<opt::Flag, opt::Option>('q', "quiet") ? LogLevel::Warning
+			: LogLevel::Info,
+			std::clog
+		};
+
+		RunStats stats;
+		// allocations are only counted when they are reported
+		alloc::enabled.store(args.check_any<opt::Flag, opt::Option>("stats"), std::memory_order_relaxed);
+
+		const auto& batchArg{ args.typegetv_any<opt::Flag, opt::Option>("batch") };
+		const auto& fileArg{ args.typegetv_any<opt::Flag, opt::Option>('f', "file") };
+		if (!batchArg.has_value() && !fileArg.has_value())
+			throw make_exception("Nothing to do! (No filepath was specified with '-f'/'--file', and no manifest was specified with '--batch')");
+
+		// Maximum distance between 2 region colors that is warned about
+		const unsigned nearColorDistance{ args.castgetv_any<unsigned, opt::Flag, opt::Option>([](std::string&& str) -> unsigned {
+			if (!str.empty() && std::all_of(str.begin(), str.end(), isdigit))
+				return static_cast<unsigned>(str::stoi(std::move(str)));
+			else throw make_exception("Invalid near color distance '", str, "' contains invalid characters! (Only digits are allowed)");
+		}, "near-color").value_or(0u) };
+		// Maximum distance between a pixel & a region color for the pixel to match the region
+		const unsigned tolerance{ args.castgetv_any<unsigned, opt::Flag, opt::Option>([](std::string&& str) -> unsigned {
+			if (!str.empty() && std::all_of(str.begin(), str.end(), isdigit))
+				return static_cast<unsigned>(str::stoi(std::move(str)));
+			else throw make_exception("Invalid tolerance '", str, "' contains invalid characters! (Only digits are allowed)");
+		}, "tolerance").value_or(0u) };
+		RegionConfigCache configs{ nearColorDistance, tolerance };
+
+		// the command line arguments are used for every value that a batch job doesn't specify
+		Job defaults;
+		if (const auto& path{ myPath / "regions.ini" }; file::exists(path))
+			defaults.inis.emplace_back(path);
+		for (const auto& it : args.typegetv_all<opt::Flag, opt::Option>('i', "ini"))
+			defaults.inis.emplace_back(it);
+		if (const auto& dimArg{ args.typegetv_any<opt::Flag, opt::Option>('d', "dim") }; dimArg.has_value())
+			defaults.partSize = parse_string<cv::Size>(dimArg.value(), ":,");
+		// Percentage of pixels required to return a region (region must have at least 1 pixel to be detected by the parser, this is applied after parsing)
+		defaults.threshold = args.castgetv_any<float, opt::Flag, opt::Option>([](std::string&& str) -> float {
+			if (std::all_of(std::forward<std::string>(str).begin(), std::forward<std::string>(str).end(), isdigit))
+				return static_cast<float>(str::stoi(std::move(str))) / 100.0f;
+			else throw make_exception("Invalid threshold value '", str, "' contains invalid characters! (Only digits are allowed)");
+		}, 't', "threshold").value_or(0.0f);
+		// get the target output location
+		defaults.outDir = args.typegetv_any<opt::Flag, opt::Option>('o', "out").value_or(myPath.generic_string());
+		defaults.worldspace = args.typegetv_any<opt::Flag, opt::Option>('w', "worldspace").value_or("worldspace");
+
+		JobOptions options;
+		options.stream = args.checkopt("stream");
+		options.display = !batchArg.has_value() && args.checkopt("display");
+		options.windowTimeout = args.castgetv_any<int, opt::Flag, opt::Option>(str::stoi, 'T', "timeout").value_or(0);
+		options.useCache = !args.checkopt("no-cache");
+		options.binary = args.checkopt("binary");
+		options.winners = args.checkopt("winners");
+		options.raster = args.checkopt("raster");
+		options.tagged = batchArg.has_value();
+
+		// Number of threads to process partitions with, including this one
+		const unsigned jobs{ args.castgetv_any<unsigned, opt::Flag, opt::Option>([](std::string&& str) -> unsigned {
+			if (!str.empty() && std::all_of(std::forward<std::string>(str).begin(), std::forward<std::string>(str).end(), isdigit))
+				return std::max(1u, static_cast<unsigned>(str::stoi(std::move(str))));
+			else throw make_exception("Invalid job count '", str, "' contains invalid characters! (Only digits are allowed)");
+		}, 'j', "jobs").value_or(ThreadPool::hardwareConcurrency()) };
+
+		logger.info()
+			<< "Window Timeout:   " << color::setcolor::green << options.windowTimeout << color::setcolor::reset << '\n'
+			<< "Pixel Threshold:  " << color::setcolor::green << defaults.threshold << " / 1.0" << color::setcolor::reset << "  ( " << color::setcolor::green << defaults.threshold * 100.0f << '%' << color::setcolor::reset << " )\n";
+
+		// if the path doesn't exist as-is, attempt to resolve it using the PATH variable.
+		const auto& resolveImage{ [&PATH](std::filesystem::path path) {
+			if (!file::exists(path))
+				path = PATH.resolve(path, { (path.has_extension() ? path.extension().generic_string() : ""), ".png", ".jpg", ".bmp" });
+			if (!file::exists(path))
+				throw make_exception("Failed to resolve filepath ", path, "! (File doesn't exist)");
+			return path;
+		} };
+
+		std::filesystem::path logpath{ "OpenCV.log" };
+		int returnCode{ 0 };
+
+		if (batchArg.has_value()) {
+			const auto& batch{ readManifest(batchArg.value(), defaults) };
+			logger.info() << "Read " << color::setcolor::green << batch.size() << color::setcolor::reset << " jobs from batch manifest '" << color::setcolor::yellow << batchArg.value() << color::setcolor::reset << '\'' << std::endl;
+
+			// configs are loaded before any image, so that invalid configs are reported first
+			std::vector<std::shared_ptr<const RegionConfig>> batchConfigs;
+			batchConfigs.reserve(batch.size());
+			for (const auto& job : batch)
+				batchConfigs.emplace_back(configs.get(job.inis, logger, stats));
+			logger.info() << color::setcolor::green << configs.size() << color::setcolor::reset << " distinct region configs are shared by " << color::setcolor::green << batch.size() << color::setcolor::reset << " jobs." << std::endl;
+			logger.info() << "Jobs:  " << color::setcolor::green << jobs << color::setcolor::reset << '\n';
+
+			LogRedirect streams;
+			streams.redirect(StandardStream::STDOUT | StandardStream::STDERR, logpath.generic_string());
+			logger.info() << "Redirected " << color::setcolor::red << "STDOUT" << color::setcolor::reset << " & " << color::setcolor::red << "STDERR" << color::setcolor::reset << " to logfile:  " << logpath << '\n';
+
+			// jobs and the rows of each job are all spread across the same pool
+			ThreadPool pool{ jobs - 1u };
+			// jobs run concurrently, so the batch is timed as a whole and each job keeps its own report
+			std::vector<RunStats> jobStats(batch.size());
+			std::atomic<size_t> failed{ 0ull };
+			stats.timed("batch", [&] {
+				pool.parallel_for(batch.size(), [&](const size_t& i) {
+					try {
+						runJob(batch[i], *batchConfigs[i], options, pool, logger, jobStats[i]);
+					} catch (const std::exception& ex) {
+						logger.error() << term::get_error() << '[' << batch[i].worldspace << "] " << ex.what() << std::endl;
+						++failed;
+					}
+				});
+			});
+			for (size_t i{ 0ull }; i < batch.size(); ++i)
+				stats.addJob(batch[i].worldspace, jobStats[i]);
+			stats.set("jobs", batch.size());
+			stats.set("jobs_failed", failed.load());
+
+			if (failed != 0ull) {
+				logger.error() << term::get_error() << color::setcolor::red << failed.load() << color::setcolor::reset << " / " << batch.size() << " jobs failed!" << std::endl;
+				returnCode = 1;
+			}
 
-		if (const auto& path{ myPath / "regions.ini" }; file::exists(path)) {
-			std::clog << "Reading region config at '" << path.generic_string() << "'.\n";
-			ini.read(path);
+			logger.flush();
+			streams.reset(StandardStream::ALL);
 		}
+		else if (const auto& serveArg{ args.typegetv_any<opt::Flag, opt::Option>("serve") }; serveArg.has_value()) {
+			Job job{ defaults };
+			job.image = resolveImage(fileArg.value());
+			logger.info() << "Jobs:  " << color::setcolor::green << jobs << color::setcolor::reset << '\n';
 
-		for (const auto& it : args.typegetv_all<opt::Flag, opt::Option>('i', "ini")) {
-			if (!file::exists(it))
-				throw make_exception("Filepath '", it, "' doesn't exist!");
-			else {
-				std::clog << "Reading region config at '" << it << "'.\n";
-				ini.read(it);
-			}
+			ThreadPool pool{ jobs - 1u };
+			serve(job, serveArg.value(), nearColorDistance, tolerance, pool, logger, stats);
 		}
+		else {
+			Job job{ defaults };
+			job.image = resolveImage(fileArg.value());
 
-		if (ini.empty())
-			throw make_exception("Failed to retrieve any valid data from the provided INI config files!");
-
-		const auto& regionMap{ cfg::getRegions(ini) };
-		ValidateRegionVec(regionMap);
-		std::cout << "Successfully validated the region config." << std::endl;
-		const ColorMap colormap{ regionMap };
+			const auto& config{ configs.get(job.inis, logger, stats) };
+			logger.info() << "Pixel Kernel:  " << color::setcolor::green << kernel::getName(config->lut.getISA()) << color::setcolor::reset << '\n';
 
-		if (const auto& fileArg{ args.typegetv_any<opt::Flag, opt::Option>('f', "file") }; fileArg.has_value()) {
-			std::filesystem::path path{ fileArg.value() };
+			LogRedirect streams;
+			streams.redirect(StandardStream::STDOUT | StandardStream::STDERR, logpath.generic_string());
+			logger.info() << "Redirected " << color::setcolor::red << "STDOUT" << color::setcolor::reset << " & " << color::setcolor::red << "STDERR" << color::setcolor::reset << " to logfile:  " << logpath << '\n';
 
-			if (!file::exists(path)) // if the path doesn't exist as-is, attempt to resolve it using the PATH variable.
-				path = PATH.resolve(path, { (path.has_extension() ? path.extension().generic_string() : ""), ".png", ".jpg", ".bmp" });
+			if (job.partSize.has_value()) {
+				// displayed rows are classified serially
+				logger.info() << "Jobs:  " << color::setcolor::green << (options.display ? 1u : jobs) << color::setcolor::reset << '\n';
 
-			// Keypress timeout for OpenCV display windows
-			const int windowTimeout{ args.castgetv_any<int, opt::Flag, opt::Option>(str::stoi, 'T', "timeout").value_or(0) };
-			// Percentage of pixels required to return a region (region must have at least 1 pixel to be detected by the parser, this is applied after parsing)
-			const float pxThreshold{ args.castgetv_any<float, opt::Flag, opt::Option>([](std::string&& str) -> float {
-				if (std::all_of(std::forward<std::string>(str).begin(), std::forward<std::string>(str).end(), isdigit))
-					return static_cast<float>(str::stoi(std::move(str))) / 100.0f;
-				else throw make_exception("Invalid threshold value '", str, "' contains invalid characters! (Only digits are allowed)");
-			}, 't', "threshold").value_or(0.0f) };
+				ThreadPool pool{ jobs - 1u };
+				runJob(job, *config, options, pool, logger, stats);
+			}
+			else if (options.stream)
+				throw make_exception("'--stream' requires '-d'/'--dim'!");
+			else if (options.display) {
+				ImageWrapper img{ stats.timed("image_decode", [&] { return ImageWrapper{ job.image.generic_string() }; }) };
+				if (!img.loaded())
+					throw make_exception("Failed to load image file '", job.image, '\'');
+				// show what each pixel was recognized as, rather than the original colors
+				ThreadPool pool{ jobs - 1u };
+				const LabelImage labels{ stats.timed("label_conversion", [&] { return LabelImage{ img.image, config->lut, &pool }; }) };
+				img.image = LabelImage::colorize(labels.mat(), *config->regionTable);
+				logger.info() << "Opening display..." << std::endl;
+				img.openDisplay();
+				logger.info() << "Press any key when the window is open to exit." << std::endl;
+				cv::waitKey(options.windowTimeout);
+				img.closeDisplay();
+			}
+			else throw make_exception("No arguments were included that specify what to do with the image! ('-d'/'--dim', '--display')");
 
-			std::clog
-				<< "Window Timeout:   " << color::setcolor::green << windowTimeout << color::setcolor::reset << '\n'
-				<< "Pixel Threshold:  " << color::setcolor::green << pxThreshold << " / 1.0" << color::setcolor::reset << "  ( " << color::setcolor::green << pxThreshold * 100.0f << '%' << color::setcolor::reset << " )\n";
-
-			std::filesystem::path logpath{ "OpenCV.log" };
-
-			if (file::exists(path)) {
-				LogRedirect streams;
-				streams.redirect(StandardStream::STDOUT | StandardStream::STDERR, logpath.generic_string());
-				std::clog << "Redirected " << color::setcolor::red << "STDOUT" << color::setcolor::reset << " & " << color::setcolor::red << "STDERR" << color::setcolor::reset << " to logfile:  " << logpath << '\n';
-
-				if (ImageWrapper img{ path.generic_string() }; img.loaded()) {
-					std::clog << "Successfully loaded image file '" << path << '\'' << std::endl;
-
-					if (const auto& dimArg{ args.typegetv_any<opt::Flag, opt::Option>('d', "dim") }; dimArg.has_value()) {
-						cv::Size partSize = parse_string<cv::Size>(dimArg.value(), ":,");
-						std::clog << "Partition cv::Size:  [ " << partSize.width << " x " << partSize.height << " ]\n";
-
-						const int& cols{ img.image.cols / partSize.width };
-						const int& rows{ img.image.rows / partSize.height };
-
-						bool display_each{ args.checkopt("display") };
-						const std::string windowName{ "Display" };
-
-						if (display_each)
-							cv::namedWindow(windowName); // open a window
-
-						RegionStatsMap regionStats;
-
-						HoldMap vec;
-						vec.reserve(static_cast<size_t>(cols * rows));
-						size_t i = 0;
-
-						const auto t_start{ CLK::now() };
-
-						for (int y{ 0 }; y < rows; ++y) {
-							unsigned row_count{ 0u };
-							for (int x{ 0 }; x < cols; ++x, ++i) {
-								const auto& rect{ cv::Rect(x * partSize.width, y * partSize.height, partSize.width, partSize.height) };
-								auto part{ img.image(rect) };
-								const auto& cellPos{ offsetCellCoordinates(cv::Point{ x, y }) };
-								std::clog << "Processing Partition #" << color::setcolor::green << i << color::setcolor::reset << '\n'
-									<< "  Partition Index:   ( " << color::setcolor::yellow << x << color::setcolor::reset << ", " << color::setcolor::yellow << y << color::setcolor::reset << " )\n"
-									<< "  Cell Coordinates:  ( " << color::setcolor::yellow << cellPos.x << color::setcolor::reset << ", " << color::setcolor::yellow << cellPos.y << color::setcolor::reset << " )\n";
-								if (display_each) {
-									cv::imshow(windowName, part); // display the image in the window
-									cv::waitKey(windowTimeout);
-								}
-								if (PartitionStats stats(std::move(part), colormap); stats.valid() && !stats.empty()) {
-									if (auto regions{ stats.getRegions(pxThreshold) }; !regions.empty()) {
-										std::clog << "  " << color::setcolor::cyan << regions << color::setcolor::reset << '\n';
-										for (const auto& it : regions)
-											regionStats[it].emplace_back(cellPos);
-										vec.emplace_back(std::make_pair(cellPos, std::move(regions)));
-										++row_count;
-									}
-									else std::clog << "  " << color::setcolor::red << "No regions above threshold." << color::setcolor::reset << '\n';
-								}
-							}
-							if (row_count == 0u && !regionStats.empty()) {
-								std::clog << "Breaking early because row with index " << color::setcolor::yellow << y << color::setcolor::reset << " didn't contain anything, and it is unlikely that anything else exists." << std::endl;
-								break;
-							}
-						}
-
-						const auto& t_end{ CLK::now() };
-
-						if (i == 0) throw make_exception("Failed to partition the image!");
-
-						std::clog << "Finished processing image partitions after " << color::setcolor::green
-							<< std::chrono::duration_cast<std::chrono::seconds>(std::chrono::duration<double, std::nano>(t_end - t_start))
-							<< color::setcolor::reset << std::endl;
-						std::clog << color::setcolor::green << vec.size() << color::setcolor::reset << " / " << color::setcolor::green << i << color::setcolor::reset << " partitions had valid color map data." << std::endl;
-
-						vec.shrink_to_fit();
-
-						// check if all known regions were found in the map.
-						for (const auto& [color, region] : colormap) {
-							if (!regionStats.contains(region))
-								std::clog
-								<< term::get_warn(true, 10) << "No cells found for Region:\n"
-								<< indent(12) << "Editor ID:  '" << region.editorID << "'\n"
-								<< indent(12) << "Map Name:   '" << region.mapName << "'\n"
-								<< indent(12) << "Color:      '" << color << "'\n";
-						}
-
-						// get the target output location
-						std::filesystem::path outpath{ myPath };
-
-						if (const auto& outArg{ args.typegetv_any<opt::Flag, opt::Option>('o', "out") }; outArg.has_value())
-							outpath = outArg.value(); // override the output path
-
-						if (!std::filesystem::is_directory(outpath))
-							throw make_exception("Invalid directory name: '", outpath.generic_string(), '\'');
-
-						std::string worldspaceName{ args.typegetv_any<opt::Flag, opt::Option>('w', "worldspace").value_or("worldspace") };
-						std::filesystem::path outRegionData{ outpath / (worldspaceName + ".region.txt") }, outMapData{ outpath / (worldspaceName + ".map.txt") };
-
-						// write the output region config file
-						if (ini.write(outRegionData))
-							std::clog << "Successfully saved region data to '" << color::setcolor::yellow << outRegionData.generic_string() << color::setcolor::reset << '\'' << std::endl;
-						else std::clog << term::get_error() << "Failed to write region data to '" << color::setcolor::yellow << outRegionData.generic_string() << color::setcolor::reset << '\'' << std::endl;
-						// write the output region map file
-						if (file::write(outMapData, "[RegionAreas]\n", regionStats, "\n[HoldMap]\n", vec))
-							std::clog << "Successfully saved the lookup matrix to '" << color::setcolor::yellow << outMapData.generic_string() << color::setcolor::reset << '\'' << std::endl;
-						else std::clog << term::get_error() << "Failed to write map data to '" << color::setcolor::yellow << outMapData.generic_string() << color::setcolor::reset << '\'' << std::endl;
-
-						// if a window is open, close it
-						if (display_each) cv::destroyWindow(windowName);
-					}
-					else if (args.checkopt("display")) {
-						std::clog << "Opening display..." << std::endl;
-						img.openDisplay();
-						std::clog << "Press any key when the window is open to exit." << std::endl;
-						cv::waitKey(windowTimeout);
-						img.closeDisplay();
-					}
-					else throw make_exception("No arguments were included that specify what to do with the image! ('-d'/'--dim', '--display')");
-				}
-				else throw make_exception("Failed to load image file '", path, '\'');
+			logger.flush();
+			streams.reset(StandardStream::ALL);
+		}
 
-				streams.reset(StandardStream::ALL);
-			}
-			else throw make_exception("Failed to resolve filepath ", path, "! (File doesn't exist)");
+		if (const auto& statsArg{ args.typegetv_any<opt::Flag, opt::Option>("stats") }; statsArg.has_value()) {
+			if (stats.write(statsArg.value()))
+				logger.info() << "Successfully saved stats to '" << color::setcolor::yellow << statsArg.value() << color::setcolor::reset << '\'' << std::endl;
+			else logger.error() << term::get_error() << "Failed to write stats to '" << color::setcolor::yellow << statsArg.value() << color::setcolor::reset << '\'' << std::endl;
 		}
-		else throw make_exception("Nothing to do! (No filepath was specified with '-f'/'--file')");
 
-		return 0;
+		return returnCode;
 	} catch (const std::exception& ex) {
 		std::cerr << term::get_error() << ex.what() << std::endl;
 		return 1;
@@ -0,0 +1,236 @@
+#include "parseimg.h"
+
+#include "CellMapper.hpp"
+#include "Job.hpp"
+#include "Logger.hpp"
+#include "QueryIndex.hpp"
+#include "RegionAreaMap.hpp"
+#include "RunStats.hpp"
+#include "ThreadPool.hpp"
+
+#include <make_exception.hpp>
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct pimg_config {
+	std::shared_ptr<const RegionConfig> config;
+};
+
+struct pimg_result {
+	QueryIndex index;
+};
+
+namespace {
+	thread_local std::string lastError;
+
+	pimg_status fail(const pimg_status& status, std::string message)
+	{
+		lastError = std::move(message);
+		return status;
+	}
+
+	/// @brief	Call a function, and convert any exception that it throws to a status so that none escape through the C API.
+	template<typename Func>
+	pimg_status guarded(const Func& func) noexcept
+	{
+		try {
+			func();
+			return PIMG_OK;
+		} catch (const std::exception& ex) {
+			return fail(PIMG_FAILED, ex.what());
+		} catch (...) {
+			return fail(PIMG_FAILED, "An unknown exception occurred!");
+		}
+	}
+
+	/// @brief	Check that every pixel of a label image is a valid region index, since out-of-range labels would be counted outside of each cell's histogram.
+	template<typename T>
+	bool labelsInRange(const cv::Mat& labels, const size_t& regionCount)
+	{
+		for (int y{ 0 }; y < labels.rows; ++y) {
+			const T* row{ labels.ptr<T>(y) };
+			if (static_cast<size_t>(*std::max_element(row, row + labels.cols)) > regionCount)
+				return false;
+		}
+		return true;
+	}
+}
+
+extern "C" {
+	uint32_t pimg_api_version(void) { return PIMG_API_VERSION; }
+	const char* pimg_last_error(void) { return lastError.c_str(); }
+
+	pimg_status pimg_config_load(const char* const* ini_paths, size_t count, uint32_t tolerance, pimg_config** out)
+	{
+		if (ini_paths == nullptr || count == 0ull || out == nullptr)
+			return fail(PIMG_INVALID_ARGUMENT, "At least one INI config file is required!");
+		*out = nullptr;
+		std::vector<std::filesystem::path> inis;
+		inis.reserve(count);
+		for (size_t i{ 0ull }; i < count; ++i) {
+			if (ini_paths[i] == nullptr)
+				return fail(PIMG_INVALID_ARGUMENT, "INI config file path #" + std::to_string(i) + " is null!");
+			inis.emplace_back(std::filesystem::u8path(ini_paths[i]));
+		}
+
+		return guarded([&] {
+			// only errors are logged, and there is nobody to report timings to
+			Logger logger{ LogLevel::Error, std::clog };
+			RunStats stats;
+			*out = new pimg_config{ loadRegionConfig(inis, 0u, tolerance, logger, stats) };
+		});
+	}
+
+	void pimg_config_free(pimg_config* config) { delete config; }
+
+	uint32_t pimg_config_region_count(const pimg_config* config) { return config == nullptr ? 0u : static_cast<uint32_t>(config->config->regionTable->size()); }
+
+	pimg_status pimg_config_region(const pimg_config* config, uint16_t index, pimg_region* out)
+	{
+		if (config == nullptr || out == nullptr || index == 0u || index > config->config->regionTable->size())
+			return fail(PIMG_INVALID_ARGUMENT, "Region index " + std::to_string(index) + " is out-of-range!");
+		const Region& region{ (*config->config->regionTable)[index] };
+		*out = pimg_region{ region.editorID.c_str(), region.mapName.c_str(), region.color.r(), region.color.g(), region.color.b(), region.priority };
+		return PIMG_OK;
+	}
+
+	pimg_status pimg_classify(const pimg_config* config, const pimg_image* image, const pimg_options* options, pimg_result** out)
+	{
+		if (config == nullptr || image == nullptr || options == nullptr || out == nullptr)
+			return fail(PIMG_INVALID_ARGUMENT, "Config, image, options & result must not be null!");
+		*out = nullptr;
+		if (image->data == nullptr || image->width <= 0 || image->height <= 0)
+			return fail(PIMG_INVALID_ARGUMENT, "The image is empty!");
+		if (options->cell_width <= 0 || options->cell_height <= 0 || options->cell_width > image->width || options->cell_height > image->height)
+			return fail(PIMG_INVALID_ARGUMENT, "The cell size must be positive, and no larger than the image!");
+		if (!(options->threshold >= 0.0f && options->threshold <= 1.0f))
+			return fail(PIMG_INVALID_ARGUMENT, "The threshold must be in the range ( 0.0 - 1.0 )!");
+
+		int type;
+		size_t pixelSize;
+		switch (image->format) {
+		case PIMG_BGR8:
+			type = CV_8UC3;
+			pixelSize = 3ull;
+			break;
+		case PIMG_LABEL8:
+			type = CV_8UC1;
+			pixelSize = 1ull;
+			break;
+		case PIMG_LABEL16:
+			type = CV_16UC1;
+			pixelSize = 2ull;
+			break;
+		default:
+			return fail(PIMG_INVALID_ARGUMENT, "Unknown pixel format!");
+		}
+		if (image->stride < static_cast<size_t>(image->width) * pixelSize)
+			return fail(PIMG_INVALID_ARGUMENT, "The stride is smaller than one row of pixels!");
+
+		return guarded([&] {
+			const RegionConfig& cfg{ *config->config };
+			// the caller's pixels are wrapped without being copied; they are only read
+			const cv::Mat mat{ image->height, image->width, type, const_cast<void*>(image->data), image->stride };
+			if ((type == CV_8UC1 && !labelsInRange<uchar>(mat, cfg.regionTable->size())) || (type == CV_16UC1 && !labelsInRange<RegionIndex>(mat, cfg.regionTable->size())))
+				throw make_exception("The label image contains region indices above ", cfg.regionTable->size(), '!');
+
+			const cv::Size partSize{ options->cell_width, options->cell_height };
+			const cv::Size gridSize{ mat.cols / partSize.width, mat.rows / partSize.height };
+			const unsigned threads{ options->threads == 0u ? ThreadPool::hardwareConcurrency() : options->threads };
+			std::optional<ThreadPool> pool;
+			if (threads > 1u)
+				pool.emplace(threads - 1u);
+
+			const CellMapper mapper{ cfg.lut, gridSize, partSize, options->threshold };
+			const auto& result{ mapper.run([&mat, &partSize](const int& y) { return mat.rowRange(y * partSize.height, (y + 1) * partSize.height); }, pool.has_value() ? &*pool : nullptr) };
+			if (result.partitions == 0ull)
+				throw make_exception("Failed to partition the image!");
+
+			const RegionAreaMap regionAreas{ result.regionStats, pool.has_value() ? &*pool : nullptr };
+			*out = new pimg_result{ QueryIndex{ *cfg.regionTable, gridSize, regionAreas, result.holdMap, result.winners } };
+		});
+	}
+
+	void pimg_result_free(pimg_result* result) { delete result; }
+
+	void pimg_result_grid(const pimg_result* result, int32_t* width, int32_t* height, int32_t* origin_x, int32_t* origin_y)
+	{
+		if (result == nullptr)
+			return;
+		const auto& header{ result->index.getReader().getHeader() };
+		if (width != nullptr) *width = header.gridWidth;
+		if (height != nullptr) *height = header.gridHeight;
+		if (origin_x != nullptr) *origin_x = header.originX;
+		if (origin_y != nullptr) *origin_y = header.originY;
+	}
+
+	size_t pimg_result_cell(const pimg_result* result, int32_t x, int32_t y, const uint16_t** regions)
+	{
+		if (result == nullptr)
+			return 0ull;
+		const auto& cell{ result->index.cell(x, y) };
+		if (regions != nullptr)
+			*regions = cell.data();
+		return cell.size();
+	}
+
+	uint16_t pimg_result_winner(const pimg_result* result, int32_t x, int32_t y) { return result == nullptr ? 0u : result->index.winner(x, y); }
+
+	size_t pimg_result_regions_at(const pimg_result* result, double x, double y, uint16_t* out, size_t capacity)
+	{
+		if (result == nullptr)
+			return 0ull;
+		thread_local std::vector<std::uint16_t> regions;
+		regions.clear();
+		result->index.regionsAt(x, y, regions);
+		if (out != nullptr)
+			std::copy_n(regions.begin(), std::min(capacity, regions.size()), out);
+		return regions.size();
+	}
+
+	size_t pimg_result_polygon_count(const pimg_result* result, uint16_t region)
+	{
+		if (result == nullptr || region == 0u || region > result->index.regionCount())
+			return 0ull;
+		return result->index.getReader().polygons(region).size();
+	}
+
+	pimg_status pimg_result_polygon(const pimg_result* result, uint16_t region, size_t polygon, uint32_t* first, uint32_t* count)
+	{
+		if (result == nullptr || first == nullptr || count == nullptr || polygon >= pimg_result_polygon_count(result, region))
+			return fail(PIMG_INVALID_ARGUMENT, "Polygon #" + std::to_string(polygon) + " of region index " + std::to_string(region) + " doesn't exist!");
+		const auto& record{ result->index.getReader().polygons(region)[polygon] };
+		*first = record.firstRing;
+		*count = record.ringCount;
+		return PIMG_OK;
+	}
+
+	size_t pimg_result_ring(const pimg_result* result, uint32_t ring, const pimg_vertex** vertices)
+	{
+		if (result == nullptr || vertices == nullptr || ring >= result->index.getReader().getHeader().ringCount)
+			return 0ull;
+		const auto& span{ result->index.getReader().ring(ring) };
+		static_assert(sizeof(pimg_vertex) == sizeof(binmap::Vertex) && offsetof(pimg_vertex, y) == offsetof(binmap::Vertex, y), "pimg_vertex must match the layout of binmap::Vertex!");
+		*vertices = reinterpret_cast<const pimg_vertex*>(span.data());
+		return span.size();
+	}
+
+	pimg_status pimg_result_binary_map(const pimg_result* result, const void** data, size_t* size)
+	{
+		if (result == nullptr || data == nullptr || size == nullptr)
+			return fail(PIMG_INVALID_ARGUMENT, "Result, data & size must not be null!");
+		const auto& bytes{ result->index.data() };
+		*data = bytes.data();
+		*size = bytes.size();
+		return PIMG_OK;
+	}
+}
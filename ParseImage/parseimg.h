@@ -0,0 +1,171 @@
+#pragma once
+/**
+ * @file	parseimg.h
+ * @brief	C API of the `parseimg_core` library, for parsing region maps in-process instead of running `parseimg` and reading its output files.
+ *\n		Every function is safe to call from any thread, as long as an object isn't freed while it's being used.
+ *\n		Functions that can fail return a `pimg_status`, and the reason for the last failure on the calling thread is available from `pimg_last_error()`.
+ *
+ *\n		Typical use:
+ *\n		1. Load the regions with `pimg_config_load()`.
+ *\n		2. Classify an image that is already in memory with `pimg_classify()`. The pixels are read in place, without being copied.
+ *\n		3. Look up cells, points & polygons in the result, or get it in the binary map format described in `BinaryMap.hpp`.
+ *\n		4. Free the result & config with `pimg_result_free()` & `pimg_config_free()`.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(PARSEIMG_STATIC)
+#define PARSEIMG_API
+#elif defined(_WIN32)
+#ifdef PARSEIMG_EXPORTS
+#define PARSEIMG_API __declspec(dllexport)
+#else
+#define PARSEIMG_API __declspec(dllimport)
+#endif
+#else
+#define PARSEIMG_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// @brief	The version of this API. It is incremented whenever a function or struct changes in a way that isn't backwards-compatible.
+#define PIMG_API_VERSION 1
+
+/// @brief	One of the `PIMG_OK`, `PIMG_INVALID_ARGUMENT` or `PIMG_FAILED` constants. This is a fixed-width integer rather than an enum, since the size of an enum depends on the compiler.
+typedef int32_t pimg_status;
+enum {
+	PIMG_OK = 0,
+	/// @brief	An argument was null or out of range.
+	PIMG_INVALID_ARGUMENT = 1,
+	/// @brief	Something failed while loading or parsing, see `pimg_last_error()`.
+	PIMG_FAILED = 2,
+};
+
+/// @brief	One of the `PIMG_BGR8`, `PIMG_LABEL8` or `PIMG_LABEL16` constants. This is a fixed-width integer for the same reason as `pimg_status`.
+typedef uint32_t pimg_pixel_format;
+enum {
+	/// @brief	3 bytes per pixel, in Blue-Green-Red order.
+	PIMG_BGR8 = 0,
+	/// @brief	1 byte per pixel, where each value is a region index & 0 is no region.
+	PIMG_LABEL8 = 1,
+	/// @brief	2 bytes per pixel in native byte order, where each value is a region index & 0 is no region.
+	PIMG_LABEL16 = 2,
+};
+
+/// @brief	A merged set of INI config files, and the lookup table built from their regions.
+typedef struct pimg_config pimg_config;
+/// @brief	The results of classifying one image.
+typedef struct pimg_result pimg_result;
+
+typedef struct pimg_region {
+	/// @brief	Null-terminated UTF-8 strings that are valid until the config is freed.
+	const char* editor_id;
+	const char* map_name;
+	uint8_t r, g, b;
+	uint16_t priority;
+} pimg_region;
+
+/// @brief	An image that is already in memory.
+typedef struct pimg_image {
+	/// @brief	The first pixel of the top row. It must stay valid until `pimg_classify()` returns.
+	const void* data;
+	int32_t width, height;
+	/// @brief	The number of bytes from the start of one row to the start of the next.
+	size_t stride;
+	pimg_pixel_format format;
+} pimg_image;
+
+typedef struct pimg_options {
+	/// @brief	The size of one cell, in pixels.
+	int32_t cell_width, cell_height;
+	/// @brief	The fraction _( 0.0 - 1.0 )_ of the pixels in a cell that a region must have in order to be assigned to it.
+	float threshold;
+	/// @brief	The number of threads to classify rows of cells with. 0 uses the number of hardware threads.
+	uint32_t threads;
+} pimg_options;
+
+/// @brief	A cell corner, in cell coordinates.
+typedef struct pimg_vertex {
+	int32_t x, y;
+} pimg_vertex;
+
+/// @brief	Get the value of `PIMG_API_VERSION` that the library was built with.
+PARSEIMG_API uint32_t pimg_api_version(void);
+/// @brief	Get the reason that the last call on this thread failed. The string is valid until the next failure on this thread.
+PARSEIMG_API const char* pimg_last_error(void);
+
+/**
+ * @brief				Read & merge INI config files, then validate their regions and build the color lookup table.
+ * @param ini_paths		The paths of the INI files, in the order that they are merged.
+ * @param count			The number of paths.
+ * @param tolerance		The maximum distance in RGB space between a pixel & a region's color for the pixel to match it. 0 only matches exact colors.
+ * @param out			Receives the new config, which must be freed with `pimg_config_free()`.
+ */
+PARSEIMG_API pimg_status pimg_config_load(const char* const* ini_paths, size_t count, uint32_t tolerance, pimg_config** out);
+PARSEIMG_API void pimg_config_free(pimg_config* config);
+/// @brief	Get the number of regions. Valid region indices are in the range ( 1 - count ).
+PARSEIMG_API uint32_t pimg_config_region_count(const pimg_config* config);
+/// @brief	Get a region by its index, starting at 1.
+PARSEIMG_API pimg_status pimg_config_region(const pimg_config* config, uint16_t index, pimg_region* out);
+
+/**
+ * @brief			Classify every cell of an image, and trace the outlines of every region.
+ * @param config	The regions to classify pixels with. Label images must use the same region indices.
+ * @param image		The image. Rows & columns of pixels that don't fill a whole cell are ignored.
+ * @param options	The cell size, threshold & number of threads.
+ * @param out		Receives the new result, which must be freed with `pimg_result_free()`. It doesn't refer to the config or the image.
+ */
+PARSEIMG_API pimg_status pimg_classify(const pimg_config* config, const pimg_image* image, const pimg_options* options, pimg_result** out);
+PARSEIMG_API void pimg_result_free(pimg_result* result);
+
+/// @brief	Get the number of cells along each axis, and the cell coordinates of the top-left cell. Any of the outputs may be null.
+PARSEIMG_API void pimg_result_grid(const pimg_result* result, int32_t* width, int32_t* height, int32_t* origin_x, int32_t* origin_y);
+/**
+ * @brief			Get the regions assigned to a cell.
+ * @param x			The X-axis cell coordinate.
+ * @param y			The Y-axis cell coordinate.
+ * @param regions	Receives a pointer to the region indices, which is valid until the result is freed. May be null.
+ * @returns			The number of regions, which is 0 for cells outside of the grid.
+ */
+PARSEIMG_API size_t pimg_result_cell(const pimg_result* result, int32_t x, int32_t y, const uint16_t** regions);
+/**
+ * @brief	Get the region that wins a cell. Of the regions assigned to it, the one with the highest priority wins, then the one with the most pixels in the cell, then the lowest index.
+ * @param x	The X-axis cell coordinate.
+ * @param y	The Y-axis cell coordinate.
+ * @returns	A region index, or 0 for cells without regions & cells outside of the grid.
+ */
+PARSEIMG_API uint16_t pimg_result_winner(const pimg_result* result, int32_t x, int32_t y);
+/**
+ * @brief			Find the regions whose polygons contain a point, in cell units.
+ * @param out		Receives up to `capacity` region indices, in ascending order. May be null when `capacity` is 0.
+ * @returns			The total number of regions that contain the point, which may be more than `capacity`.
+ */
+PARSEIMG_API size_t pimg_result_regions_at(const pimg_result* result, double x, double y, uint16_t* out, size_t capacity);
+/// @brief	Get the number of polygons of a region.
+PARSEIMG_API size_t pimg_result_polygon_count(const pimg_result* result, uint16_t region);
+/**
+ * @brief			Get the rings of one polygon of a region. The first ring is the counter-clockwise outer boundary, and every other ring is a clockwise hole.
+ * @param region	The region index.
+ * @param polygon	The index of the polygon, less than `pimg_result_polygon_count()`.
+ * @param first		Receives the index of the first ring, to pass to `pimg_result_ring()`.
+ * @param count		Receives the number of rings.
+ */
+PARSEIMG_API pimg_status pimg_result_polygon(const pimg_result* result, uint16_t region, size_t polygon, uint32_t* first, uint32_t* count);
+/**
+ * @brief			Get the corners of a ring. The last corner connects back to the first, and is not repeated.
+ * @param vertices	Receives a pointer to the corners, which is valid until the result is freed.
+ * @returns			The number of corners, which is 0 for invalid ring indices.
+ */
+PARSEIMG_API size_t pimg_result_ring(const pimg_result* result, uint32_t ring, const pimg_vertex** vertices);
+/**
+ * @brief			Get the result in the binary map format that is written by `parseimg --binary`.
+ * @param data		Receives a pointer to the data, which is aligned to 8 bytes & valid until the result is freed.
+ * @param size		Receives the size of the data, in bytes.
+ */
+PARSEIMG_API pimg_status pimg_result_binary_map(const pimg_result* result, const void** data, size_t* size);
+
+#ifdef __cplusplus
+}
+#endif
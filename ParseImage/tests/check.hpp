@@ -0,0 +1,45 @@
+#pragma once
+/**
+ * @file	check.hpp
+ * @brief	Minimal assertion helpers shared by the test executables.
+ *\n		A failed check is reported with its location & the test keeps running, so that one run shows every failure.
+ */
+#include <iostream>
+
+namespace test {
+	/// @brief	The number of checks that failed so far.
+	inline int failures{ 0 };
+
+	/**
+	 * @brief			Report a check that failed.
+	 * @param condition	The result of the check.
+	 * @param expr		The text of the checked expression.
+	 * @param file		The source file of the check.
+	 * @param line		The line number of the check.
+	 * @returns			condition
+	 */
+	inline bool check(const bool& condition, const char* expr, const char* file, const int& line)
+	{
+		if (!condition) {
+			++failures;
+			std::cerr << file << ':' << line << ": check failed: " << expr << '\n';
+		}
+		return condition;
+	}
+
+	/**
+	 * @brief		Print a summary of the checks.
+	 * @param name	The name of the test.
+	 * @returns		The exit code of the test; 0 when every check passed.
+	 */
+	inline int report(const char* name)
+	{
+		if (failures == 0)
+			std::cout << name << ": passed\n";
+		else std::cerr << name << ": " << failures << " check(s) failed\n";
+		return failures == 0 ? 0 : 1;
+	}
+}
+
+/// @brief	Check that an expression is true, and report it if it isn't.
+#define CHECK(...) ::test::check(static_cast<bool>(__VA_ARGS__), #__VA_ARGS__, __FILE__, __LINE__)
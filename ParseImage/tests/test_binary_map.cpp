@@ -0,0 +1,177 @@
+#include "check.hpp"
+
+#include "../BinaryMapWriter.hpp"
+#include "../MapTextWriter.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// @brief	A cell or vertex position, which can be used as a map key.
+using Pos = std::pair<int, int>;
+using Rings = std::vector<std::vector<Pos>>;
+
+/**
+ * @struct	MapData
+ * @brief	The contents of a map file, in a form that doesn't depend on which format it was read from.
+ */
+struct MapData {
+	/// @brief	Every ring of every polygon, by editor ID, in the order they were written.
+	std::map<std::string, Rings> areas;
+	/// @brief	The editor IDs of the regions assigned to each cell, by cell coordinate.
+	std::map<Pos, std::vector<std::string>> holds;
+	/// @brief	The editor ID of the region that wins each cell, by cell coordinate. Cells without any regions are omitted.
+	std::map<Pos, std::string> winners;
+};
+
+/// @brief	Parse every `(x,y)` point in a string.
+std::vector<Pos> parsePoints(const std::string& s)
+{
+	std::vector<Pos> points;
+	for (size_t pos{ s.find('(') }; pos != std::string::npos; pos = s.find('(', pos + 1ull)) {
+		Pos p;
+		if (CHECK(std::sscanf(s.c_str() + pos, "(%d,%d)", &p.first, &p.second) == 2))
+			points.emplace_back(p);
+	}
+	return points;
+}
+
+/// @brief	Parse every `"..."` string in a string.
+std::vector<std::string> parseQuoted(const std::string& s)
+{
+	std::vector<std::string> strings;
+	for (size_t open{ s.find('"') }; open != std::string::npos; open = s.find('"', open + 1ull)) {
+		const size_t close{ s.find('"', open + 1ull) };
+		if (!CHECK(close != std::string::npos))
+			break;
+		strings.emplace_back(s.substr(open + 1ull, close - open - 1ull));
+		open = close;
+	}
+	return strings;
+}
+
+/// @brief	Read the contents of a text map file.
+MapData readText(const std::string& text)
+{
+	MapData data;
+	std::istringstream iss{ text };
+	std::string section;
+	for (std::string line; std::getline(iss, line);) {
+		if (line.empty())
+			continue;
+		if (line.front() == '[') {
+			section = line;
+			continue;
+		}
+		const size_t eq{ line.find(" = ") };
+		if (!CHECK(eq != std::string::npos))
+			continue;
+		const std::string key{ line.substr(0ull, eq) }, value{ line.substr(eq + 3ull) };
+
+		if (section == "[RegionAreas]") {
+			auto& rings{ data.areas[key] };
+			for (size_t open{ value.find('[') }; open != std::string::npos; open = value.find('[', open + 1ull))
+				rings.emplace_back(parsePoints(value.substr(open, value.find(']', open) - open)));
+		}
+		else if (const auto& cell{ parsePoints(key) }; CHECK(cell.size() == 1ull)) {
+			const auto& names{ parseQuoted(value) };
+			if (section == "[HoldMap]")
+				data.holds[cell.front()] = names;
+			else if (section == "[WinnerMap]" && CHECK(names.size() == 1ull))
+				data.winners[cell.front()] = names.front();
+			else CHECK(!"unknown section");
+		}
+	}
+	return data;
+}
+
+/// @brief	Read the contents of a binary map file.
+MapData readBinary(const binmap::Reader& reader)
+{
+	MapData data;
+	for (std::uint16_t index{ 1u }; index <= reader.regionCount(); ++index) {
+		const auto& polygons{ reader.polygons(index) };
+		if (polygons.empty())
+			continue;
+		auto& rings{ data.areas[std::string{ reader.editorID(index) }] };
+		for (const auto& polygon : polygons)
+			for (std::uint32_t ring{ polygon.firstRing }; ring < polygon.firstRing + polygon.ringCount; ++ring) {
+				auto& points{ rings.emplace_back() };
+				for (const auto& vertex : reader.ring(ring))
+					points.emplace_back(vertex.x, vertex.y);
+			}
+	}
+
+	const auto& header{ reader.getHeader() };
+	for (std::int32_t y{ 0 }; y < reader.gridHeight(); ++y)
+		for (std::int32_t x{ 0 }; x < reader.gridWidth(); ++x) {
+			const Pos cell{ header.originX + x, header.originY - y };
+			if (const auto& indices{ reader.cell(x, y) }; !indices.empty()) {
+				auto& names{ data.holds[cell] };
+				for (const auto& index : indices)
+					names.emplace_back(reader.editorID(index));
+			}
+			if (const auto& winner{ reader.winner(x, y) }; winner != 0u)
+				data.winners[cell] = reader.editorID(winner);
+		}
+	return data;
+}
+
+int main()
+{
+	std::mt19937 rng{ 307u };
+
+	RegionVec regionVec;
+	for (ushort i{ 1u }; i <= 5u; ++i)
+		regionVec.emplace_back("Region" + std::to_string(i), "Region " + std::to_string(i), RGB{ static_cast<uchar>(i * 40u), static_cast<uchar>(i), 0u }, static_cast<ushort>(i % 3u));
+	const ColorLUT lut{ regionVec };
+	const RegionTable& regions{ lut.getRegionTable() };
+
+	// rectangles of random regions, with a few stray pixels, so that cells are uniform, mixed & empty
+	const cv::Size gridSize{ 12, 9 }, cellSize{ 4, 4 };
+	cv::Mat labels(gridSize.height * cellSize.height, gridSize.width * cellSize.width, CV_8UC1, cv::Scalar(0));
+	for (int i{ 0 }; i < 12; ++i) {
+		const int x0{ static_cast<int>(rng() % static_cast<unsigned>(labels.cols)) }, y0{ static_cast<int>(rng() % static_cast<unsigned>(labels.rows)) };
+		const int x1{ std::min(labels.cols, x0 + 1 + static_cast<int>(rng() % 20u)) }, y1{ std::min(labels.rows, y0 + 1 + static_cast<int>(rng() % 20u)) };
+		const uchar region{ static_cast<uchar>(rng() % (regions.size() + 1ull)) };
+		for (int y{ y0 }; y < y1; ++y)
+			for (int x{ x0 }; x < x1; ++x)
+				labels.ptr<uchar>(y)[x] = region;
+	}
+	for (int i{ 0 }; i < 40; ++i)
+		labels.ptr<uchar>(static_cast<int>(rng() % static_cast<unsigned>(labels.rows)))[rng() % static_cast<unsigned>(labels.cols)] = static_cast<uchar>(rng() % (regions.size() + 1ull));
+
+	const CellMapper mapper{ lut, gridSize, cellSize, 0.2f };
+	const auto& result{ mapper.run([&labels, &cellSize](const int& y) { return labels.rowRange(y * cellSize.height, (y + 1) * cellSize.height); }) };
+	const RegionAreaMap regionAreas{ result.regionStats };
+
+	const auto& text{ readText(maptext::serialize(regions, gridSize, regionAreas, result.holdMap, &result.winners)) };
+	const auto& bytes{ binmap::serialize(regions, gridSize, regionAreas, result.holdMap, result.winners) };
+	const binmap::Reader reader{ bytes };
+	const auto& binary{ readBinary(reader) };
+
+	// the test is only meaningful when every section has something in it
+	CHECK(!text.areas.empty() && !text.holds.empty() && !text.winners.empty());
+	CHECK(text.areas.size() == result.regionStats.size());
+	CHECK(text.holds.size() == result.holdMap.size());
+
+	CHECK(text.areas == binary.areas);
+	CHECK(text.holds == binary.holds);
+	CHECK(text.winners == binary.winners);
+
+	// regions that weren't found are only in the binary file's region table
+	if (CHECK(reader.regionCount() == regions.size()))
+		for (RegionIndex index{ 1u }; index <= regions.size(); ++index) {
+			const auto& record{ reader.region(index) };
+			CHECK(reader.editorID(index) == regions[index].editorID && reader.mapName(index) == regions[index].mapName);
+			CHECK(record.r == regions[index].color.r() && record.g == regions[index].color.g() && record.b == regions[index].color.b());
+			CHECK(record.priority == regions[index].priority);
+		}
+
+	return test::report("test_binary_map");
+}
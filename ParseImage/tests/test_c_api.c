@@ -0,0 +1,107 @@
+/**
+ * @file	test_c_api.c
+ * @brief	Checks that `parseimg.h` can be used from C99, by classifying a small image through the C API of `parseimg_core`.
+ */
+#include "../parseimg.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(expr) check((expr), #expr, __LINE__)
+
+static int check(const int condition, const char* expr, const int line)
+{
+	if (!condition) {
+		++failures;
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, line, expr);
+	}
+	return condition;
+}
+
+/// @brief	Find the index of a region by its editor ID, or 0 when it doesn't exist.
+static uint16_t findRegion(const pimg_config* config, const char* editorID)
+{
+	for (uint16_t index = 1u; index <= pimg_config_region_count(config); ++index) {
+		pimg_region region;
+		if (pimg_config_region(config, index, &region) == PIMG_OK && strcmp(region.editor_id, editorID) == 0)
+			return index;
+	}
+	return 0u;
+}
+
+int main(void)
+{
+	const char* ini = "test_c_api.ini";
+	FILE* file = fopen(ini, "w");
+	if (!CHECK(file != NULL))
+		return 1;
+	fputs("[xxxMapRed]\ncolor = \"FF0000\"\npriority = 10\n[xxxMapBlue]\ncolor = \"0000FF\"\npriority = 20\n", file);
+	fclose(file);
+
+	pimg_config* config = NULL;
+	const pimg_status loaded = pimg_config_load(&ini, 1u, 0u, &config);
+	remove(ini);
+	if (!CHECK(loaded == PIMG_OK && config != NULL)) {
+		fprintf(stderr, "%s\n", pimg_last_error());
+		return 1;
+	}
+	CHECK(pimg_api_version() == PIMG_API_VERSION);
+	CHECK(pimg_config_region_count(config) == 2u);
+	const uint16_t red = findRegion(config, "xxxMapRed"), blue = findRegion(config, "xxxMapBlue");
+	CHECK(red != 0u && blue != 0u && red != blue);
+
+	// 3 cells of 4x4 pixels: all red, half red & half blue, and empty
+	uint8_t pixels[4][12][3];
+	memset(pixels, 0, sizeof(pixels));
+	for (int y = 0; y < 4; ++y)
+		for (int x = 0; x < 8; ++x)
+			pixels[y][x][x < 4 || y < 2 ? 2 : 0] = 0xFFu;
+
+	const pimg_image image = { pixels, 12, 4, sizeof(pixels[0]), PIMG_BGR8 };
+	const pimg_options options = { 4, 4, 0.25f, 2u };
+	pimg_result* result = NULL;
+	if (CHECK(pimg_classify(config, &image, &options, &result) == PIMG_OK && result != NULL)) {
+		int32_t width = 0, height = 0, originX = 0, originY = 0;
+		pimg_result_grid(result, &width, &height, &originX, &originY);
+		CHECK(width == 3 && height == 1);
+
+		const uint16_t* regions = NULL;
+		CHECK(pimg_result_cell(result, originX, originY, &regions) == 1u && regions[0] == red);
+		if (CHECK(pimg_result_cell(result, originX + 1, originY, &regions) == 2u))
+			CHECK((regions[0] == red && regions[1] == blue) || (regions[0] == blue && regions[1] == red));
+		CHECK(pimg_result_cell(result, originX + 2, originY, &regions) == 0u);
+		CHECK(pimg_result_winner(result, originX + 1, originY) == blue);
+		CHECK(pimg_result_winner(result, originX + 2, originY) == 0u);
+
+		uint16_t found[4];
+		CHECK(pimg_result_regions_at(result, originX + 0.5, originY + 0.5, found, 4u) == 1u && found[0] == red);
+
+		// the red region is both of the first 2 cells, which is one rectangle
+		uint32_t first = 0u, rings = 0u;
+		if (CHECK(pimg_result_polygon_count(result, red) == 1u && pimg_result_polygon(result, red, 0u, &first, &rings) == PIMG_OK && rings == 1u)) {
+			const pimg_vertex* vertices = NULL;
+			CHECK(pimg_result_ring(result, first, &vertices) == 4u && vertices[0].x == originX && vertices[0].y == originY);
+		}
+
+		const void* data = NULL;
+		size_t size = 0u;
+		CHECK(pimg_result_binary_map(result, &data, &size) == PIMG_OK && data != NULL && size != 0u);
+		pimg_result_free(result);
+	}
+
+	// invalid arguments are reported instead of crashing
+	const pimg_image unknown = { pixels, 12, 4, sizeof(pixels[0]), 7u };
+	result = NULL;
+	CHECK(pimg_classify(config, &unknown, &options, &result) == PIMG_INVALID_ARGUMENT && result == NULL && pimg_last_error()[0] != '\0');
+	CHECK(pimg_config_region(config, 3u, NULL) == PIMG_INVALID_ARGUMENT);
+
+	pimg_config_free(config);
+
+	if (failures == 0)
+		printf("test_c_api: passed\n");
+	else
+		fprintf(stderr, "test_c_api: %d check(s) failed\n", failures);
+	return failures == 0 ? 0 : 1;
+}
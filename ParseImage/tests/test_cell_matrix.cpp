@@ -0,0 +1,121 @@
+#include "check.hpp"
+
+#include "../CellMatrix.hpp"
+#include "../LabelImage.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief			Check every cell of a matrix against counts made one pixel at a time.
+ * @param matrix	The matrix to check.
+ * @param labels	The label of every pixel of the image the matrix was parsed from.
+ * @returns			true when every cell has the expected counts & kind.
+ */
+bool matches(const CellMatrix& matrix, const cv::Mat& labels)
+{
+	const cv::Size& cellSize{ matrix.getCellSize() };
+	bool same{ true };
+	for (int cy{ 0 }; cy < matrix.size().height; ++cy) {
+		for (int cx{ 0 }; cx < matrix.size().width; ++cx) {
+			const auto& counts{ matrix.at(cx, cy) };
+			std::vector<CellMatrix::count> expected(counts.size(), 0u);
+			for (int y{ cy * cellSize.height }; y < (cy + 1) * cellSize.height; ++y)
+				for (int x{ cx * cellSize.width }; x < (cx + 1) * cellSize.width; ++x)
+					++expected[labels.ptr<RegionIndex>(y)[x]];
+
+			const auto& nonzero{ std::count_if(expected.begin(), expected.end(), [](const CellMatrix::count& c) { return c != 0u; }) };
+			const TileKind kind{ nonzero > 1 ? TileKind::Mixed : expected[ColorLUT::NONE] != 0u ? TileKind::Empty : TileKind::Uniform };
+			same = CHECK(std::equal(counts.begin(), counts.end(), expected.begin(), expected.end())) && same;
+			same = CHECK(matrix.getKind(cx, cy) == kind) && same;
+			if (kind == TileKind::Uniform)
+				same = CHECK(expected[matrix.getUniformRegion(cx, cy)] == static_cast<CellMatrix::count>(cellSize.area())) && same;
+		}
+	}
+	return same;
+}
+
+/**
+ * @brief			Check the labels that were written while parsing the cells of a matrix.
+ * @param matrix	The matrix that was parsed.
+ * @param written	The label strips that were filled while parsing, as one image.
+ * @param labels	The label of every pixel of the image the matrix was parsed from.
+ * @returns			true when every pixel of every cell has the expected label.
+ */
+bool wroteLabels(const CellMatrix& matrix, const cv::Mat& written, const cv::Mat& labels)
+{
+	const cv::Size& cellSize{ matrix.getCellSize() };
+	for (int y{ 0 }; y < matrix.size().height * cellSize.height; ++y)
+		if (!std::equal(labels.ptr<RegionIndex>(y), labels.ptr<RegionIndex>(y) + matrix.size().width * cellSize.width, written.ptr<RegionIndex>(y)))
+			return false;
+	return true;
+}
+
+int main()
+{
+	std::mt19937 rng{ 307u };
+
+	RegionVec regionVec;
+	for (ushort i{ 1u }; i <= 3u; ++i)
+		regionVec.emplace_back("Region" + std::to_string(i), "Region " + std::to_string(i), RGB{ static_cast<uchar>(i * 60u), 10u, 20u }, 0u);
+	const ColorLUT lut{ regionVec };
+	// two colors for each label: the region's own color, and one that is unmatched for NONE
+	const auto& colorOf{ [&regionVec](const RegionIndex& label, const bool& alt) {
+		return label == ColorLUT::NONE ? (alt ? RGB{ 1u, 2u, 3u } : RGB{ 255u, 255u, 255u }) : regionVec[label - 1u].color;
+	} };
+
+	const cv::Size gridSize{ 9, 7 }, cellSize{ 5, 3 };
+	cv::Mat bgr(gridSize.height * cellSize.height + 2, gridSize.width * cellSize.width + 3, CV_8UC3);
+	cv::Mat labels(bgr.rows, bgr.cols, CV_16UC1);
+	// solid cells of every label, cells with one pixel that differs at every position, cells of two unmatched colors, random cells, and cells whose last row differs
+	for (int cy{ 0 }; cy * cellSize.height < bgr.rows; ++cy) {
+		for (int cx{ 0 }; cx * cellSize.width < bgr.cols; ++cx) {
+			const int kind{ static_cast<int>(rng() % 5u) };
+			const RegionIndex base{ static_cast<RegionIndex>(rng() % 4u) }, other{ static_cast<RegionIndex>(rng() % 4u) };
+			const int odd{ static_cast<int>(rng() % static_cast<unsigned>(cellSize.area())) };
+			for (int py{ 0 }; py < cellSize.height && cy * cellSize.height + py < bgr.rows; ++py) {
+				for (int px{ 0 }; px < cellSize.width && cx * cellSize.width + px < bgr.cols; ++px) {
+					RegionIndex label{ base };
+					bool alt{ false };
+					if (kind == 1 && py * cellSize.width + px == odd)
+						label = other;
+					else if (kind == 2)
+						label = ColorLUT::NONE, alt = (rng() % 2u) == 0u;
+					else if (kind == 3)
+						label = static_cast<RegionIndex>(rng() % 4u);
+					else if (kind == 4 && py == cellSize.height - 1)
+						label = other;
+					const RGB& color{ colorOf(label, alt) };
+					const int y{ cy * cellSize.height + py }, x{ cx * cellSize.width + px };
+					uchar* pixel{ bgr.ptr<uchar>(y) + x * 3 };
+					pixel[0] = color.b();
+					pixel[1] = color.g();
+					pixel[2] = color.r();
+					labels.ptr<RegionIndex>(y)[x] = label;
+				}
+			}
+		}
+	}
+
+	// the same cells & pixel labels are found from colors, 8-bit labels & 16-bit labels, when parsed by row or one cell at a time
+	const LabelImage labels8{ bgr, lut };
+	for (const cv::Mat& image : { bgr, labels8.mat(), labels }) {
+		CHECK(matches(CellMatrix{ image, cellSize, lut }, labels));
+
+		CellMatrix byRow{ gridSize, cellSize, lut.size() }, byCell{ gridSize, cellSize, lut.size() };
+		cv::Mat rowLabels(image.rows, image.cols, CV_16UC1, cv::Scalar{ 0xFFFF }), cellLabels(image.rows, image.cols, CV_16UC1, cv::Scalar{ 0xFFFF });
+		for (int y{ 0 }; y < gridSize.height; ++y) {
+			const cv::Mat& strip{ image.rowRange(y * cellSize.height, (y + 1) * cellSize.height) };
+			cv::Mat rowStrip{ rowLabels.rowRange(y * cellSize.height, (y + 1) * cellSize.height) }, cellStrip{ cellLabels.rowRange(y * cellSize.height, (y + 1) * cellSize.height) };
+			byRow.parseRow(strip, y, lut, &rowStrip);
+			for (int x{ 0 }; x < gridSize.width; ++x)
+				byCell.parseCell(strip, x, y, lut, &cellStrip);
+		}
+		CHECK(matches(byRow, labels) && wroteLabels(byRow, rowLabels, labels));
+		CHECK(matches(byCell, labels) && wroteLabels(byCell, cellLabels, labels));
+	}
+
+	return test::report("test_cell_matrix");
+}
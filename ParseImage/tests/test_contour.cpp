@@ -0,0 +1,106 @@
+#include "check.hpp"
+
+#include "../Contour.hpp"
+
+#include <random>
+#include <vector>
+
+using contour::Polygon;
+using contour::Ring;
+
+/**
+ * @brief		Trace a set of cells, and again with a distant cell added so that the sparse lookup is used instead of the dense one.
+ * @param cells	The cells to trace.
+ * @returns		The polygons of `cells`, when both traces agree on them; otherwise an empty vector.
+ */
+std::vector<Polygon> trace(std::vector<cv::Point> cells)
+{
+	const auto& dense{ contour::trace(cells) };
+	// the distant cell is below every other cell, so its polygon comes first
+	cells.emplace_back(100000, -100000);
+	const auto& sparse{ contour::trace(cells) };
+
+	bool same{ sparse.size() == dense.size() + 1ull };
+	for (size_t i{ 0ull }; same && i < dense.size(); ++i)
+		same = sparse[i + 1ull].outer == dense[i].outer && sparse[i + 1ull].holes == dense[i].holes;
+	CHECK(same);
+	return same ? dense : std::vector<Polygon>{};
+}
+
+int main()
+{
+	// a single cell is a square of its 4 corners, counter-clockwise from the bottom-left
+	{
+		const auto& polygons{ trace({ { 5, -3 } }) };
+		if (CHECK(polygons.size() == 1ull)) {
+			CHECK(polygons[0].outer == Ring{ { 5, -3 }, { 6, -3 }, { 6, -2 }, { 5, -2 } });
+			CHECK(polygons[0].holes.empty());
+		}
+	}
+
+	// cells that only touch at a corner are separate polygons, ordered by their bottom-left-most cell
+	{
+		const auto& polygons{ trace({ { 1, 1 }, { 0, 0 } }) };
+		if (CHECK(polygons.size() == 2ull)) {
+			CHECK(polygons[0].outer == Ring{ { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } });
+			CHECK(polygons[1].outer == Ring{ { 1, 1 }, { 2, 1 }, { 2, 2 }, { 1, 2 } });
+		}
+		// the other diagonal
+		const auto& other{ trace({ { 0, 1 }, { 1, 0 } }) };
+		if (CHECK(other.size() == 2ull)) {
+			CHECK(other[0].outer == Ring{ { 1, 0 }, { 2, 0 }, { 2, 1 }, { 1, 1 } });
+			CHECK(other[1].outer == Ring{ { 0, 1 }, { 1, 1 }, { 1, 2 }, { 0, 2 } });
+		}
+	}
+
+	// a 3x3 square without its center has a clockwise hole, and duplicate cells are ignored
+	{
+		std::vector<cv::Point> cells;
+		for (int y{ 0 }; y < 3; ++y)
+			for (int x{ 0 }; x < 3; ++x)
+				if (x != 1 || y != 1)
+					cells.emplace_back(x, y);
+		cells.emplace_back(0, 0);
+		const auto& polygons{ trace(cells) };
+		if (CHECK(polygons.size() == 1ull)) {
+			CHECK(polygons[0].outer == Ring{ { 0, 0 }, { 3, 0 }, { 3, 3 }, { 0, 3 } });
+			if (CHECK(polygons[0].holes.size() == 1ull)) {
+				CHECK(polygons[0].holes[0] == Ring{ { 1, 1 }, { 1, 2 }, { 2, 2 }, { 2, 1 } });
+				CHECK(contour::signedArea2(polygons[0].holes[0]) == -2ll);
+			}
+		}
+	}
+
+	// an empty cell that touches the outside at a corner isn't a hole: the outer ring passes through that corner twice
+	{
+		const std::vector<cv::Point> cells{ { 0, 0 }, { 1, 0 }, { 2, 0 }, { 0, 1 }, { 2, 1 }, { 0, 2 }, { 1, 2 } };
+		const auto& polygons{ trace(cells) };
+		if (CHECK(polygons.size() == 1ull)) {
+			CHECK(polygons[0].outer == Ring{ { 0, 0 }, { 3, 0 }, { 3, 2 }, { 2, 2 }, { 2, 1 }, { 1, 1 }, { 1, 2 }, { 2, 2 }, { 2, 3 }, { 0, 3 } });
+			CHECK(polygons[0].holes.empty());
+		}
+	}
+
+	// random sets: the area inside of the rings is always the number of distinct cells, and the dense & sparse lookups agree
+	std::mt19937 rng{ 307u };
+	for (int i{ 0 }; i < 500; ++i) {
+		std::vector<cv::Point> cells;
+		const int size{ 1 + static_cast<int>(rng() % 20u) };
+		for (int y{ 0 }; y < size; ++y)
+			for (int x{ 0 }; x < size; ++x)
+				if (rng() % 3u != 0u)
+					cells.emplace_back(x - 10, y + 40);
+		if (cells.empty())
+			continue;
+		long long area{ 0ll };
+		for (const auto& polygon : trace(cells)) {
+			CHECK(contour::signedArea2(polygon.outer) > 0ll);
+			area += contour::signedArea2(polygon.outer);
+			for (const auto& hole : polygon.holes)
+				area += contour::signedArea2(hole);
+		}
+		CHECK(area == 2ll * static_cast<long long>(cells.size()));
+	}
+
+	return test::report("test_contour");
+}
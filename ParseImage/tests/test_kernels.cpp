@@ -0,0 +1,132 @@
+#include "check.hpp"
+
+#include "../ColorLUT.hpp"
+#include "../PixelKernel.hpp"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief		Get every instruction set supported by the current CPU, in ascending order.
+ * @returns		std::vector<kernel::ISA>
+ */
+std::vector<kernel::ISA> supportedISAs()
+{
+	std::vector<kernel::ISA> vec;
+	for (const auto& isa : { kernel::ISA::Scalar, kernel::ISA::SSE42, kernel::ISA::AVX2 })
+		if (isa <= kernel::detect())
+			vec.emplace_back(isa);
+	return vec;
+}
+
+/**
+ * @brief			Classify a row with a kernel, with the row placed at the very end of its buffer so that any read past the last pixel is out of bounds.
+ * @param fn		The kernel to run.
+ * @param pixels	The BGR pixels of the row.
+ * @param table		The lookup table.
+ * @returns			std::vector<RegionIndex>
+ */
+std::vector<RegionIndex> classify(const kernel::ClassifyFn& fn, const std::vector<uchar>& pixels, const RegionIndex* table)
+{
+	const std::vector<uchar> buffer{ pixels };
+	std::vector<RegionIndex> out(pixels.size() / 3ull, 0xDEAD);
+	fn(buffer.data(), out.size(), out.data(), table);
+	return out;
+}
+
+/// @brief	Append a pixel to a row, from a 24-bit key.
+void push(std::vector<uchar>& row, const unsigned& key)
+{
+	row.emplace_back(static_cast<uchar>(key & 0xFF));
+	row.emplace_back(static_cast<uchar>((key >> 8) & 0xFF));
+	row.emplace_back(static_cast<uchar>((key >> 16) & 0xFF));
+}
+
+int main()
+{
+	std::mt19937 rng{ 307u };
+	const auto& isas{ supportedISAs() };
+	std::cout << "Testing " << isas.size() << " kernel(s), up to " << kernel::getName(kernel::detect()) << '\n';
+
+	// every class of table entry: unmatched colors, 8-bit & 16-bit indices, the largest index, and the last key, whose gather reads the padding entry
+	std::vector<RegionIndex> table(ColorLUT::SIZE + 1ull, ColorLUT::NONE);
+	std::vector<unsigned> palette{ 0x000000u, 0xFFFFFFu, 0x123456u };
+	table[0xFFFFFFu] = 0xFFFFu;
+	table[0x123456u] = 1u;
+	for (unsigned i{ 0u }; i < 64u; ++i) {
+		const unsigned key{ static_cast<unsigned>(rng() & 0xFFFFFFu) };
+		table[key] = static_cast<RegionIndex>(i % 2u == 0u ? 1u + i : 0x100u + i * 997u);
+		palette.emplace_back(key);
+	}
+	table.back() = 0x5A5Au; //< padding must never be returned
+
+	const auto& compare{ [&](const std::vector<uchar>& row, const RegionIndex* tbl, const std::string& what) {
+		const auto& expected{ classify(kernel::classify_scalar, row, tbl) };
+		for (const auto& isa : isas)
+			if (!CHECK(classify(kernel::get(isa), row, tbl) == expected))
+				std::cerr << "  " << kernel::getName(isa) << " kernel, " << what << ", width " << row.size() / 3ull << '\n';
+	} };
+
+	// every width up to several vector widths, then a few that aren't multiples of any vector width
+	std::vector<size_t> widths;
+	for (size_t w{ 0ull }; w <= 40ull; ++w)
+		widths.emplace_back(w);
+	for (const auto& w : { 255ull, 1000ull, 1023ull, 4097ull })
+		widths.emplace_back(w);
+
+	for (const auto& width : widths) {
+		std::vector<uchar> row;
+		row.reserve(width * 3ull);
+
+		// random colors from the palette, so that matched & unmatched pixels are mixed
+		for (size_t x{ 0ull }; x < width; ++x)
+			push(row, palette[rng() % palette.size()]);
+		compare(row, table.data(), "palette");
+
+		// random 24-bit colors, which are almost never matched
+		row.clear();
+		for (size_t x{ 0ull }; x < width; ++x)
+			push(row, rng() & 0xFFFFFFu);
+		compare(row, table.data(), "random");
+
+		// one color, which takes the uniform shortcut of the vectorized kernels
+		for (const auto& key : { 0xFFFFFFu, 0x123456u, 0x000000u }) {
+			row.clear();
+			for (size_t x{ 0ull }; x < width; ++x)
+				push(row, key);
+			compare(row, table.data(), "uniform");
+
+			// a different color at each position, which must break the uniform shortcut of the block that contains it
+			for (size_t x{ 0ull }; x < width; ++x) {
+				std::vector<uchar> broken{ row };
+				broken[x * 3ull + 2ull] ^= 0x80u;
+				compare(broken, table.data(), "uniform broken at " + std::to_string(x));
+			}
+		}
+	}
+
+	// a real table with a tolerance, through the ColorLUT interface
+	RegionVec regions;
+	for (size_t i{ 1ull }; i <= 300ull; ++i)
+		regions.emplace_back("Region" + std::to_string(i), "Region " + std::to_string(i), RGB{ static_cast<uchar>(rng()), static_cast<uchar>(rng()), static_cast<uchar>(rng()) }, static_cast<ushort>(0u));
+	std::vector<uchar> row;
+	for (size_t x{ 0ull }; x < 1999ull; ++x) {
+		const auto& color{ regions[rng() % regions.size()].color };
+		// near the region's color, so that some pixels are only matched because of the tolerance
+		push(row, ColorLUT::key(static_cast<uchar>(color.b() + rng() % 5u), color.g(), color.r()));
+	}
+	const ColorLUT scalar{ regions, 3u, kernel::ISA::Scalar };
+	std::vector<RegionIndex> expected(row.size() / 3ull);
+	scalar.classify(row.data(), expected.size(), expected.data());
+	for (const auto& isa : isas) {
+		const ColorLUT lut{ regions, 3u, isa };
+		std::vector<RegionIndex> out(expected.size());
+		lut.classify(row.data(), out.size(), out.data());
+		CHECK(lut.getISA() == isa);
+		CHECK(out == expected);
+	}
+
+	return test::report("test_kernels");
+}
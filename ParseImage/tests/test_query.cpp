@@ -0,0 +1,302 @@
+#include "check.hpp"
+
+#include "../QueryServer.hpp"
+#include "../RegionAreaMap.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @struct	Map
+ * @brief	The results of classifying a small label image, and a query index of them.
+ */
+struct Map {
+	const ColorLUT lut;
+	CellMapper::Result result;
+	std::shared_ptr<const QueryIndex> index;
+};
+
+/// @brief	Classify a label image of random rectangles, with a few stray pixels so that some cells have several regions.
+std::shared_ptr<Map> makeMap(const unsigned& seed)
+{
+	std::mt19937 rng{ seed };
+	RegionVec regionVec;
+	for (ushort i{ 1u }; i <= 4u; ++i)
+		regionVec.emplace_back("Region" + std::to_string(i), "Region " + std::to_string(i), RGB{ static_cast<uchar>(i * 50u), 0u, 0u }, static_cast<ushort>(i % 2u));
+	auto map{ std::make_shared<Map>(ColorLUT{ regionVec }) };
+
+	const cv::Size gridSize{ 10, 8 }, cellSize{ 4, 4 };
+	cv::Mat labels(gridSize.height * cellSize.height, gridSize.width * cellSize.width, CV_8UC1, cv::Scalar(0));
+	for (int i{ 0 }; i < 10; ++i) {
+		const int x0{ static_cast<int>(rng() % static_cast<unsigned>(labels.cols)) }, y0{ static_cast<int>(rng() % static_cast<unsigned>(labels.rows)) };
+		const int x1{ std::min(labels.cols, x0 + 1 + static_cast<int>(rng() % 16u)) }, y1{ std::min(labels.rows, y0 + 1 + static_cast<int>(rng() % 16u)) };
+		const uchar region{ static_cast<uchar>(rng() % 5u) };
+		for (int y{ y0 }; y < y1; ++y)
+			for (int x{ x0 }; x < x1; ++x)
+				labels.ptr<uchar>(y)[x] = region;
+	}
+	for (int i{ 0 }; i < 30; ++i)
+		labels.ptr<uchar>(static_cast<int>(rng() % static_cast<unsigned>(labels.rows)))[rng() % static_cast<unsigned>(labels.cols)] = static_cast<uchar>(rng() % 5u);
+
+	const CellMapper mapper{ map->lut, gridSize, cellSize, 0.2f };
+	map->result = mapper.run([&labels, &cellSize](const int& y) { return labels.rowRange(y * cellSize.height, (y + 1) * cellSize.height); });
+	map->index = std::make_shared<const QueryIndex>(map->lut.getRegionTable(), gridSize, RegionAreaMap{ map->result.regionStats }, map->result.holdMap, map->result.winners);
+	return map;
+}
+
+/// @brief	Get the regions that were found in a cell, in ascending order.
+std::vector<std::uint16_t> regionsOf(const Map& map, const cv::Point& cell)
+{
+	std::vector<std::uint16_t> vec;
+	for (const auto& [index, stats] : map.result.regionStats)
+		if (std::find(stats.begin(), stats.end(), cell) != stats.end())
+			vec.emplace_back(index);
+	return vec;
+}
+
+#ifndef _WIN32
+/**
+ * @class	Client
+ * @brief	Encodes requests & decodes responses of the query protocol, over a Unix domain socket.
+ */
+class Client {
+	int s{ -1 };
+
+	bool recvAll(void* data, size_t size)
+	{
+		for (char* p{ static_cast<char*>(data) }; size != 0ull;) {
+			const auto& n{ ::recv(s, p, size, 0) };
+			if (n <= 0)
+				return false;
+			p += n;
+			size -= static_cast<size_t>(n);
+		}
+		return true;
+	}
+
+public:
+	/// @brief	Connect to a server, waiting for it to start listening.
+	explicit Client(const std::filesystem::path& path)
+	{
+		sockaddr_un addr{};
+		addr.sun_family = AF_UNIX;
+		std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1ull);
+		for (int attempt{ 0 }; attempt < 500; ++attempt) {
+			s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			if (::connect(s, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0) {
+				// a server that waits for a payload instead of rejecting a request fails the test rather than hanging it
+				const timeval timeout{ 5, 0 };
+				::setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+				return;
+			}
+			::close(s);
+			s = -1;
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+	~Client() noexcept
+	{
+		if (s != -1)
+			::close(s);
+	}
+
+	bool connected() const { return s != -1; }
+
+	/// @brief	Send a request header followed by its payload.
+	template<typename T = char>
+	bool send(const std::uint16_t& command, const std::uint32_t& count, const std::vector<T>& payload = {})
+	{
+		const query::RequestHeader header{ command, 0u, count };
+		std::vector<char> bytes(sizeof(header) + payload.size() * sizeof(T));
+		std::memcpy(bytes.data(), &header, sizeof(header));
+		if (!payload.empty())
+			std::memcpy(bytes.data() + sizeof(header), payload.data(), payload.size() * sizeof(T));
+		return ::send(s, bytes.data(), bytes.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(bytes.size());
+	}
+
+	/// @brief	Receive a response header.
+	bool header(query::ResponseHeader& header) { return recvAll(&header, sizeof(header)); }
+
+	/// @brief	Receive `count` values.
+	template<typename T>
+	std::vector<T> values(const size_t& count)
+	{
+		std::vector<T> vec(count);
+		if (!recvAll(vec.data(), count * sizeof(T)))
+			vec.clear();
+		return vec;
+	}
+
+	/// @brief	Receive a list of results: `count + 1` offsets, then the elements of every result.
+	template<typename T>
+	std::vector<std::vector<T>> lists(const size_t& count)
+	{
+		const auto& offsets{ values<std::uint32_t>(count + 1ull) };
+		if (offsets.size() != count + 1ull)
+			return{};
+		const auto& elements{ values<T>(offsets.back()) };
+		std::vector<std::vector<T>> results;
+		for (size_t i{ 0ull }; i < count; ++i)
+			results.emplace_back(elements.begin() + offsets[i], elements.begin() + offsets[i + 1ull]);
+		return results;
+	}
+
+	/// @brief	Check if the server closed the connection.
+	bool closed()
+	{
+		char c;
+		return ::recv(s, &c, 1ull, 0) <= 0;
+	}
+};
+
+/// @brief	Send a request that must be rejected, and check that the connection is closed after the rejection.
+bool rejects(const std::filesystem::path& path, const std::uint16_t& command, const std::uint32_t& count)
+{
+	Client client{ path };
+	query::ResponseHeader header{};
+	if (!client.send(command, count) || !client.header(header) || header.status != static_cast<std::uint16_t>(query::Status::BadRequest))
+		return false;
+	const auto& message{ client.values<char>(header.count) };
+	return message.size() == header.count && client.closed();
+}
+#endif
+
+int main()
+{
+	const auto& map{ makeMap(307u) };
+	const auto& index{ *map->index };
+	const auto& header{ index.getReader().getHeader() };
+	const cv::Point origin{ header.originX, header.originY };
+
+	// lookups by cell & point agree with the classified cells
+	CHECK(!map->result.holdMap.empty());
+	for (int y{ 0 }; y < header.gridHeight; ++y) {
+		for (int x{ 0 }; x < header.gridWidth; ++x) {
+			const cv::Point cell{ origin.x + x, origin.y - y };
+			const auto& regions{ index.cell(cell.x, cell.y) };
+			const auto& hold{ std::find_if(map->result.holdMap.begin(), map->result.holdMap.end(), [&cell](const auto& pair) { return pair.first == cell; }) };
+			CHECK(hold == map->result.holdMap.end() ? regions.empty() : std::equal(regions.begin(), regions.end(), hold->second.begin(), hold->second.end()));
+			CHECK(index.winner(cell.x, cell.y) == map->result.winners[static_cast<size_t>(y) * header.gridWidth + x]);
+
+			// every region polygon is a union of whole cells, so a point is in the same regions as its cell
+			std::vector<std::uint16_t> found;
+			index.regionsAt(cell.x + 0.5, cell.y + 0.5, found);
+			CHECK(found == regionsOf(*map, cell));
+			found.clear();
+			index.regionsAtWorld((cell.x + 0.25) * QueryIndex::UNITS_PER_CELL, (cell.y + 0.75) * QueryIndex::UNITS_PER_CELL, found);
+			CHECK(found == regionsOf(*map, cell));
+		}
+	}
+	// outside of the grid
+	CHECK(index.cell(origin.x - 1, origin.y).empty() && index.winner(origin.x, origin.y + 1) == 0u);
+	std::vector<std::uint16_t> outside;
+	index.regionsAt(origin.x - 100.5, origin.y + 100.5, outside);
+	CHECK(outside.empty());
+	// points that can't be converted to a bucket, which clients may send
+	const double inf{ std::numeric_limits<double>::infinity() }, nan{ std::numeric_limits<double>::quiet_NaN() };
+	for (const auto& [x, y] : { std::pair{ nan, origin.y - 0.5 }, std::pair{ origin.x + 0.5, nan }, std::pair{ inf, origin.y - 0.5 }, std::pair{ -inf, origin.y - 0.5 }, std::pair{ origin.x + 0.5, -inf }, std::pair{ 1e300, 1e300 }, std::pair{ -1e300, origin.y - 0.5 }, std::pair{ origin.x + 0.5, -1e300 } })
+		index.regionsAt(x, y, outside);
+	CHECK(outside.empty());
+
+#ifndef _WIN32
+	const auto& dir{ std::filesystem::temp_directory_path() / "parseimg_test_query" };
+	std::filesystem::create_directories(dir);
+	const auto& path{ dir / "query.sock" };
+
+	// the server is reloaded with a different map, to check that reloads are swapped in
+	const auto& reloaded{ makeMap(308u) };
+	int loads{ 0 };
+	Logger logger{ LogLevel::Error, std::clog };
+	QueryServer server{ path, [&] { return QueryServer::Load{ loads++ == 0 ? map->index : reloaded->index, 5u, 75u }; }, logger };
+	std::jthread thread{ [&server] { server.run(); } };
+
+	{
+		Client client{ path };
+		if (CHECK(client.connected())) {
+			query::ResponseHeader response{};
+
+			// info
+			CHECK(client.send(static_cast<std::uint16_t>(query::Command::Info), 0u) && client.header(response) && response.status == 0u && response.count == 1u);
+			const auto& info{ client.values<query::InfoRecord>(1ull) };
+			if (CHECK(info.size() == 1ull)) {
+				CHECK(info[0].version == query::VERSION && info[0].regionCount == index.regionCount() && info[0].generation == 0ull);
+				CHECK(info[0].gridWidth == header.gridWidth && info[0].gridHeight == header.gridHeight && info[0].originX == header.originX && info[0].originY == header.originY);
+			}
+
+			// cells, points & winners, including positions outside of the grid
+			std::vector<query::CellQuery> cells;
+			std::vector<query::PointQuery> points;
+			for (int y{ -1 }; y <= header.gridHeight; ++y)
+				for (int x{ -1 }; x <= header.gridWidth; ++x) {
+					cells.emplace_back(query::CellQuery{ origin.x + x, origin.y - y });
+					points.emplace_back(query::PointQuery{ origin.x + x + 0.5, origin.y - y + 0.5 });
+				}
+			const auto& count{ static_cast<std::uint32_t>(cells.size()) };
+
+			CHECK(client.send(static_cast<std::uint16_t>(query::Command::Cells), count, cells) && client.header(response) && response.status == 0u && response.count == count);
+			const auto& cellResults{ client.lists<std::uint16_t>(count) };
+			CHECK(client.send(static_cast<std::uint16_t>(query::Command::Points), count, points) && client.header(response) && response.status == 0u && response.count == count);
+			const auto& pointResults{ client.lists<std::uint16_t>(count) };
+			CHECK(client.send(static_cast<std::uint16_t>(query::Command::Winners), count, cells) && client.header(response) && response.status == 0u && response.count == count);
+			const auto& winnerResults{ client.values<std::uint16_t>(count) };
+			if (CHECK(cellResults.size() == count && pointResults.size() == count && winnerResults.size() == count)) {
+				for (size_t i{ 0ull }; i < count; ++i) {
+					const auto& regions{ index.cell(cells[i].x, cells[i].y) };
+					CHECK(std::equal(regions.begin(), regions.end(), cellResults[i].begin(), cellResults[i].end()));
+					std::vector<std::uint16_t> found;
+					index.regionsAt(points[i].x, points[i].y, found);
+					CHECK(pointResults[i] == found);
+					CHECK(winnerResults[i] == index.winner(cells[i].x, cells[i].y));
+				}
+			}
+
+			// an empty batch is still a valid request
+			CHECK(client.send(static_cast<std::uint16_t>(query::Command::Cells), 0u) && client.header(response) && response.status == 0u && response.count == 0u);
+			CHECK(client.values<std::uint32_t>(1ull) == std::vector<std::uint32_t>{ 0u });
+
+			// regions
+			CHECK(client.send(static_cast<std::uint16_t>(query::Command::Regions), 0u) && client.header(response) && response.status == 0u && response.count == index.regionCount());
+			const auto& names{ client.lists<char>(response.count) };
+			if (CHECK(names.size() == index.regionCount()))
+				for (std::uint16_t i{ 1u }; i <= index.regionCount(); ++i)
+					CHECK(std::string(names[i - 1u].begin(), names[i - 1u].end()) == index.getReader().editorID(i));
+
+			// reload, after which the same connection sees the new results
+			CHECK(client.send(static_cast<std::uint16_t>(query::Command::Reload), 0u) && client.header(response) && response.status == 0u && response.count == 1u);
+			const auto& reload{ client.values<query::ReloadRecord>(1ull) };
+			CHECK(reload.size() == 1ull && reload[0].generation == 1ull && reload[0].cellsParsed == 5ull && reload[0].cellsReused == 75ull);
+			CHECK(client.send(static_cast<std::uint16_t>(query::Command::Winners), count, cells) && client.header(response) && response.status == 0u && response.count == count);
+			const auto& newWinners{ client.values<std::uint16_t>(count) };
+			if (CHECK(newWinners.size() == count))
+				for (size_t i{ 0ull }; i < count; ++i)
+					CHECK(newWinners[i] == reloaded->index->winner(cells[i].x, cells[i].y));
+		}
+	}
+
+	// malformed requests are rejected without reading a payload, so the connection is closed
+	CHECK(rejects(path, static_cast<std::uint16_t>(query::Command::Cells), query::MAX_COUNT + 1u));
+	CHECK(rejects(path, static_cast<std::uint16_t>(query::Command::Winners), 0xFFFFFFFFu));
+	CHECK(rejects(path, static_cast<std::uint16_t>(query::Command::Winners) + 1u, 0u));
+	CHECK(rejects(path, static_cast<std::uint16_t>(query::Command::Info), 1u));
+
+	// stop
+	{
+		Client client{ path };
+		query::ResponseHeader response{};
+		CHECK(client.send(static_cast<std::uint16_t>(query::Command::Stop), 0u) && client.header(response) && response.status == 0u && response.count == 0u);
+	}
+	thread.join();
+	CHECK(!std::filesystem::exists(path));
+	std::filesystem::remove_all(dir);
+#endif
+
+	return test::report("test_query");
+}
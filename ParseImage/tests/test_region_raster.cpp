@@ -0,0 +1,150 @@
+#include "check.hpp"
+
+#include "../CellMapper.hpp"
+#include "../LabelImage.hpp"
+#include "../RasterEncoder.hpp"
+
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+/// @brief	Classify a label image, using cells of the given size.
+CellMapper::Result classify(const ColorLUT& lut, const cv::Mat& labels, const cv::Size& cellSize)
+{
+	const CellMapper mapper{ lut, cv::Size{ labels.cols / cellSize.width, labels.rows / cellSize.height }, cellSize, 0.2f };
+	return mapper.run([&labels, &cellSize](const int& y) { return labels.rowRange(y * cellSize.height, (y + 1) * cellSize.height); });
+}
+
+/// @brief	Check if two label images have the same size & labels.
+bool sameLabels(const cv::Mat& a, const cv::Mat& b)
+{
+	if (a.size() != b.size() || a.type() != b.type())
+		return false;
+	for (int y{ 0 }; y < a.rows; ++y)
+		if (!std::equal(a.ptr<uchar>(y), a.ptr<uchar>(y) + a.cols * a.elemSize(), b.ptr<uchar>(y)))
+			return false;
+	return true;
+}
+
+int main()
+{
+	std::mt19937 rng{ 307u };
+
+	RegionVec regionVec;
+	for (ushort i{ 1u }; i <= 4u; ++i)
+		regionVec.emplace_back("Region" + std::to_string(i), "Region " + std::to_string(i), RGB{ static_cast<uchar>(i * 50u), 0u, static_cast<uchar>(i) }, static_cast<ushort>(i % 2u));
+	const ColorLUT lut{ regionVec };
+	const RegionTable& regions{ lut.getRegionTable() };
+
+	// horizontal bands of random regions, so that every row has several runs, and the bottom rows differ from the rows above them
+	const cv::Size cellSize{ 4, 4 };
+	cv::Mat bgr(38, 30, CV_8UC3);
+	for (int y{ 0 }; y < bgr.rows; ++y) {
+		uchar* row{ bgr.ptr<uchar>(y) };
+		for (int x{ 0 }; x < bgr.cols;) {
+			const size_t region{ rng() % (regions.size() + 1ull) };
+			const RGB& color{ region == 0ull ? RGB{ 255u, 255u, 255u } : regionVec[region - 1ull].color };
+			for (const int end{ std::min(bgr.cols, x + 1 + static_cast<int>(rng() % 12u)) }; x < end; ++x) {
+				row[x * 3] = color.b();
+				row[x * 3 + 1] = color.g();
+				row[x * 3 + 2] = color.r();
+			}
+		}
+	}
+	const LabelImage labels{ bgr, lut };
+
+	// encode the labels that classifying each strip finds, then the rows below the last whole row of cells, the same way as `runJob()`
+	const int rows{ bgr.rows / cellSize.height };
+	CHECK(rows * cellSize.height < bgr.rows && (bgr.cols / cellSize.width) * cellSize.width < bgr.cols);
+	const auto& encodeClassified{ [&](ThreadPool* pool, TileCache* cache) {
+		const CellMapper mapper{ lut, cv::Size{ bgr.cols / cellSize.width, rows }, cellSize, 0.2f };
+		RasterEncoder encoder{ bgr.cols, bgr.rows };
+		mapper.run([&bgr, &cellSize](const int& y) { return bgr.rowRange(y * cellSize.height, (y + 1) * cellSize.height); }, pool, {}, cache,
+			[&encoder, &cellSize](const int& y, const cv::Mat& labelStrip) { encoder.encode(labelStrip, y * cellSize.height); });
+		cv::Mat labelStrip;
+		LabelImage::convert(bgr.rowRange(rows * cellSize.height, bgr.rows), lut, labelStrip);
+		encoder.encode(labelStrip, rows * cellSize.height);
+		return encoder.serialize(regions);
+	} };
+	const auto& bytes{ encodeClassified(nullptr, nullptr) };
+
+	// cells that are reused from a cache aren't classified, but their labels are still encoded
+	{
+		ThreadPool pool{ 3u };
+		TileCache cache{ regions, cv::Size{ bgr.cols / cellSize.width, rows }, cellSize };
+		CHECK(encodeClassified(&pool, &cache) == bytes);
+		CHECK(encodeClassified(&pool, &cache) == bytes);
+	}
+
+	const raster::Reader reader{ bytes };
+	CHECK(reader.width() == static_cast<std::uint32_t>(bgr.cols) && reader.height() == static_cast<std::uint32_t>(bgr.rows));
+	std::vector<std::string> unmatched;
+	const LabelImage decoded{ reader, regions, &unmatched };
+	CHECK(unmatched.empty());
+	CHECK(sameLabels(decoded.mat(), labels.mat()));
+
+	// the raster can be classified again with cell sizes that reach into the rows below the cells it was encoded with
+	for (const auto& size : { cv::Size{ 6, 19 }, cv::Size{ 5, 2 } }) {
+		const auto& expected{ classify(lut, labels.mat(), size) }, actual{ classify(lut, decoded.mat(), size) };
+		CHECK(actual.partitions == static_cast<size_t>((bgr.cols / size.width) * (bgr.rows / size.height)));
+		CHECK(!expected.holdMap.empty() && actual.holdMap == expected.holdMap);
+		CHECK(actual.winners == expected.winners);
+
+		// the pixel counts of each cell can also be read from the runs without decoding them
+		for (int y{ 0 }; y + size.height <= bgr.rows; y += size.height)
+			for (int x{ 0 }; x + size.width <= bgr.cols; x += size.width) {
+				std::vector<std::uint32_t> counts(regions.size() + 1ull, 0u), pixels(regions.size() + 1ull, 0u);
+				reader.count(static_cast<std::uint32_t>(x), static_cast<std::uint32_t>(y), static_cast<std::uint32_t>(size.width), static_cast<std::uint32_t>(size.height), counts);
+				for (int py{ y }; py < y + size.height; ++py)
+					for (int px{ x }; px < x + size.width; ++px)
+						++pixels[labels.mat().ptr<uchar>(py)[px]];
+				CHECK(counts == pixels);
+			}
+	}
+
+	// a raster with a row that was never encoded can't be written
+	{
+		RasterEncoder partial{ bgr.cols, bgr.rows };
+		partial.encode(labels.rowRange(0, rows * cellSize.height), 0);
+		bool threw{ false };
+		try {
+			partial.serialize(regions);
+		} catch (const std::exception&) {
+			threw = true;
+		}
+		CHECK(threw);
+	}
+
+	// truncated files are rejected
+	{
+		auto truncated{ bytes };
+		truncated.resize(truncated.size() - 8ull);
+		bool threw{ false };
+		try {
+			const raster::Reader corrupt{ truncated };
+		} catch (const std::exception&) {
+			threw = true;
+		}
+		CHECK(threw);
+	}
+
+	// a file with more regions than 16-bit indices can refer to is rejected, even when all of its sections are valid
+	{
+		auto tooMany{ bytes };
+		const size_t offset{ (tooMany.size() + 7ull) & ~7ull }, count{ static_cast<size_t>(std::numeric_limits<std::uint16_t>::max()) + 1ull };
+		tooMany.resize(offset + count * sizeof(binmap::RegionRecord));
+		auto& header{ *reinterpret_cast<raster::Header*>(tooMany.data()) };
+		header.regionCount = static_cast<std::uint32_t>(count);
+		header.regions = binmap::Section{ offset, count * sizeof(binmap::RegionRecord) };
+		bool threw{ false };
+		try {
+			const raster::Reader corrupt{ tooMany };
+		} catch (const std::exception&) {
+			threw = true;
+		}
+		CHECK(threw);
+	}
+
+	return test::report("test_region_raster");
+}
@@ -0,0 +1,227 @@
+#include "check.hpp"
+
+#include "../ImageStrips.hpp"
+#include "../ThreadPool.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @struct	BmpSpec
+ * @brief	The header fields of a BMP file to write.
+ */
+struct BmpSpec {
+	int width{ 5 }, height{ 7 };
+	std::uint16_t bpp{ 24 };
+	std::uint32_t compression{ 0u };
+	/// @brief	The size of the info header: 40 (BITMAPINFOHEADER), 108 (V4), 124 (V5), or 12 (BITMAPCOREHEADER).
+	std::uint32_t infoSize{ 40u };
+	/// @brief	Red, green, blue & alpha masks, used with `BI_BITFIELDS`.
+	std::uint32_t masks[4]{ 0x00FF0000u, 0x0000FF00u, 0x000000FFu, 0xFF000000u };
+	/// @brief	Unused bytes between the headers & the pixels, which `bfOffBits` must skip.
+	std::uint32_t gap{ 0u };
+	bool topDown{ false };
+};
+
+/// @brief	The BGR color of a pixel in the test images.
+std::uint32_t pixel(const int& x, const int& y) { return static_cast<std::uint32_t>(x * 40 + 1) | (static_cast<std::uint32_t>(y * 30 + 2) << 8) | (static_cast<std::uint32_t>(x + y + 3) << 16); }
+
+/**
+ * @brief		Write a BMP file whose pixels are `pixel(x, y)`.
+ * @param path	The location of the file.
+ * @param spec	The header fields.
+ */
+void writeBmp(const std::filesystem::path& path, const BmpSpec& spec)
+{
+	std::vector<uchar> bytes;
+	const auto& put{ [&bytes](const std::uint64_t& value, const size_t& size) {
+		for (size_t i{ 0ull }; i < size; ++i)
+			bytes.emplace_back(static_cast<uchar>((value >> (i * 8ull)) & 0xFF));
+	} };
+
+	const size_t rowStride{ ((static_cast<size_t>(spec.width) * spec.bpp + 31ull) / 32ull) * 4ull };
+	// masks follow a 40-byte header, and are part of every larger one
+	const std::uint32_t maskBytes{ spec.compression == 3u && spec.infoSize == 40u ? 12u : 0u };
+	const std::uint32_t offset{ 14u + spec.infoSize + maskBytes + spec.gap };
+
+	put('B', 1ull);
+	put('M', 1ull);
+	put(offset + rowStride * spec.height, 4ull);
+	put(0u, 4ull);
+	put(offset, 4ull);
+
+	const size_t infoStart{ bytes.size() };
+	put(spec.infoSize, 4ull);
+	put(static_cast<std::uint32_t>(spec.width), 4ull);
+	put(static_cast<std::uint32_t>(spec.topDown ? -spec.height : spec.height), 4ull);
+	put(1u, 2ull);
+	put(spec.bpp, 2ull);
+	put(spec.compression, 4ull);
+	put(rowStride * spec.height, 4ull);
+	while (bytes.size() < infoStart + std::min(spec.infoSize, 40u))
+		bytes.emplace_back(0u);
+	if (spec.compression == 3u)
+		for (size_t i{ 0ull }; i < (spec.infoSize >= 56u ? 4ull : 3ull); ++i)
+			put(spec.masks[i], 4ull);
+	while (bytes.size() < offset)
+		bytes.emplace_back(0u);
+
+	for (int row{ 0 }; row < spec.height; ++row) {
+		const int y{ spec.topDown ? row : spec.height - 1 - row };
+		const size_t rowStart{ bytes.size() };
+		for (int x{ 0 }; x < spec.width; ++x)
+			put(pixel(x, y) | (spec.bpp == 32 ? 0xFF000000u : 0u), spec.bpp / 8ull);
+		while (bytes.size() < rowStart + rowStride)
+			bytes.emplace_back(0u);
+	}
+
+	std::ofstream ofs{ path, std::ios_base::binary | std::ios_base::trunc };
+	ofs.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+/**
+ * @brief		Check that a BMP file is decoded to the expected pixels, in strips of 2 rows.
+ * @param path	The location of the file.
+ * @param spec	The header fields that it was written with.
+ * @returns		true when every pixel matches.
+ */
+bool decodes(const std::filesystem::path& path, const BmpSpec& spec)
+{
+	const auto& reader{ StripReader::open(path) };
+	if (!CHECK(reader->size() == cv::Size(spec.width, spec.height)))
+		return false;
+	cv::Mat strip;
+	int y{ 0 };
+	for (; reader->read(strip, 2); y += 2)
+		for (int row{ 0 }; row < strip.rows; ++row)
+			for (int x{ 0 }; x < spec.width; ++x) {
+				const uchar* px{ strip.ptr<uchar>(row) + x * 3 };
+				if (static_cast<std::uint32_t>(px[0] | (px[1] << 8) | (px[2] << 16)) != pixel(x, y + row))
+					return false;
+			}
+	// the last row is left over, because 7 isn't a multiple of 2
+	return y == spec.height - spec.height % 2 && reader->read(strip, spec.height % 2) && strip.rows == spec.height % 2;
+}
+
+/// @brief	Check if opening a file throws.
+bool rejects(const std::filesystem::path& path)
+{
+	try {
+		StripReader::open(path);
+		return false;
+	} catch (const std::exception&) {
+		return true;
+	}
+}
+
+int main()
+{
+	const auto& dir{ std::filesystem::temp_directory_path() / "parseimg_test_strip_reader" };
+	std::filesystem::create_directories(dir);
+	const auto& path{ dir / "image.bmp" };
+
+	// streamed strips keep their colors, so the regions are only needed by images that are loaded whole
+	const ColorLUT lut{ RegionVec{} };
+
+	// valid headers
+	BmpSpec spec;
+	writeBmp(path, spec);
+	CHECK(decodes(path, spec));
+
+	spec.topDown = true;
+	spec.gap = 10u; //< pixels that don't start right after the headers
+	writeBmp(path, spec);
+	CHECK(decodes(path, spec));
+
+	for (const auto& infoSize : { 40u, 108u, 124u }) {
+		BmpSpec bitfields;
+		bitfields.bpp = 32;
+		bitfields.compression = 3u;
+		bitfields.infoSize = infoSize;
+		writeBmp(path, bitfields);
+		CHECK(decodes(path, bitfields));
+
+		// only masks in BGRA byte order can be copied as-is
+		bitfields.masks[0] = 0x000000FFu;
+		bitfields.masks[2] = 0x00FF0000u;
+		writeBmp(path, bitfields);
+		CHECK(rejects(path));
+	}
+
+	BmpSpec v5;
+	v5.bpp = 32;
+	v5.infoSize = 124u;
+	writeBmp(path, v5);
+	CHECK(decodes(path, v5));
+
+	// strips requested concurrently are still decoded in order
+	{
+		writeBmp(path, spec);
+		ImageStrips strips{ path, 1, lut, true };
+		CHECK(strips.streamed());
+		std::vector<uchar> matches(static_cast<size_t>(spec.height), 0u);
+		ThreadPool pool{ 3u };
+		pool.parallel_for(matches.size(), [&](const size_t& i) {
+			const int y{ static_cast<int>(i) };
+			const cv::Mat& strip{ strips.get(y) };
+			bool match{ strip.rows == 1 && strip.cols == spec.width };
+			for (int x{ 0 }; match && x < spec.width; ++x) {
+				const uchar* px{ strip.ptr<uchar>(0) + x * 3 };
+				match = static_cast<std::uint32_t>(px[0] | (px[1] << 8) | (px[2] << 16)) == pixel(x, y);
+			}
+			matches[i] = match ? 1u : 0u;
+		});
+		CHECK(std::all_of(matches.begin(), matches.end(), [](const uchar& match) { return match != 0u; }));
+
+		// every strip was read, so none can be read again
+		bool threw{ false };
+		try {
+			strips.get(0);
+		} catch (const std::exception&) {
+			threw = true;
+		}
+		CHECK(threw);
+	}
+
+	// the rows below the last whole strip are read after every strip
+	{
+		ImageStrips strips{ path, 3, lut, true };
+		bool threw{ false };
+		try {
+			strips.remainder();
+		} catch (const std::exception&) {
+			threw = true;
+		}
+		CHECK(threw);
+		CHECK(strips.get(0).rows == 3 && strips.get(1).rows == 3);
+		const auto& rest{ strips.remainder() };
+		if (CHECK(rest.rows == spec.height % 3 && rest.cols == spec.width))
+			for (int x{ 0 }; x < spec.width; ++x) {
+				const uchar* px{ rest.ptr<uchar>(0) + x * 3 };
+				CHECK(static_cast<std::uint32_t>(px[0] | (px[1] << 8) | (px[2] << 16)) == pixel(x, spec.height - 1));
+			}
+		CHECK(ImageStrips{ path, spec.height, lut, true }.remainder().empty());
+	}
+
+	// invalid headers
+	BmpSpec core;
+	core.infoSize = 12u;
+	writeBmp(path, core);
+	CHECK(rejects(path));
+
+	BmpSpec rle;
+	rle.compression = 1u;
+	writeBmp(path, rle);
+	CHECK(rejects(path));
+
+	writeBmp(path, spec);
+	std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1ull);
+	CHECK(rejects(path));
+
+	std::filesystem::remove_all(dir);
+	return test::report("test_strip_reader");
+}